@@ -19,6 +19,7 @@
 #include "scy/interface.h"
 #include "scy/logger.h"
 
+#include <cassert>
 #include <cstdint>
 #include <iostream>
 #include <memory>
@@ -32,6 +33,54 @@ const int BUFFER_SIZE = 16384;
 const int LINE_LENGTH = 72;
 
 
+/// Instruction set used by the block encoder and decoder.
+///
+/// The fastest set supported by the host CPU is selected at runtime the
+/// first time a block is encoded or decoded.
+enum class Accel
+{
+    None = 0, ///< Reference libb64 state machine, one byte at a time.
+    Scalar,   ///< Table driven 3 byte to 4 character blocks.
+    SSE41,    ///< 12 bytes per iteration using SSSE3/SSE4.1 shuffles.
+    AVX2,     ///< 24 bytes per iteration using AVX2 shuffles.
+    NEON,     ///< 48 bytes per iteration using ARM NEON table lookups.
+};
+
+
+/// Returns the instruction set currently used for encoding and decoding.
+Base_API Accel accel();
+
+/// Returns true if the given instruction set is supported by the host.
+Base_API bool hasAccel(Accel accel);
+
+/// Overrides the instruction set used for encoding and decoding.
+/// Returns false if the set is not supported by the host, in which case
+/// the current selection is left unchanged.
+/// This is mainly useful for testing and benchmarking.
+Base_API bool setAccel(Accel accel);
+
+
+/// Returns the exact number of characters required to encode `length`
+/// bytes, including padding and the line feeds inserted every
+/// `lineLength` characters (0 for no line feeds).
+inline size_t encodedSize(size_t length, int lineLength = LINE_LENGTH)
+{
+    size_t size = ((length + 2) / 3) * 4;
+    if (lineLength >= 4)
+        size += (length / 3) / (lineLength / 4);
+    return size;
+}
+
+
+/// Returns the output buffer size required to decode `length` characters.
+/// The decoded data may be shorter if the input contains padding, line
+/// feeds or other characters outside the Base64 alphabet.
+inline size_t decodedSize(size_t length)
+{
+    return (length / 4) * 3 + 3;
+}
+
+
 //
 // Base64 Encoder
 //
@@ -77,7 +126,7 @@ struct Encoder : public basic::Encoder
     {
         const int N = _buffersize;
         char* readbuf = new char[N];
-        char* encbuf = new char[2 * N];
+        char* encbuf = new char[maxEncodedSize(N)];
         ssize_t nread;
         ssize_t enclen;
 
@@ -99,16 +148,13 @@ struct Encoder : public basic::Encoder
 
     void encode(const std::string& in, std::string& out)
     {
-        char* encbuf = new char[in.length() * 2];
-        ssize_t enclen = encode(in.c_str(), in.length(), encbuf);
-        out.append(encbuf, enclen);
-
-        enclen = finalize(encbuf);
-        out.append(encbuf, enclen);
+        size_t offset = out.size();
+        out.resize(offset + maxEncodedSize(in.length()));
+        ssize_t enclen = encode(in.c_str(), in.length(), &out[offset]);
+        enclen += finalize(&out[offset + enclen]);
+        out.resize(offset + enclen);
 
         internal::init_encodestate(&_state);
-
-        delete[] encbuf;
     }
 
     ssize_t encode(const char* inbuf, size_t nread, char* outbuf) override
@@ -123,6 +169,14 @@ struct Encoder : public basic::Encoder
 
     void setLineLength(int lineLength) { _state.linelength = lineLength; }
 
+    /// Returns the output buffer size required to encode and finalize
+    /// `length` more bytes, accounting for the bytes and line position
+    /// carried over from previous calls.
+    size_t maxEncodedSize(size_t length) const
+    {
+        return encodedSize(length + 2, _state.linelength) + 2;
+    }
+
     internal::encodestate _state;
     int _buffersize;
 };
@@ -132,20 +186,18 @@ struct Encoder : public basic::Encoder
 template <typename T>
 inline std::string encode(const T& bytes, int lineLength = LINE_LENGTH)
 {
-    std::string res;
-    res.reserve(bytes.size() * 2);
-    std::unique_ptr<char[]> encbuf(new char[bytes.size() * 2]);
+    std::string res(encodedSize(bytes.size(), lineLength), '\0');
+    if (res.empty())
+        return res;
 
     internal::encodestate state;
     internal::init_encodestate(&state);
     state.linelength = lineLength;
 
     ssize_t enclen = internal::encode_block(reinterpret_cast<const char*>(&bytes[0]),
-                                            bytes.size(), encbuf.get(), &state);
-    res.append(encbuf.get(), enclen);
-
-    enclen = internal::encode_blockend(encbuf.get(), &state);
-    res.append(encbuf.get(), enclen);
+                                            bytes.size(), &res[0], &state);
+    enclen += internal::encode_blockend(&res[enclen], &state);
+    assert(static_cast<size_t>(enclen) == res.size());
     return res;
 }
 
@@ -197,7 +249,7 @@ struct Decoder : public basic::Decoder
     {
         const int N = _buffersize;
         char* decbuf = new char[N];
-        char* readbuf = new char[N];
+        char* readbuf = new char[decodedSize(N)];
         size_t declen;
         size_t nread;
 
@@ -223,17 +275,17 @@ struct Decoder : public basic::Decoder
 template <typename T>
 inline std::string decode(const T& bytes)
 {
-    std::string res;
-    res.reserve(bytes.size() * 2);
-    std::unique_ptr<char[]> encbuf(new char[bytes.size() * 2]);
+    if (bytes.size() == 0)
+        return std::string();
+
+    std::string res(decodedSize(bytes.size()), '\0');
 
     internal::decodestate state;
     internal::init_decodestate(&state);
 
-    size_t enclen = internal::decode_block(reinterpret_cast<const char*>(&bytes[0]),
-                                           bytes.size(), encbuf.get(), &state);
-    res.append(encbuf.get(), enclen);
-
+    size_t declen = internal::decode_block(reinterpret_cast<const char*>(&bytes[0]),
+                                           bytes.size(), &res[0], &state);
+    res.resize(declen);
     return res;
 }
 
@@ -19,6 +19,7 @@
 #include "scy/util.h"
 
 #include <assert.h>
+#include <cstdint>
 #include <map>
 #include <sstream>
 #include <stdexcept>
@@ -355,6 +356,10 @@ protected:
 /// A storage container for a name value collections.
 /// This collection can store multiple entries for each
 /// name, and it's getters are case-insensitive.
+///
+/// Entries are stored in insertion order in a flat list along with a
+/// case-insensitive hash of their name, so lookups compare hashes before
+/// names. The list grows as needed, so small collections stay small.
 class Base_API NVCollection
 {
 public:
@@ -366,7 +371,19 @@ public:
         }
     };
 
-    typedef std::multimap<std::string, std::string, ILT> Map;
+    /// A name-value pair with the case-insensitive hash of its name.
+    struct Entry : public std::pair<std::string, std::string>
+    {
+        Entry(std::string name, std::string value, std::uint32_t hash)
+            : std::pair<std::string, std::string>(std::move(name), std::move(value))
+            , hash(hash)
+        {
+        }
+
+        std::uint32_t hash;
+    };
+
+    typedef std::vector<Entry> Map;
     typedef Map::iterator Iterator;
     typedef Map::const_iterator ConstIterator;
 
@@ -397,6 +414,9 @@ public:
     /// Adds a new name-value pair with the given name and value.
     void add(const std::string& name, const std::string& value);
 
+    /// Adds a new name-value pair, taking ownership of the strings.
+    void add(std::string&& name, std::string&& value);
+
     /// Returns the value of the first name-value pair with the given name.
     ///
     /// Throws a NotFoundException if the name-value pair does not exist.
@@ -436,6 +456,22 @@ public:
     /// Removes all name-value pairs and their values.
     void clear();
 
+    /// Returns the case-insensitive hash of the given name.
+    static std::uint32_t hash(const char* name, size_t length);
+    static std::uint32_t hash(const std::string& name);
+
+protected:
+    /// Lookup and update methods taking the precomputed hash of the
+    /// name, for names which are used repeatedly.
+    ConstIterator find(const std::string& name, std::uint32_t hash) const;
+    const std::string& get(const std::string& name, std::uint32_t hash,
+                           const std::string& defaultValue) const;
+    void set(const std::string& name, std::uint32_t hash, const std::string& value);
+    void erase(const std::string& name, std::uint32_t hash);
+
+    /// Adds an entry with the given hash.
+    void insert(std::string&& name, std::string&& value, std::uint32_t hash);
+
 private:
     Map _map;
 };
@@ -0,0 +1,54 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#ifndef SCY_CPU_H
+#define SCY_CPU_H
+
+
+#include "scy/base.h"
+
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SCY_CPU_X86 1
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define SCY_CPU_NEON 1
+#endif
+
+// GCC and Clang require an instruction set to be enabled per function
+// since the library itself is not compiled with -mavx2 or -msse4.1.
+#if defined(__GNUC__) || defined(__clang__)
+#define SCY_TARGET(x) __attribute__((target(x)))
+#else
+#define SCY_TARGET(x)
+#endif
+
+
+namespace scy {
+namespace cpu {
+
+
+/// Returns true if the running CPU supports SSE4.1.
+Base_API bool hasSSE41();
+
+/// Returns true if the running CPU and operating system support AVX2.
+Base_API bool hasAVX2();
+
+
+} // namespace cpu
+} // namespace scy
+
+
+#endif // SCY_CPU_H
+
+
+/// @\}
@@ -25,12 +25,37 @@ namespace scy {
 namespace hex {
 
 
+//
+// Bulk Encoding
+//
+
+
+/// Encodes `length` bytes from `data` as `2 * length` hex digits into the
+/// caller supplied `out` buffer, without line feeds.
+/// Returns the number of characters written.
+Base_API size_t encode(const void* data, size_t length, char* out,
+                       bool uppercase = false);
+
+/// Decodes `length` hex digits from `in` into `length / 2` bytes in the
+/// caller supplied `out` buffer. Whitespace is not permitted and a
+/// trailing odd digit is ignored.
+/// Returns the number of bytes written.
+/// Throws std::runtime_error if the input contains a non hex digit.
+Base_API size_t decode(const char* in, size_t length, void* out);
+
+/// Returns the value of the given hex digit, or -1 if it is not one.
+Base_API int digitValue(char c);
+
+
 //
 // Hex Encoder
 //
 
 
 /// Hex encoder.
+///
+/// The output buffer must have room for `2 * nread` characters, plus one
+/// line feed per `lineLength` characters if line feeds are enabled.
 struct Encoder : public basic::Encoder
 {
     Encoder()
@@ -42,19 +67,24 @@ struct Encoder : public basic::Encoder
 
     virtual ssize_t encode(const char* inbuf, size_t nread, char* outbuf) override
     {
-        // static const int eof = std::char_traits<char>::eof();
-        static const char digits[] = "0123456789abcdef0123456789ABCDEF";
+        if (_lineLength <= 0)
+            return hex::encode(inbuf, nread, outbuf, _uppercase != 0);
 
-        char c;
+        // Encode a line at a time, breaking once the line position
+        // reaches the line length.
         size_t nwrite = 0;
-        for (unsigned i = 0; i < nread; i++) {
-            c = inbuf[i];
-            std::memcpy(outbuf + nwrite++, &digits[_uppercase + ((c >> 4) & 0xF)], 1);
-            std::memcpy(outbuf + nwrite++, &digits[_uppercase + (c & 0xF)], 1);
-            if (_lineLength > 0 &&
-                (_linePos += 2) >= _lineLength) { //++_linePos;
+        while (nread > 0) {
+            size_t count = (_lineLength - _linePos + 1) / 2;
+            if (count < 1)
+                count = 1;
+            if (count > nread)
+                count = nread;
+            nwrite += hex::encode(inbuf, count, outbuf + nwrite, _uppercase != 0);
+            inbuf += count;
+            nread -= count;
+            if ((_linePos += static_cast<int>(count * 2)) >= _lineLength) {
                 _linePos = 0;
-                std::memcpy(outbuf + nwrite++, "\n", 1);
+                outbuf[nwrite++] = '\n';
             }
         }
 
@@ -77,15 +107,9 @@ struct Encoder : public basic::Encoder
 template <typename T>
 inline std::string encode(const T& bytes)
 {
-    static const char digits[] = "0123456789abcdef";
-    std::string res;
-    res.reserve(bytes.size() * 2);
-    for (typename T::const_iterator it = bytes.begin(); it != bytes.end();
-         ++it) {
-        const unsigned char c = static_cast<const unsigned char>(*it);
-        res += digits[(c >> 4) & 0xF];
-        res += digits[c & 0xF];
-    }
+    std::string res(bytes.size() * 2, '\0');
+    if (!res.empty())
+        encode(&bytes[0], bytes.size(), &res[0]);
     return res;
 }
 
@@ -96,6 +120,9 @@ inline std::string encode(const T& bytes)
 
 
 /// Hex decoder.
+///
+/// Whitespace between digits is skipped, and an odd trailing digit is
+/// carried over to the next call.
 struct Decoder : public basic::Decoder
 {
     Decoder()
@@ -106,56 +133,51 @@ struct Decoder : public basic::Decoder
 
     virtual ssize_t decode(const char* inbuf, size_t nread, char* outbuf) override
     {
-        int n;
-        char c;
         size_t rpos = 0;
         size_t nwrite = 0;
         while (rpos < nread) {
-            if (readnext(inbuf, nread, rpos, c))
-                n = (nybble(c) << 4);
-
-            else if (rpos >= nread) {
-                // Store the last byte to be
-                // prepended on next decode()
-                if (!iswspace(inbuf[rpos - 1]))
-                    std::memcpy(&lastbyte, &inbuf[rpos - 1], 1);
-                break;
+            if (lastbyte == '\0') {
+                // Decode the run of digits up to the next whitespace
+                // character in bulk.
+                size_t count = 0;
+                while (rpos + count < nread && !iswspace(inbuf[rpos + count]))
+                    count++;
+                size_t pairs = count / 2;
+                nwrite += hex::decode(inbuf + rpos, pairs * 2, outbuf + nwrite);
+                rpos += pairs * 2;
+                if (count % 2 == 0) {
+                    while (rpos < nread && iswspace(inbuf[rpos]))
+                        rpos++;
+                    continue;
+                }
+
+                // Store the odd digit to be paired with the next one,
+                // which may be in the next decode() call
+                nybble(inbuf[rpos]);
+                lastbyte = inbuf[rpos++];
             }
 
-            readnext(inbuf, nread, rpos, c);
-            n = n | nybble(c);
-            std::memcpy(outbuf + nwrite++, &n, 1);
-        }
-        return nwrite;
-    }
-
-    virtual ssize_t finalize(char* /* outbuf */) override { return 0; }
+            while (rpos < nread && iswspace(inbuf[rpos]))
+                rpos++;
+            if (rpos == nread)
+                break;
 
-    bool readnext(const char* inbuf, size_t nread, size_t& rpos,
-                  char& c)
-    {
-        if (rpos == 0 && lastbyte != '\0') {
             assert(!iswspace(lastbyte));
-            c = lastbyte;
+            int n = (nybble(lastbyte) << 4) | nybble(inbuf[rpos++]);
+            outbuf[nwrite++] = static_cast<char>(n);
             lastbyte = '\0';
-        } else {
-            c = inbuf[rpos++];
-            while (iswspace(c) && rpos < nread)
-                c = inbuf[rpos++];
         }
-        return rpos < nread;
+        return nwrite;
     }
 
+    virtual ssize_t finalize(char* /* outbuf */) override { return 0; }
+
     int nybble(const int n)
     {
-        if (n >= '0' && n <= '9')
-            return n - '0';
-        else if (n >= 'A' && n <= 'F')
-            return n - ('A' - 10);
-        else if (n >= 'a' && n <= 'f')
-            return n - ('a' - 10);
-        else
+        int v = digitValue(static_cast<char>(n));
+        if (v < 0)
             throw std::runtime_error("Invalid hex format");
+        return v;
     }
 
     bool iswspace(const char c)
@@ -167,6 +189,18 @@ struct Decoder : public basic::Decoder
 };
 
 
+/// Decodes the STL container from Hex.
+/// Throws std::runtime_error if the input contains a non hex digit.
+template <typename T>
+inline std::string decode(const T& digits)
+{
+    std::string res(digits.size() / 2, '\0');
+    if (!res.empty())
+        decode(&digits[0], res.size() * 2, &res[0]);
+    return res;
+}
+
+
 } // namespace hex
 } // namespace scy
 
@@ -298,6 +298,93 @@ inline RawPacket rawPacket(const char* data = nullptr, size_t size = 0,
 }
 
 
+/// GatherPacket references a short list of buffers which are sent as a
+/// single write, such as a frame header, payload and trailer, so framing
+/// layers need not copy the payload into a contiguous buffer.
+///
+/// The buffers are not owned, and like those of RawPacket are only
+/// guaranteed valid for the duration of the receiver callback.
+/// Cloning the packet copies the data into a single owned buffer.
+class Base_API GatherPacket : public IPacket
+{
+public:
+    /// The maximum number of buffers.
+    static const size_t MaxBuffers = 8;
+
+    GatherPacket(unsigned flags = 0, void* source = nullptr,
+                 void* opaque = nullptr, IPacketInfo* info = nullptr)
+        : IPacket(source, opaque, info, flags)
+        , _count(0)
+        , _size(0)
+    {
+    }
+
+    GatherPacket(const GatherPacket& that)
+        : IPacket(that)
+        , _count(0)
+        , _size(0)
+    {
+        that.write(_storage);
+        if (!_storage.empty())
+            add(_storage.data(), _storage.size());
+    }
+
+    virtual ~GatherPacket() = default;
+
+    virtual IPacket* clone() const override
+    {
+        return new GatherPacket(*this);
+    }
+
+    /// Appends a buffer. Empty buffers are ignored.
+    void add(const void* data, size_t size)
+    {
+        assert(_count < MaxBuffers);
+        if (size == 0 || _count >= MaxBuffers)
+            return;
+        _buffers[_count++] = ConstBuffer(data, size);
+        _size += size;
+    }
+
+    void add(const std::string& str)
+    {
+        add(str.data(), str.size());
+    }
+
+    /// Returns the buffers for a vectored write.
+    const ConstBuffer* buffers() const { return _buffers; }
+
+    /// Returns the number of buffers.
+    size_t count() const { return _count; }
+
+    virtual ssize_t read(const ConstBuffer&) override
+    {
+        assert(0 && "write only");
+        return 0;
+    }
+
+    virtual void write(Buffer& buf) const override
+    {
+        buf.reserve(buf.size() + _size);
+        for (size_t i = 0; i < _count; i++) {
+            auto data = bufferCast<const char*>(_buffers[i]);
+            buf.insert(buf.end(), data, data + _buffers[i].size());
+        }
+    }
+
+    /// Returns the total size of the buffers.
+    virtual size_t size() const override { return _size; }
+
+    virtual const char* className() const override { return "GatherPacket"; }
+
+protected:
+    ConstBuffer _buffers[MaxBuffers];
+    size_t _count;
+    size_t _size;
+    Buffer _storage; ///< Data owned by cloned packets
+};
+
+
 } // namespace scy
 
 
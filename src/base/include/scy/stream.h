@@ -20,12 +20,97 @@
 #include "scy/signal.h"
 #include "scy/logger.h"
 
+#include <functional>
+#include <initializer_list>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 
 namespace scy {
 
 
+/// Stream write completion callback.
+/// The status is zero on success or a libuv error code.
+typedef std::function<void(int status)> WriteCallback;
+
+
+namespace internal {
+
+
+struct WriteReqPool;
+
+
+/// Pooled stream write request.
+struct WriteReq
+{
+    uv_write_t req;
+
+    /// Coalesced data owned by the request while corked.
+    Buffer buffer;
+
+    /// Callbacks to invoke when the write completes.
+    std::vector<WriteCallback> callbacks;
+
+    /// The owning pool, only set while the request is in flight.
+    std::shared_ptr<WriteReqPool> pool;
+
+    WriteReq()
+    {
+        req.data = this;
+    }
+};
+
+
+/// Per stream pool of write requests.
+///
+/// In flight requests hold a reference to the pool so it outlives the
+/// stream while writes are pending.
+struct WriteReqPool
+{
+    /// The maximum number of idle requests retained by the pool.
+    static const size_t MAX_FREE = 32;
+
+    std::vector<WriteReq*> free;
+
+    ~WriteReqPool()
+    {
+        for (auto req : free)
+            delete req;
+    }
+
+    static WriteReq* acquire(const std::shared_ptr<WriteReqPool>& pool)
+    {
+        WriteReq* req;
+        if (pool->free.empty())
+            req = new WriteReq;
+        else {
+            req = pool->free.back();
+            pool->free.pop_back();
+        }
+        req->pool = pool;
+        return req;
+    }
+
+    /// Invokes the request callbacks and returns it to the pool.
+    static void release(WriteReq* req, int status)
+    {
+        auto pool = std::move(req->pool);
+        for (auto& callback : req->callbacks)
+            callback(status);
+        req->callbacks.clear();
+        req->buffer.clear();
+        if (pool->free.size() < MAX_FREE)
+            pool->free.push_back(req);
+        else
+            delete req;
+    }
+};
+
+
+} // namespace internal
+
+
 /// Basic stream type for sockets and pipes.
 template<typename T>
 class Base_API Stream : public uv::Handle<T>
@@ -36,6 +121,7 @@ public:
     Stream(uv::Loop* loop = uv::defaultLoop())
         : uv::Handle<T>(loop)
         , _buffer(65536)
+        , _writeReqs(std::make_shared<internal::WriteReqPool>())
     {
     }
 
@@ -51,6 +137,10 @@ public:
     virtual void close() override
     {
         // LTrace("Close: ", ptr())
+        if (_corked)
+            uncork();
+        _flusher.reset();
+        _pressured = false;
         if (_started)
             readStop();
         Handle::close();
@@ -64,6 +154,11 @@ public:
         if (!Handle::active())
             return false;
 
+        // Submit coalesced data first, the shutdown will complete once all
+        // pending writes are done.
+        if (_corked)
+            flush();
+
         // XXX: Sending shutdown causes an eof error to be returned via
         // handleRead() which sets the stream to error state. This is not
         // really an error, perhaps it should be handled differently?
@@ -78,35 +173,264 @@ public:
     /// Return false if the underlying socket is closed.
     /// This method does not throw an exception.
     bool write(const char* data, size_t len)
+    {
+        auto buf = constBuffer(data, len);
+        return writev(&buf, 1);
+    }
+
+    /// Write data to the target stream.
+    ///
+    /// This method is only valid for IPC streams.
+    bool write(const char* data, size_t len, uv_stream_t* send)
     {
         if (!Handle::active())
             return false;
 
         assert(_started);
+        assert(stream()->type == UV_NAMED_PIPE && this->template get<uv_pipe_t>()->ipc);
+
+        // Coalesced data must go out before the handle
+        if (_corked)
+            flush();
 
         auto buf = uv_buf_init((char*)data, (int)len);
-        return Handle::invoke(&uv_write, new uv_write_t, stream(), &buf, 1, [](uv_write_t* req, int) {
-            delete req;
+        auto req = internal::WriteReqPool::acquire(_writeReqs);
+        return submit(req, [&]() {
+            return uv_write2(&req->req, stream(), &buf, 1, send, handleWrite);
         });
     }
 
-    /// Write data to the target stream.
+    /// Writes multiple buffers to the stream with a single `uv_write`.
     ///
-    /// This method is only valid for IPC streams.
-    bool write(const char* data, size_t len, uv_stream_t* send)
+    /// The optional callback is invoked once the data has been written,
+    /// or with an error status if the write failed or was cancelled.
+    /// Unless the stream is corked the buffers are not copied, and must
+    /// remain valid until the write completes.
+    ///
+    /// Return false if the underlying socket is closed.
+    /// This method does not throw an exception.
+    bool writev(const ConstBuffer* bufs, size_t nbufs, WriteCallback callback = nullptr)
     {
         if (!Handle::active())
             return false;
 
         assert(_started);
-        assert(stream()->type == UV_NAMED_PIPE && this->template get<uv_pipe_t>()->ipc);
+        assert(nbufs > 0);
 
-        auto buf = uv_buf_init((char*)data, (int)len);
-        return Handle::invoke(&uv_write2, new uv_write_t, stream(), &buf, 1, send, [](uv_write_t* req, int) {
-            delete req;
+        if (_corked) {
+            for (size_t i = 0; i < nbufs; i++) {
+                auto data = bufferCast<const char*>(bufs[i]);
+                _corkBuffer.insert(_corkBuffer.end(), data, data + bufs[i].size());
+            }
+            if (callback)
+                _corkCallbacks.push_back(std::move(callback));
+            scheduleFlush();
+            checkPressure();
+            return true;
+        }
+
+        static const size_t MAX_STACK_BUFS = 16;
+        uv_buf_t stackbufs[MAX_STACK_BUFS];
+        std::unique_ptr<uv_buf_t[]> heapbufs(
+            nbufs > MAX_STACK_BUFS ? new uv_buf_t[nbufs] : nullptr);
+        uv_buf_t* uvbufs = heapbufs ? heapbufs.get() : stackbufs;
+        for (size_t i = 0; i < nbufs; i++)
+            uvbufs[i] = uv_buf_init(const_cast<char*>(bufferCast<const char*>(bufs[i])),
+                                   (unsigned)bufs[i].size());
+
+        auto req = internal::WriteReqPool::acquire(_writeReqs);
+        if (callback)
+            req->callbacks.push_back(std::move(callback));
+        return submit(req, [&]() {
+            return uv_write(&req->req, stream(), uvbufs, (unsigned)nbufs, handleWrite);
+        });
+    }
+
+    /// Writes multiple buffers to the stream with a single `uv_write`.
+    /// See writev() above.
+    bool writev(std::initializer_list<ConstBuffer> bufs, WriteCallback callback = nullptr)
+    {
+        return writev(bufs.begin(), bufs.size(), std::move(callback));
+    }
+
+    /// Writes multiple buffers to the stream, attempting a single
+    /// vectored write immediately.
+    ///
+    /// Any data which cannot be written immediately is copied into a
+    /// pooled write request, so unlike writev() the buffers need not
+    /// outlive the call.
+    ///
+    /// Return false if the underlying socket is closed.
+    /// This method does not throw an exception.
+    bool writevCopy(const ConstBuffer* bufs, size_t nbufs)
+    {
+        if (!Handle::active())
+            return false;
+
+        assert(_started);
+        assert(nbufs > 0);
+
+        if (_corked)
+            return writev(bufs, nbufs);
+
+        static const size_t MAX_STACK_BUFS = 16;
+        uv_buf_t stackbufs[MAX_STACK_BUFS];
+        std::unique_ptr<uv_buf_t[]> heapbufs(
+            nbufs > MAX_STACK_BUFS ? new uv_buf_t[nbufs] : nullptr);
+        uv_buf_t* uvbufs = heapbufs ? heapbufs.get() : stackbufs;
+        size_t total = 0;
+        for (size_t i = 0; i < nbufs; i++) {
+            uvbufs[i] = uv_buf_init(const_cast<char*>(bufferCast<const char*>(bufs[i])),
+                                   (unsigned)bufs[i].size());
+            total += bufs[i].size();
+        }
+
+        // Fails with UV_EAGAIN if writes are already queued
+        int written = uv_try_write(stream(), uvbufs, (unsigned)nbufs);
+        if (written < 0) {
+            if (written != UV_EAGAIN && written != UV_ENOSYS) {
+                Handle::setUVError(written, "Stream write error");
+                return false;
+            }
+            written = 0;
+        }
+        if (size_t(written) == total)
+            return true;
+
+        // Queue a copy of the remainder
+        auto req = internal::WriteReqPool::acquire(_writeReqs);
+        req->buffer.reserve(total - written);
+        size_t skip = written;
+        for (size_t i = 0; i < nbufs; i++) {
+            if (skip >= uvbufs[i].len) {
+                skip -= uvbufs[i].len;
+                continue;
+            }
+            req->buffer.insert(req->buffer.end(), uvbufs[i].base + skip,
+                               uvbufs[i].base + uvbufs[i].len);
+            skip = 0;
+        }
+        auto buf = uv_buf_init(req->buffer.data(), (unsigned)req->buffer.size());
+        return submit(req, [&]() {
+            return uv_write(&req->req, stream(), &buf, 1, handleWrite);
+        });
+    }
+
+    /// Writes the contents of the given buffer to the stream, taking
+    /// ownership of the data so it need not outlive the call.
+    ///
+    /// The data is not copied unless the stream is corked. Instead the
+    /// buffer is swapped with the empty buffer of a pooled write request,
+    /// so buffer capacity is recycled between writes.
+    ///
+    /// Return false if the underlying socket is closed.
+    /// This method does not throw an exception.
+    bool writeOwned(Buffer& buffer, WriteCallback callback = nullptr)
+    {
+        if (!Handle::active())
+            return false;
+
+        assert(_started);
+
+        if (_corked) {
+            auto buf = constBuffer(buffer.data(), buffer.size());
+            bool res = writev(&buf, 1, std::move(callback));
+            buffer.clear();
+            return res;
+        }
+
+        auto req = internal::WriteReqPool::acquire(_writeReqs);
+        req->buffer.swap(buffer);
+        if (callback)
+            req->callbacks.push_back(std::move(callback));
+        auto buf = uv_buf_init(req->buffer.data(), (unsigned)req->buffer.size());
+        return submit(req, [&]() {
+            return uv_write(&req->req, stream(), &buf, 1, handleWrite);
         });
     }
 
+    /// Corks the stream.
+    ///
+    /// While corked, writes are copied into an internal buffer and submitted
+    /// as a single `uv_write` before the event loop next polls for I/O, so
+    /// everything written within one loop iteration costs one request and
+    /// usually one syscall.
+    void cork()
+    {
+        Handle::assertThread();
+        if (_corked)
+            return;
+        if (!_flusher) {
+            _flusher.reset(new uv::Handle<uv_prepare_t>(Handle::loop()));
+            _flusher->init(&uv_prepare_init);
+            _flusher->get()->data = this;
+            _flusher->unref();
+        }
+        _corked = true;
+    }
+
+    /// Submits any coalesced data and uncorks the stream.
+    /// Closing the stream also uncorks it.
+    void uncork()
+    {
+        Handle::assertThread();
+        if (!_corked)
+            return;
+        flush();
+        _corked = false;
+        if (_flusher && _flusher->active())
+            uv_prepare_stop(_flusher->get());
+    }
+
+    /// Return true if the stream is corked.
+    bool corked() const
+    {
+        return _corked;
+    }
+
+    /// Sets the write queue watermarks.
+    ///
+    /// The Pressure signal is emitted once the number of bytes queued for
+    /// writing exceeds `high`, and the Drain signal once the queue has
+    /// subsequently drained to `low` or below.
+    /// A `high` value of zero disables pressure signalling.
+    void setWriteWatermarks(size_t high, size_t low)
+    {
+        if (low > high)
+            throw std::invalid_argument("Low watermark exceeds high watermark");
+        _highWaterMark = high;
+        _lowWaterMark = low;
+    }
+
+    /// Return the high write queue watermark.
+    size_t highWaterMark() const
+    {
+        return _highWaterMark;
+    }
+
+    /// Return the low write queue watermark.
+    size_t lowWaterMark() const
+    {
+        return _lowWaterMark;
+    }
+
+    /// Return the number of bytes waiting to be written, including
+    /// data coalesced by a corked stream.
+    size_t writeQueueSize()
+    {
+        size_t size = _corkBuffer.size();
+        if (Handle::initialized())
+            size += stream()->write_queue_size;
+        return size;
+    }
+
+    /// Return true if the write queue is above the high watermark and
+    /// has not yet drained.
+    bool pressured() const
+    {
+        return _pressured;
+    }
+
     /// Return the uv_stream_t pointer.
     uv_stream_t* stream()
     {
@@ -116,6 +440,15 @@ public:
     /// Signal the notifies when data is available for read.
     Signal<void(const char*, const int&)> Read;
 
+    /// Signals when the write queue exceeds the high watermark.
+    /// The argument is the current write queue size.
+    Signal<void(const size_t&)> Pressure;
+
+    /// Signals when the write queue has drained to the low watermark
+    /// after the Pressure signal was emitted.
+    /// The argument is the current write queue size.
+    Signal<void(const size_t&)> Drain;
+
 protected:
     virtual bool readStart()
     {
@@ -146,9 +479,97 @@ protected:
         Read.emit(data, (const int)len);
     }
 
+    /// Starts the flush handle of a corked stream, so coalesced data is
+    /// submitted before the event loop next polls for I/O.
+    void scheduleFlush()
+    {
+        assert(_corked);
+        if (!_flusher->active())
+            uv_prepare_start(_flusher->get(), handleFlush);
+    }
+
+    /// Submits the coalesced data of a corked stream as a single write.
+    virtual bool flush()
+    {
+        if (_corkBuffer.empty() && _corkCallbacks.empty())
+            return true;
+
+        auto req = internal::WriteReqPool::acquire(_writeReqs);
+        req->buffer.swap(_corkBuffer);
+        req->callbacks.swap(_corkCallbacks);
+        if (!Handle::active()) {
+            internal::WriteReqPool::release(req, UV_ECANCELED);
+            return false;
+        }
+
+        auto buf = uv_buf_init(req->buffer.data(), (unsigned)req->buffer.size());
+        return submit(req, [&]() {
+            return uv_write(&req->req, stream(), &buf, 1, handleWrite);
+        });
+    }
+
+    /// Submits a pooled write request via the given function.
+    /// The request is released on failure since libuv will not call back.
+    template<typename F>
+    bool submit(internal::WriteReq* req, F&& write)
+    {
+        int err = write();
+        if (err) {
+            internal::WriteReqPool::release(req, err);
+            Handle::setUVError(err, "Stream write error");
+        }
+        else
+            checkPressure();
+        return !err;
+    }
+
+    /// Emits the Pressure signal if the write queue has grown past the
+    /// high watermark.
+    void checkPressure()
+    {
+        if (_pressured || !_highWaterMark)
+            return;
+        size_t size = writeQueueSize();
+        if (size > _highWaterMark) {
+            _pressured = true;
+            Pressure.emit(size);
+        }
+    }
+
+    /// Emits the Drain signal if the write queue has drained to the low
+    /// watermark while under pressure.
+    void checkDrain()
+    {
+        if (!_pressured)
+            return;
+        size_t size = writeQueueSize();
+        if (size <= _lowWaterMark) {
+            _pressured = false;
+            Drain.emit(size);
+        }
+    }
+
     //
     /// UV callbacks
 
+    static void handleWrite(uv_write_t* req, int status)
+    {
+        auto handle = req->handle;
+        internal::WriteReqPool::release(
+            static_cast<internal::WriteReq*>(req->data), status);
+
+        // Pending writes are cancelled when the handle is closed, in which
+        // case the stream may already be gone.
+        if (!uv_is_closing(reinterpret_cast<uv_handle_t*>(handle)))
+            reinterpret_cast<Stream*>(handle->data)->checkDrain();
+    }
+
+    static void handleFlush(uv_prepare_t* handle)
+    {
+        uv_prepare_stop(handle);
+        reinterpret_cast<Stream*>(handle->data)->flush();
+    }
+
     static void handleRead(uv_stream_t* handle, ssize_t nread, const uv_buf_t* buf)
     {
         // LTrace("Handle read: ", nread)
@@ -187,6 +608,14 @@ protected:
 protected:
     Buffer _buffer;
     bool _started{false};
+    bool _corked{false};
+    bool _pressured{false};
+    size_t _highWaterMark{1024 * 1024};
+    size_t _lowWaterMark{256 * 1024};
+    Buffer _corkBuffer;
+    std::vector<WriteCallback> _corkCallbacks;
+    std::shared_ptr<internal::WriteReqPool> _writeReqs;
+    std::unique_ptr<uv::Handle<uv_prepare_t>> _flusher;
 };
 
 
@@ -13,6 +13,22 @@
 
 
 #include "scy/base64.h"
+#include "scy/cpu.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+#ifdef SCY_CPU_X86
+#define SCY_BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+#ifdef SCY_CPU_NEON
+#define SCY_BASE64_NEON 1
+#include <arm_neon.h>
+#endif
 
 
 namespace scy {
@@ -20,6 +36,418 @@ namespace base64 {
 namespace internal {
 
 
+static const char encoding[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+//
+// Block kernels
+//
+// Encode kernels convert `groups` whole 3 byte groups into 4 characters
+// each, and never read past the end of the input.
+// Decode kernels convert runs of 4 characters from the Base64 alphabet
+// into 3 bytes each, stopping at the first block containing any other
+// character (padding, line feeds, whitespace) so the state machine can
+// deal with it. They return the number of 4 character quads consumed.
+//
+
+
+typedef void (*encode_kernel)(const uint8_t* in, size_t groups, char* out);
+typedef size_t (*decode_kernel)(const char* in, size_t length, uint8_t* out);
+
+
+static void encode_scalar(const uint8_t* in, size_t groups, char* out)
+{
+    for (size_t i = 0; i < groups; i++, in += 3, out += 4) {
+        uint32_t v = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | in[2];
+        out[0] = encoding[(v >> 18) & 0x3f];
+        out[1] = encoding[(v >> 12) & 0x3f];
+        out[2] = encoding[(v >> 6) & 0x3f];
+        out[3] = encoding[v & 0x3f];
+    }
+}
+
+
+static const int8_t* decoding_table()
+{
+    static int8_t table[256];
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+        std::memset(table, -1, sizeof(table));
+        for (int i = 0; i < 64; i++)
+            table[static_cast<uint8_t>(encoding[i])] = static_cast<int8_t>(i);
+    });
+    return table;
+}
+
+
+static size_t decode_scalar(const char* in, size_t length, uint8_t* out)
+{
+    const int8_t* table = decoding_table();
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(in);
+    size_t quads = 0;
+    for (; length >= 4; length -= 4, src += 4, out += 3, quads++) {
+        int32_t a = table[src[0]], b = table[src[1]];
+        int32_t c = table[src[2]], d = table[src[3]];
+        if ((a | b | c | d) < 0)
+            break;
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = static_cast<uint8_t>(v >> 16);
+        out[1] = static_cast<uint8_t>(v >> 8);
+        out[2] = static_cast<uint8_t>(v);
+    }
+    return quads;
+}
+
+
+#ifdef SCY_BASE64_X86
+
+
+// The SIMD kernels follow the approach described by Wojciech Muła and
+// Daniel Lemire in "Faster Base64 Encoding and Decoding Using AVX2
+// Instructions": bytes are reshuffled into 6 bit indices using multiply
+// tricks and translated to ASCII with nibble indexed lookup tables.
+
+
+SCY_TARGET("sse4.1")
+static inline __m128i enc_reshuffle_sse(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                           4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+
+SCY_TARGET("sse4.1")
+static inline __m128i enc_translate_sse(__m128i in)
+{
+    const __m128i lut = _mm_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    __m128i indices = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    const __m128i mask = _mm_cmpgt_epi8(in, _mm_set1_epi8(25));
+    indices = _mm_sub_epi8(indices, mask);
+    return _mm_add_epi8(in, _mm_shuffle_epi8(lut, indices));
+}
+
+
+SCY_TARGET("sse4.1")
+static inline __m128i dec_reshuffle_sse(__m128i in)
+{
+    const __m128i merged = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+    const __m128i out = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(out, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                               14, 13, 12, -1, -1, -1, -1));
+}
+
+
+// Translates 16 characters to 6 bit values, returning false if any of
+// them is outside the Base64 alphabet.
+SCY_TARGET("sse4.1")
+static inline bool dec_translate_sse(__m128i& str)
+{
+    const __m128i lut_lo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2F = _mm_set1_epi8(0x2F);
+
+    const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2F);
+    const __m128i lo_nibbles = _mm_and_si128(str, mask_2F);
+    const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    if (!_mm_testz_si128(lo, hi))
+        return false;
+
+    const __m128i eq_2F = _mm_cmpeq_epi8(str, mask_2F);
+    const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2F, hi_nibbles));
+    str = _mm_add_epi8(str, roll);
+    return true;
+}
+
+
+SCY_TARGET("sse4.1")
+static void encode_sse41(const uint8_t* in, size_t groups, char* out)
+{
+    // Loads 16 bytes to consume 12, so keep 6 groups in reserve.
+    for (; groups >= 6; groups -= 4, in += 12, out += 16) {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        str = enc_translate_sse(enc_reshuffle_sse(str));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), str);
+    }
+    encode_scalar(in, groups, out);
+}
+
+
+SCY_TARGET("sse4.1")
+static size_t decode_sse41(const char* in, size_t length, uint8_t* out)
+{
+    // Stores 16 bytes to produce 12, so only run while the remaining
+    // input guarantees enough room in the output buffer.
+    size_t quads = 0;
+    for (; length >= 32; length -= 16, in += 16, out += 12, quads += 4) {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        if (!dec_translate_sse(str))
+            break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), dec_reshuffle_sse(str));
+    }
+    return quads + decode_scalar(in, length, out);
+}
+
+
+SCY_TARGET("avx2")
+static void encode_avx2(const uint8_t* in, size_t groups, char* out)
+{
+    const __m256i shuf = _mm256_set_epi8(
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i lut = _mm256_setr_epi8(
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+        65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+    // Loads bytes [0, 28) to consume 24, so keep 10 groups in reserve.
+    for (; groups >= 10; groups -= 8, in += 24, out += 32) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12));
+        __m256i str = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        str = _mm256_shuffle_epi8(str, shuf);
+        const __m256i t0 = _mm256_and_si256(str, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(str, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        str = _mm256_or_si256(t1, t3);
+
+        __m256i indices = _mm256_subs_epu8(str, _mm256_set1_epi8(51));
+        const __m256i mask = _mm256_cmpgt_epi8(str, _mm256_set1_epi8(25));
+        indices = _mm256_sub_epi8(indices, mask);
+        str = _mm256_add_epi8(str, _mm256_shuffle_epi8(lut, indices));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), str);
+    }
+    encode_sse41(in, groups, out);
+}
+
+
+SCY_TARGET("avx2")
+static size_t decode_avx2(const char* in, size_t length, uint8_t* out)
+{
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i shuf = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i mask_2F = _mm256_set1_epi8(0x2F);
+
+    // Stores 32 bytes to produce 24, see decode_sse41().
+    size_t quads = 0;
+    for (; length >= 48; length -= 32, in += 32, out += 24, quads += 8) {
+        __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+
+        const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2F);
+        const __m256i lo_nibbles = _mm256_and_si256(str, mask_2F);
+        const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm256_testz_si256(lo, hi))
+            break;
+
+        const __m256i eq_2F = _mm256_cmpeq_epi8(str, mask_2F);
+        const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2F, hi_nibbles));
+        str = _mm256_add_epi8(str, roll);
+
+        str = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        str = _mm256_madd_epi16(str, _mm256_set1_epi32(0x00011000));
+        str = _mm256_shuffle_epi8(str, shuf);
+        str = _mm256_permutevar8x32_epi32(str, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), str);
+    }
+    return quads + decode_sse41(in, length, out);
+}
+
+
+static bool cpu_supports(Accel accel)
+{
+    switch (accel) {
+        case Accel::SSE41: return cpu::hasSSE41();
+        case Accel::AVX2:  return cpu::hasAVX2();
+        default:           return false;
+    }
+}
+
+
+#endif // SCY_BASE64_X86
+
+
+#ifdef SCY_BASE64_NEON
+
+
+static void encode_neon(const uint8_t* in, size_t groups, char* out)
+{
+    const uint8x16x4_t lut = {{
+        vld1q_u8(reinterpret_cast<const uint8_t*>(encoding)),
+        vld1q_u8(reinterpret_cast<const uint8_t*>(encoding) + 16),
+        vld1q_u8(reinterpret_cast<const uint8_t*>(encoding) + 32),
+        vld1q_u8(reinterpret_cast<const uint8_t*>(encoding) + 48)}};
+    const uint8x16_t mask = vdupq_n_u8(0x3f);
+
+    for (; groups >= 16; groups -= 16, in += 48, out += 64) {
+        const uint8x16x3_t src = vld3q_u8(in);
+        uint8x16x4_t str;
+        str.val[0] = vshrq_n_u8(src.val[0], 2);
+        str.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(src.val[0], 4), vshrq_n_u8(src.val[1], 4)), mask);
+        str.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(src.val[1], 2), vshrq_n_u8(src.val[2], 6)), mask);
+        str.val[3] = vandq_u8(src.val[2], mask);
+        str.val[0] = vqtbl4q_u8(lut, str.val[0]);
+        str.val[1] = vqtbl4q_u8(lut, str.val[1]);
+        str.val[2] = vqtbl4q_u8(lut, str.val[2]);
+        str.val[3] = vqtbl4q_u8(lut, str.val[3]);
+        vst4q_u8(reinterpret_cast<uint8_t*>(out), str);
+    }
+    encode_scalar(in, groups, out);
+}
+
+
+static size_t decode_neon(const char* in, size_t length, uint8_t* out)
+{
+    // Maps characters to their value plus one, leaving zero for
+    // characters outside the alphabet. Characters above 127 select
+    // nothing since vqtbl4q_u8 returns zero for out of range indices.
+    static uint8_t table[128];
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+        for (int i = 0; i < 64; i++)
+            table[static_cast<uint8_t>(encoding[i])] = static_cast<uint8_t>(i + 1);
+    });
+    const uint8x16x4_t lo = {{vld1q_u8(table), vld1q_u8(table + 16),
+                              vld1q_u8(table + 32), vld1q_u8(table + 48)}};
+    const uint8x16x4_t hi = {{vld1q_u8(table + 64), vld1q_u8(table + 80),
+                              vld1q_u8(table + 96), vld1q_u8(table + 112)}};
+    const uint8x16_t offset = vdupq_n_u8(64);
+    const uint8x16_t one = vdupq_n_u8(1);
+
+    size_t quads = 0;
+    for (; length >= 64; length -= 64, in += 64, out += 48, quads += 16) {
+        uint8x16x4_t str = vld4q_u8(reinterpret_cast<const uint8_t*>(in));
+        uint8x16_t invalid = vdupq_n_u8(0);
+        for (int i = 0; i < 4; i++) {
+            const uint8x16_t v = vorrq_u8(vqtbl4q_u8(lo, str.val[i]),
+                                          vqtbl4q_u8(hi, vsubq_u8(str.val[i], offset)));
+            invalid = vorrq_u8(invalid, vceqq_u8(v, vdupq_n_u8(0)));
+            str.val[i] = vsubq_u8(v, one);
+        }
+        if (vmaxvq_u8(invalid) != 0)
+            break;
+
+        uint8x16x3_t dst;
+        dst.val[0] = vorrq_u8(vshlq_n_u8(str.val[0], 2), vshrq_n_u8(str.val[1], 4));
+        dst.val[1] = vorrq_u8(vshlq_n_u8(str.val[1], 4), vshrq_n_u8(str.val[2], 2));
+        dst.val[2] = vorrq_u8(vshlq_n_u8(str.val[2], 6), str.val[3]);
+        vst3q_u8(out, dst);
+    }
+    return quads + decode_scalar(in, length, out);
+}
+
+
+static bool cpu_supports(Accel accel)
+{
+    // Advanced SIMD is mandatory on AArch64.
+    return accel == Accel::NEON;
+}
+
+
+#endif // SCY_BASE64_NEON
+
+
+#if !defined(SCY_BASE64_X86) && !defined(SCY_BASE64_NEON)
+static bool cpu_supports(Accel)
+{
+    return false;
+}
+#endif
+
+
+struct Kernels
+{
+    Accel accel;
+    encode_kernel encode;
+    decode_kernel decode;
+};
+
+
+static Kernels kernels_for(Accel accel)
+{
+    switch (accel) {
+#ifdef SCY_BASE64_X86
+        case Accel::AVX2:
+            return { accel, encode_avx2, decode_avx2 };
+        case Accel::SSE41:
+            return { accel, encode_sse41, decode_sse41 };
+#endif
+#ifdef SCY_BASE64_NEON
+        case Accel::NEON:
+            return { accel, encode_neon, decode_neon };
+#endif
+        case Accel::Scalar:
+            return { accel, encode_scalar, decode_scalar };
+        default:
+            return { Accel::None, nullptr, nullptr };
+    }
+}
+
+
+static const Kernels& kernels_at(Accel accel)
+{
+    static const Kernels table[] = {
+        kernels_for(Accel::None), kernels_for(Accel::Scalar),
+        kernels_for(Accel::SSE41), kernels_for(Accel::AVX2),
+        kernels_for(Accel::NEON)};
+    return table[static_cast<int>(accel)];
+}
+
+
+static Accel select_accel()
+{
+    static const Accel preference[] = { Accel::AVX2, Accel::SSE41, Accel::NEON };
+    for (Accel accel : preference) {
+        if (cpu_supports(accel))
+            return accel;
+    }
+    return Accel::Scalar;
+}
+
+
+static std::atomic<int>& current_accel()
+{
+    static std::atomic<int> current(static_cast<int>(select_accel()));
+    return current;
+}
+
+
+static const Kernels& kernels()
+{
+    return kernels_at(static_cast<Accel>(
+        current_accel().load(std::memory_order_relaxed)));
+}
+
+
 //
 // Encoder
 //
@@ -37,7 +465,6 @@ void init_encodestate(encodestate* state_in)
 
 char encode_value(char value_in)
 {
-    static const char* encoding = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     if (value_in > 63)
         return '=';
     return encoding[(int)value_in];
@@ -54,6 +481,28 @@ ssize_t encode_block(const char* plaintext_in, size_t length_in, char* code_out,
 
     result = state_in->result;
 
+    // Encode whole groups up to the next line feed with the block kernel
+    // while the state machine is between groups.
+    const encode_kernel kernel = kernels().encode;
+    const int linegroups = state_in->linelength / 4;
+    while (kernel && state_in->step == step_A &&
+           plaintextend - plainchar >= 3 &&
+           (linegroups <= 0 || state_in->stepcount < linegroups)) {
+        size_t groups = (plaintextend - plainchar) / 3;
+        if (linegroups > 0)
+            groups = std::min<size_t>(groups, linegroups - state_in->stepcount);
+        kernel(reinterpret_cast<const uint8_t*>(plainchar), groups, codechar);
+        plainchar += groups * 3;
+        codechar += groups * 4;
+        if (linegroups > 0) {
+            state_in->stepcount += static_cast<int>(groups);
+            if (state_in->stepcount == linegroups) {
+                *codechar++ = '\n';
+                state_in->stepcount = 0;
+            }
+        }
+    }
+
     switch (state_in->step) {
         while (1) {
             case step_A:
@@ -158,64 +607,84 @@ void init_decodestate(decodestate* state_in)
 ssize_t decode_block(const char* code_in, const size_t length_in, char* plaintext_out, decodestate* state_in)
 {
     const char* codechar = code_in;
+    const char* const codeend = code_in + length_in;
     char* plainchar = plaintext_out;
+    decodestep step = state_in->step;
     char fragment;
 
     *plainchar = state_in->plainchar;
 
-    switch (state_in->step) {
-        while (1) {
+    const decode_kernel kernel = kernels().decode;
+    while (codechar != codeend) {
+        // Decode whole quads with the block kernel while the state machine
+        // is between quads. The kernel stops at the first character outside
+        // the alphabet which is then skipped below.
+        if (kernel && step == step_a) {
+            size_t quads = kernel(codechar, codeend - codechar,
+                                  reinterpret_cast<uint8_t*>(plainchar));
+            codechar += quads * 4;
+            plainchar += quads * 3;
+            if (codechar == codeend)
+                break;
+        }
+
+        fragment = (char)decode_value(*codechar++);
+        if (fragment < 0)
+            continue;
+
+        switch (step) {
             case step_a:
-                do {
-                    if (codechar == code_in + length_in) {
-                        state_in->step = step_a;
-                        state_in->plainchar = *plainchar;
-                        return plainchar - plaintext_out;
-                    }
-                    fragment = (char)decode_value(*codechar++);
-                } while (fragment < 0);
                 *plainchar = (fragment & 0x03f) << 2;
+                step = step_b;
+                break;
             case step_b:
-                do {
-                    if (codechar == code_in + length_in) {
-                        state_in->step = step_b;
-                        state_in->plainchar = *plainchar;
-                        return plainchar - plaintext_out;
-                    }
-                    fragment = (char)decode_value(*codechar++);
-                } while (fragment < 0);
                 *plainchar++ |= (fragment & 0x030) >> 4;
                 *plainchar = (fragment & 0x00f) << 4;
+                step = step_c;
+                break;
             case step_c:
-                do {
-                    if (codechar == code_in + length_in) {
-                        state_in->step = step_c;
-                        state_in->plainchar = *plainchar;
-                        return plainchar - plaintext_out;
-                    }
-                    fragment = (char)decode_value(*codechar++);
-                } while (fragment < 0);
                 *plainchar++ |= (fragment & 0x03c) >> 2;
                 *plainchar = (fragment & 0x003) << 6;
+                step = step_d;
+                break;
             case step_d:
-                do {
-                    if (codechar == code_in + length_in) {
-                        state_in->step = step_d;
-                        state_in->plainchar = *plainchar;
-                        return plainchar - plaintext_out;
-                    }
-                    fragment = (char)decode_value(*codechar++);
-                } while (fragment < 0);
                 *plainchar++ |= (fragment & 0x03f);
+                step = step_a;
+                break;
         }
     }
 
-    // control should not reach here
+    state_in->step = step;
+    state_in->plainchar = step == step_a ? 0 : *plainchar;
     return plainchar - plaintext_out;
 }
 
 
 } // namespace internal
+
+
+Accel accel()
+{
+    return static_cast<Accel>(internal::current_accel().load());
+}
+
+
+bool hasAccel(Accel accel)
+{
+    return accel == Accel::None || accel == Accel::Scalar ||
+           internal::cpu_supports(accel);
+}
+
+
+bool setAccel(Accel accel)
+{
+    if (!hasAccel(accel))
+        return false;
+    internal::current_accel().store(static_cast<int>(accel));
+    return true;
+}
+
+
 } // namespace base64
 } // namespace scy
 
@@ -11,6 +11,8 @@
 
 #include "scy/collection.h"
 
+#include <algorithm>
+
 
 namespace scy {
 
@@ -26,33 +28,32 @@ NVCollection& NVCollection::operator=(const NVCollection& nvc)
 
 const std::string& NVCollection::operator[](const std::string& name) const
 {
-    ConstIterator it = _map.find(name);
-    if (it != _map.end())
-        return it->second;
-    else
-        throw std::runtime_error("Item not found: " + name);
+    return get(name);
 }
 
 
 void NVCollection::set(const std::string& name, const std::string& value)
 {
-    Iterator it = _map.find(name);
-    if (it != _map.end())
-        it->second = value;
-    else
-        _map.insert(Map::value_type(name, value));
+    set(name, hash(name), value);
 }
 
 
 void NVCollection::add(const std::string& name, const std::string& value)
 {
-    _map.insert(Map::value_type(name, value));
+    insert(std::string(name), std::string(value), hash(name));
+}
+
+
+void NVCollection::add(std::string&& name, std::string&& value)
+{
+    std::uint32_t h = hash(name);
+    insert(std::move(name), std::move(value), h);
 }
 
 
 const std::string& NVCollection::get(const std::string& name) const
 {
-    ConstIterator it = _map.find(name);
+    ConstIterator it = find(name);
     if (it != _map.end())
         return it->second;
     else
@@ -63,23 +64,19 @@ const std::string& NVCollection::get(const std::string& name) const
 const std::string& NVCollection::get(const std::string& name,
     const std::string& defaultValue) const
 {
-    ConstIterator it = _map.find(name);
-    if (it != _map.end())
-        return it->second;
-    else
-        return defaultValue;
+    return get(name, hash(name), defaultValue);
 }
 
 
 bool NVCollection::has(const std::string& name) const
 {
-    return _map.find(name) != _map.end();
+    return find(name) != _map.end();
 }
 
 
 NVCollection::ConstIterator NVCollection::find(const std::string& name) const
 {
-    return _map.find(name);
+    return find(name, hash(name));
 }
 
 
@@ -109,7 +106,7 @@ int NVCollection::size() const
 
 void NVCollection::erase(const std::string& name)
 {
-    _map.erase(name);
+    erase(name, hash(name));
 }
 
 
@@ -119,6 +116,73 @@ void NVCollection::clear()
 }
 
 
+std::uint32_t NVCollection::hash(const char* name, size_t length)
+{
+    // FNV-1a over the ASCII lowercased name
+    std::uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = static_cast<unsigned char>(name[i]);
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        h = (h ^ c) * 16777619u;
+    }
+    return h;
+}
+
+
+std::uint32_t NVCollection::hash(const std::string& name)
+{
+    return hash(name.data(), name.size());
+}
+
+
+NVCollection::ConstIterator NVCollection::find(const std::string& name, std::uint32_t hash) const
+{
+    for (auto it = _map.begin(); it != _map.end(); ++it) {
+        if (it->hash == hash && it->first.size() == name.size() &&
+            util::icompare(it->first, name) == 0)
+            return it;
+    }
+    return _map.end();
+}
+
+
+const std::string& NVCollection::get(const std::string& name, std::uint32_t hash,
+                                     const std::string& defaultValue) const
+{
+    ConstIterator it = find(name, hash);
+    if (it != _map.end())
+        return it->second;
+    else
+        return defaultValue;
+}
+
+
+void NVCollection::set(const std::string& name, std::uint32_t hash, const std::string& value)
+{
+    ConstIterator it = find(name, hash);
+    if (it != _map.end())
+        _map[it - _map.begin()].second = value;
+    else
+        insert(std::string(name), std::string(value), hash);
+}
+
+
+void NVCollection::erase(const std::string& name, std::uint32_t hash)
+{
+    _map.erase(std::remove_if(_map.begin(), _map.end(), [&](const Entry& entry) {
+        return entry.hash == hash && entry.first.size() == name.size() &&
+               util::icompare(entry.first, name) == 0;
+    }), _map.end());
+}
+
+
+void NVCollection::insert(std::string&& name, std::string&& value, std::uint32_t hash)
+{
+    _map.emplace_back(std::move(name), std::move(value), hash);
+}
+
+
 } // namespace scy
 
 
@@ -0,0 +1,68 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#include "scy/cpu.h"
+
+#if defined(SCY_CPU_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace scy {
+namespace cpu {
+
+
+bool hasSSE41()
+{
+#if !defined(SCY_CPU_X86)
+    return false;
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1") != 0;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+#else
+    return false;
+#endif
+}
+
+
+bool hasAVX2()
+{
+#if !defined(SCY_CPU_X86)
+    return false;
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    // Require OS support for saving the YMM registers.
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+
+} // namespace cpu
+} // namespace scy
+
+
+/// @\}
@@ -0,0 +1,134 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup base
+/// @{
+
+
+#include "scy/hex.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCY_HEX_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+namespace scy {
+namespace hex {
+
+
+namespace {
+
+
+/// Lookup tables mapping each byte to its two digit representation,
+/// and each character to its digit value or -1.
+struct Tables
+{
+    char lower[256][2];
+    char upper[256][2];
+    int8_t values[256];
+
+    Tables()
+    {
+        static const char digits[] = "0123456789abcdef0123456789ABCDEF";
+        for (int i = 0; i < 256; i++) {
+            lower[i][0] = digits[i >> 4];
+            lower[i][1] = digits[i & 0xF];
+            upper[i][0] = digits[16 + (i >> 4)];
+            upper[i][1] = digits[16 + (i & 0xF)];
+            values[i] = -1;
+        }
+        for (int i = 0; i < 10; i++)
+            values['0' + i] = static_cast<int8_t>(i);
+        for (int i = 0; i < 6; i++) {
+            values['a' + i] = static_cast<int8_t>(10 + i);
+            values['A' + i] = static_cast<int8_t>(10 + i);
+        }
+    }
+};
+
+
+const Tables& tables()
+{
+    static const Tables tables;
+    return tables;
+}
+
+
+#ifdef SCY_HEX_SSE2
+
+// Converts 16 bytes to 32 hex digits. SSE2 is part of the x86-64
+// baseline so no runtime dispatch is needed.
+inline void encode16(const uint8_t* in, char* out, bool uppercase)
+{
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i alpha = _mm_set1_epi8(uppercase ? 'A' - '0' - 10 : 'a' - '0' - 10);
+
+    const __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(src, 4), mask);
+    __m128i lo = _mm_and_si128(src, mask);
+    hi = _mm_add_epi8(_mm_add_epi8(hi, zero),
+                      _mm_and_si128(_mm_cmpgt_epi8(hi, nine), alpha));
+    lo = _mm_add_epi8(_mm_add_epi8(lo, zero),
+                      _mm_and_si128(_mm_cmpgt_epi8(lo, nine), alpha));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(hi, lo));
+}
+
+#endif
+
+
+} // namespace
+
+
+size_t encode(const void* data, size_t length, char* out, bool uppercase)
+{
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+    const char(*table)[2] = uppercase ? tables().upper : tables().lower;
+    size_t i = 0;
+#ifdef SCY_HEX_SSE2
+    for (; i + 16 <= length; i += 16)
+        encode16(in + i, out + i * 2, uppercase);
+#endif
+    for (; i < length; i++) {
+        out[i * 2] = table[in[i]][0];
+        out[i * 2 + 1] = table[in[i]][1];
+    }
+    return length * 2;
+}
+
+
+size_t decode(const char* in, size_t length, void* out)
+{
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(in);
+    uint8_t* dst = static_cast<uint8_t*>(out);
+    const int8_t* values = tables().values;
+    const size_t count = length / 2;
+    for (size_t i = 0; i < count; i++) {
+        int hi = values[src[i * 2]];
+        int lo = values[src[i * 2 + 1]];
+        if ((hi | lo) < 0)
+            throw std::runtime_error("Invalid hex format");
+        dst[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return count;
+}
+
+
+int digitValue(char c)
+{
+    return tables().values[static_cast<uint8_t>(c)];
+}
+
+
+} // namespace hex
+} // namespace scy
+
+
+/// @\}
@@ -222,16 +222,13 @@ std::int64_t doubleToInt(double d)
 
 std::string dumpbin(const char* data, size_t len)
 {
-    std::string output;
-    for (size_t i = 0; i < len; i++) {
-        char byte = data[i];
-        for (size_t mask = 0x80; mask > 0; mask >>= 1) {
-            output.push_back(byte & mask ? '1' : '0');
-        }
-        if (i % 4 == 3)
-            output.push_back('\n');
-        else
-            output.push_back(' ');
+    std::string output(len * 9, '\0');
+    char* out = &output[0];
+    for (size_t i = 0; i < len; i++, out += 9) {
+        const uint8_t byte = static_cast<uint8_t>(data[i]);
+        for (int bit = 0; bit < 8; bit++)
+            out[bit] = (byte >> (7 - bit)) & 1 ? '1' : '0';
+        out[8] = i % 4 == 3 ? '\n' : ' ';
     }
     return output;
 }
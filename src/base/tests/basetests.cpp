@@ -267,6 +267,153 @@ int main(int argc, char** argv)
     });
 
 
+    // =========================================================================
+    // Base64
+    //
+    describe("base64", []() {
+        // RFC 4648 test vectors
+        expect(base64::encode(std::string(""), 0) == "");
+        expect(base64::encode(std::string("f"), 0) == "Zg==");
+        expect(base64::encode(std::string("fo"), 0) == "Zm8=");
+        expect(base64::encode(std::string("foo"), 0) == "Zm9v");
+        expect(base64::encode(std::string("foobar"), 0) == "Zm9vYmFy");
+        expect(base64::decode(std::string("Zm9vYmE=")) == "fooba");
+        expect(base64::decode(std::string("Zm9v\nYmFy")) == "foobar");
+
+        // Every instruction set must produce the same output as the
+        // reference state machine for all lengths and line lengths.
+        const base64::Accel accels[] = {
+            base64::Accel::Scalar, base64::Accel::SSE41,
+            base64::Accel::AVX2, base64::Accel::NEON };
+        const int lineLengths[] = { 0, 4, 72, 76 };
+        const base64::Accel selected = base64::accel();
+        for (size_t len = 0; len < 300; len += (len < 100 ? 1 : 7)) {
+            std::string data = util::randomBinaryString(static_cast<int>(len), false);
+            for (int lineLength : lineLengths) {
+                base64::setAccel(base64::Accel::None);
+                std::string reference = base64::encode(data, lineLength);
+                expect(reference.size() == base64::encodedSize(len, lineLength));
+                expect(base64::decode(reference) == data);
+                for (base64::Accel accel : accels) {
+                    if (!base64::setAccel(accel))
+                        continue;
+                    std::string encoded = base64::encode(data, lineLength);
+                    expect(encoded == reference);
+                    expect(base64::decode(encoded) == data);
+                }
+            }
+        }
+
+        // Streaming encode and decode split at arbitrary offsets
+        std::string data = util::randomBinaryString(4096, false);
+        std::string reference = base64::encode(data);
+        for (size_t split : { 1, 2, 3, 17, 1000 }) {
+            base64::Encoder enc;
+            std::string encoded;
+            std::vector<char> encbuf(enc.maxEncodedSize(split));
+            for (size_t pos = 0; pos < data.size(); pos += split) {
+                size_t n = std::min(split, data.size() - pos);
+                encoded.append(&encbuf[0], enc.encode(&data[pos], n, &encbuf[0]));
+            }
+            encoded.append(&encbuf[0], enc.finalize(&encbuf[0]));
+            expect(encoded == reference);
+
+            base64::Decoder dec;
+            std::string decoded;
+            std::vector<char> decbuf(base64::decodedSize(split) + 3);
+            for (size_t pos = 0; pos < encoded.size(); pos += split) {
+                size_t n = std::min(split, encoded.size() - pos);
+                decoded.append(&decbuf[0], dec.decode(&encoded[pos], n, &decbuf[0]));
+            }
+            expect(decoded == data);
+        }
+        base64::setAccel(selected);
+    });
+
+    describe("base64 benchmark", []() {
+        const base64::Accel accels[] = {
+            base64::Accel::None, base64::Accel::Scalar, base64::Accel::SSE41,
+            base64::Accel::AVX2, base64::Accel::NEON };
+        const char* names[] = { "reference", "scalar", "sse4.1", "avx2", "neon" };
+        const base64::Accel selected = base64::accel();
+        const std::string data = util::randomBinaryString(1024 * 1024, false);
+        const int iterations = 20;
+        for (size_t i = 0; i < 5; i++) {
+            if (!base64::setAccel(accels[i]))
+                continue;
+            std::string encoded, decoded;
+            uint64_t start = time::hrtime();
+            for (int n = 0; n < iterations; n++)
+                encoded = base64::encode(data, 0);
+            uint64_t encodeTime = time::hrtime() - start;
+            start = time::hrtime();
+            for (int n = 0; n < iterations; n++)
+                decoded = base64::decode(encoded);
+            uint64_t decodeTime = time::hrtime() - start;
+            expect(decoded == data);
+
+            const double mb = data.size() * iterations / (1024.0 * 1024.0);
+            std::cout << "base64 benchmark: " << names[i] << ": encode "
+                << (mb / (encodeTime / 1e9)) << "MB/s, decode "
+                << (mb / (decodeTime / 1e9)) << "MB/s" << std::endl;
+        }
+        base64::setAccel(selected);
+    });
+
+
+    // =========================================================================
+    // Hex
+    //
+    describe("hex", []() {
+        expect(hex::encode(std::string("\x01\xab\xff")) == "01abff");
+        expect(hex::decode(std::string("01ABff")) == "\x01\xab\xff");
+        expect(hex::digitValue('F') == 15);
+        expect(hex::digitValue('g') == -1);
+
+        // Bulk encoding matches the per digit encoding for every byte
+        std::string data;
+        for (int i = 0; i < 256; i++)
+            data.push_back(static_cast<char>(i));
+        char buf[1024];
+        expect(hex::encode(data.data(), data.size(), buf, true) == 512);
+        for (int i = 0; i < 256; i++) {
+            static const char digits[] = "0123456789ABCDEF";
+            expect(buf[i * 2] == digits[i >> 4]);
+            expect(buf[i * 2 + 1] == digits[i & 0xF]);
+        }
+        expect(hex::decode(buf, 512, buf + 512) == 256);
+        expect(std::string(buf + 512, 256) == data);
+        expect(hex::decode(std::string(buf, 512)) == data);
+
+        // Streaming encoder with line feeds and decoder with whitespace
+        // and digit pairs split across calls
+        hex::Encoder enc;
+        enc.setLineLength(16);
+        std::string encoded;
+        for (size_t pos = 0; pos < data.size(); pos += 5) {
+            size_t n = std::min<size_t>(5, data.size() - pos);
+            encoded.append(buf, enc.encode(&data[pos], n, buf));
+        }
+        expect(encoded.size() == 512 + 512 / 16);
+        expect(encoded.substr(0, 17) == "0001020304050607\n");
+
+        hex::Decoder dec;
+        std::string decoded;
+        for (size_t pos = 0; pos < encoded.size(); pos += 7) {
+            size_t n = std::min<size_t>(7, encoded.size() - pos);
+            decoded.append(buf, dec.decode(&encoded[pos], n, buf));
+        }
+        expect(decoded == data);
+
+        try {
+            hex::decode(std::string("0g"));
+            expect(0 && "invalid digit - must throw");
+        }
+        catch (std::exception&) {
+        }
+    });
+
+
     // =========================================================================
     // Collection
     //
@@ -340,6 +487,59 @@ int main(int argc, char** argv)
         expect(nvc.size() == 0);
     });
 
+    describe("collection order and copy", []() {
+        // Entries keep their insertion order and duplicate names need
+        // not be adjacent
+        NVCollection nvc;
+        nvc.add("Host", "localhost");
+        nvc.add("Set-Cookie", "a=1");
+        nvc.add("Content-Type", "text/plain");
+        nvc.add("set-cookie", "b=2");
+        expect(nvc.size() == 4);
+        expect(nvc.begin()->first == "Host");
+        expect((nvc.end() - 1)->second == "b=2");
+        expect(NVCollection::hash("SET-COOKIE") == NVCollection::hash("set-cookie"));
+
+        // Set replaces the value of the first entry only
+        nvc.set("SET-COOKIE", "c=3");
+        expect(nvc.get("set-cookie") == "c=3");
+        expect((nvc.end() - 1)->second == "b=2");
+        expect(nvc.size() == 4);
+
+        NVCollection copy(nvc);
+        nvc.erase("Set-Cookie");
+        expect(nvc.size() == 2);
+        expect(!nvc.has("set-cookie"));
+        expect(copy.size() == 4);
+        expect(copy.get("Content-Type") == "text/plain");
+
+        copy = nvc;
+        expect(copy.size() == 2);
+        expect(copy.get("host") == "localhost");
+    });
+
+    describe("collection benchmark", []() {
+        const char* names[] = {
+            "Host", "User-Agent", "Accept", "Accept-Language", "Accept-Encoding",
+            "Referer", "Cookie", "Connection", "Cache-Control", "Content-Type",
+            "Content-Length" };
+        const int iterations = 100000;
+        size_t found = 0;
+        uint64_t start = time::hrtime();
+        for (int n = 0; n < iterations; n++) {
+            NVCollection nvc;
+            for (auto name : names)
+                nvc.add(name, "value");
+            found += nvc.has("content-length");
+            found += nvc.has("Transfer-Encoding");
+            found += nvc.get("Connection", "").size();
+        }
+        uint64_t elapsed = time::hrtime() - start;
+        expect(found == size_t(iterations) * 6);
+        std::cout << "collection benchmark: " << (elapsed / iterations)
+            << "ns per header build and lookup" << std::endl;
+    });
+
 
     // =========================================================================
     // Filesystem
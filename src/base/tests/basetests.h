@@ -14,10 +14,12 @@
 #include "scy/base.h"
 #include "scy/test.h"
 #include "scy/application.h"
+#include "scy/base64.h"
 #include "scy/buffer.h"
 #include "scy/datetime.h"
 #include "scy/collection.h"
 #include "scy/filesystem.h"
+#include "scy/hex.h"
 #include "scy/idler.h"
 #include "scy/ipc.h"
 #include "scy/logger.h"
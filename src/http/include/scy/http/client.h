@@ -34,7 +34,7 @@ public:
     typedef std::shared_ptr<ClientConnection> Ptr;
 
     /// Create a standalone connection with the given host.
-    ClientConnection(const URL& url, const net::TCPSocket::Ptr& socket = std::make_shared<net::TCPSocket>());
+    ClientConnection(const URL& url, const net::Socket::Ptr& socket = std::make_shared<net::TCPSocket>());
 
     virtual ~ClientConnection();
 
@@ -34,9 +34,12 @@ class HTTP_API Connection : public net::SocketAdapter
 public:
     typedef std::shared_ptr<Connection> Ptr;
 
-    Connection(const net::TCPSocket::Ptr& socket = std::make_shared<net::TCPSocket>());
+    Connection(const net::Socket::Ptr& socket = std::make_shared<net::TCPSocket>());
     virtual ~Connection();
 
+    /// Called when an incoming message begins, before its headers.
+    virtual void onMessageBegin() {}
+
     virtual void onHeaders() = 0;
     virtual void onPayload(const MutableBuffer&) = 0;
     virtual void onComplete() = 0;
@@ -45,9 +48,22 @@ public:
     /// Send raw data to the peer.
     virtual ssize_t send(const char* data, size_t len, int flags = 0) override;
 
+    /// Send the given buffers to the peer in a single write.
+    virtual ssize_t sendv(const ConstBuffer* bufs, size_t nbufs, int flags = 0) override;
+
     /// Send the outdoing HTTP header.
     virtual ssize_t sendHeader();
 
+    /// Send the outgoing HTTP header followed by the given body data
+    /// in a single write. Returns the number of body bytes sent or -1
+    /// on error.
+    virtual ssize_t sendHeader(const char* data, size_t len, int flags = 0);
+
+    /// Send the outgoing HTTP header followed by the given body buffers
+    /// in a single write. Returns the number of body bytes sent or -1
+    /// on error.
+    virtual ssize_t sendHeader(const ConstBuffer* bufs, size_t nbufs, int flags = 0);
+
     /// Close the connection and schedule the object for
     /// deferred deletion.
     virtual void close();
@@ -76,7 +92,7 @@ public:
     bool secure() const;
 
     /// Return the underlying socket pointer.
-    net::TCPSocket::Ptr& socket();
+    net::Socket::Ptr& socket();
 
     /// Return the underlying adapter pointer.
     net::SocketAdapter* adapter() const;
@@ -95,6 +111,9 @@ protected:
     /// Note: Setting the error does not `close()` the connection.
     virtual void setError(const scy::Error& err);
 
+    /// Render the outgoing HTTP header into the given buffer.
+    virtual void writeHeader(std::string& buf);
+
     /// net::SocketAdapter interface
     virtual void onSocketConnect(net::Socket& socket) override;
     virtual void onSocketRecv(net::Socket& socket, const MutableBuffer& buffer, const net::Address& peerAddress) override;
@@ -102,11 +121,12 @@ protected:
     virtual void onSocketClose(net::Socket& socket) override;
 
 protected:
-    net::TCPSocket::Ptr _socket;
+    net::Socket::Ptr _socket;
     net::SocketAdapter* _adapter;
     Request _request;
     Response _response;
     scy::Error _error;
+    std::string _header; ///< Header buffer reused between messages
     bool _closed;
     bool _shouldSendHeader;
 
@@ -128,6 +148,7 @@ public:
     virtual ~ConnectionAdapter();
 
     virtual ssize_t send(const char* data, size_t len, int flags = 0);
+    virtual ssize_t sendv(const ConstBuffer* bufs, size_t nbufs, int flags = 0) override;
 
     /// Remove the given receiver.
     ///
@@ -145,7 +166,9 @@ protected:
     // virtual void onSocketClose();
 
     /// HTTP Parser interface
+    virtual void onParserBegin();
     virtual void onParserHeader(const std::string& name, const std::string& value);
+    virtual void onParserHeader(const ConstBuffer& name, const ConstBuffer& value);
     virtual void onParserHeadersEnd(bool upgrade);
     virtual void onParserChunk(const char* buf, size_t len);
     virtual void onParserError(const scy::Error& err);
@@ -0,0 +1,202 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup http
+/// @{
+
+
+#ifndef SCY_HTTP_FileResponder_H
+#define SCY_HTTP_FileResponder_H
+
+
+#include "scy/base.h"
+#include "scy/http/server.h"
+#include "scy/loop.h"
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+namespace scy {
+namespace http {
+
+
+/// An open file along with the metadata used to serve it.
+/// The file is closed once the last reference is released.
+struct HTTP_API CachedFile
+{
+    typedef std::shared_ptr<CachedFile> Ptr;
+
+    uv::Loop* loop;
+    uv_file fd;
+    uint64_t size;
+    uint64_t inode;
+    std::time_t mtime;
+    std::string etag;         ///< Quoted entity tag derived from mtime and size
+    std::string lastModified; ///< Last-Modified field value
+    std::string contentType;
+
+    CachedFile(uv::Loop* loop, uv_file fd);
+    ~CachedFile();
+
+private:
+    CachedFile(const CachedFile&) = delete;
+    CachedFile& operator=(const CachedFile&) = delete;
+};
+
+
+/// Bounded cache of open file descriptors and their stat results.
+///
+/// Files are kept open so repeated requests for the same file cost no
+/// open() or stat() calls until the revalidation interval has passed,
+/// after which the file is stat()ed and reopened if it has changed.
+/// Entries are evicted in least recently used order once the cache is
+/// full. An evicted file stays open until transfers using it complete.
+///
+/// Cache misses and revalidations open() and stat() the file
+/// synchronously on the event loop. This is deliberate, since for local
+/// disks the calls cost less than a round trip through the libuv
+/// threadpool, but files on slow or network filesystems will stall the
+/// loop while they are checked.
+///
+/// A cache belongs to a single event loop and is not thread safe.
+class HTTP_API FileCache
+{
+public:
+    FileCache(uv::Loop* loop = uv::defaultLoop(), size_t maxSize = 256,
+              std::int64_t revalidate = 1000);
+    ~FileCache();
+
+    /// Returns the open file at the given path, or nullptr if the file
+    /// does not exist or is not a regular file. Blocks on a cache miss
+    /// or revalidation, see above.
+    CachedFile::Ptr open(const std::string& path);
+
+    /// Removes the file cached for the given path.
+    void remove(const std::string& path);
+
+    /// Removes all files.
+    void clear();
+
+    /// Sets the maximum number of open files.
+    /// A size of 0 disables the cache.
+    void setMaxSize(size_t size);
+    size_t maxSize() const;
+
+    /// Sets the interval in milliseconds after which cached files are
+    /// checked for changes.
+    void setRevalidate(std::int64_t milliseconds);
+    std::int64_t revalidate() const;
+
+    /// Returns the number of cached files.
+    size_t size() const;
+
+    /// Guesses the Content-Type from the file extension.
+    static const char* contentType(const std::string& path);
+
+protected:
+    struct Entry
+    {
+        std::string path;
+        CachedFile::Ptr file;
+        std::uint64_t checkedAt;
+    };
+
+    /// Opens and stats the given path, or returns nullptr.
+    CachedFile::Ptr load(const std::string& path);
+    void evict();
+
+    uv::Loop* _loop;
+    std::list<Entry> _entries; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+    size_t _maxSize;
+    std::int64_t _revalidate;
+};
+
+
+/// Serves files from a root directory.
+///
+/// GET and HEAD requests are answered with ETag and Last-Modified
+/// validators, honouring If-None-Match, If-Modified-Since and single
+/// byte ranges. The body is sent with sendfile() where the socket
+/// supports it, which includes SSL sockets using kernel TLS, and is
+/// otherwise read and sent in chunks as the socket drains.
+///
+/// Connections are kept alive for further requests unless the client
+/// asks for them to be closed, in which case the connection is closed
+/// once the response has been sent.
+class HTTP_API FileResponder : public ServerResponder
+{
+public:
+    FileResponder(ServerConnection& connection, const std::string& root, FileCache& cache);
+    virtual ~FileResponder();
+
+    virtual void onRequest(Request& request, Response& response) override;
+    virtual void onClose() override;
+
+    /// Size of the chunks read when sendfile() is not available.
+    static const size_t ChunkSize = 65536;
+
+protected:
+    struct Transfer;
+
+    /// Maps the request path to a file below the root directory.
+    /// Returns false if the path is invalid.
+    bool resolve(const std::string& uri, std::string& path) const;
+
+    /// Sends the response header without a body.
+    void sendStatus(StatusCode status);
+
+    /// Sends the given range of the file as the response body.
+    void sendBody(const CachedFile::Ptr& file, uint64_t offset, uint64_t length);
+
+    /// Reads and sends the next chunk of a transfer.
+    void readNext(Transfer* transfer);
+
+    /// Invokes the function once the data queued on the socket has been
+    /// written. The flag is false if the connection closed first, in
+    /// which case the responder may already have been destroyed.
+    void afterWrite(std::function<void(bool ok)> func);
+
+    /// Ends the response, closing the connection once it has been
+    /// written unless the connection is kept alive.
+    void finish();
+
+    std::string _root;
+    FileCache& _cache;
+    std::shared_ptr<bool> _alive; ///< Cleared when the responder can no longer be used
+};
+
+
+/// Connection factory which creates a FileResponder for each request.
+class HTTP_API FileResponderFactory : public ServerConnectionFactory
+{
+public:
+    FileResponderFactory(const std::string& root, uv::Loop* loop = uv::defaultLoop());
+
+    virtual ServerResponder* createResponder(ServerConnection& connection) override;
+
+    /// Returns the open file cache shared by the responders.
+    FileCache& cache();
+
+protected:
+    std::string _root;
+    FileCache _cache;
+};
+
+
+} // namespace http
+} // namespace scy
+
+
+#endif // SCY_HTTP_FileResponder_H
+
+
+/// @\}
@@ -125,6 +125,12 @@ public:
     static const std::string EMPTY;
 
 protected:
+    /// Precomputed name hashes of the headers looked up by every message.
+    static const std::uint32_t CONTENT_LENGTH_HASH;
+    static const std::uint32_t CONTENT_TYPE_HASH;
+    static const std::uint32_t TRANSFER_ENCODING_HASH;
+    static const std::uint32_t CONNECTION_HASH;
+
     std::string _version;
 
     /// Creates the Message with version HTTP/1.0.
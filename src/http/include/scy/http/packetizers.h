@@ -40,7 +40,9 @@ public:
         : PacketProcessor(this->emitter)
         , connection(connection)
         , contentType(connection->outgoingHeader()->getContentType())
+        , frameSeparator(frameSeparator)
         , initial(true)
+        , nocopy(nocopy)
     {
     }
 
@@ -98,7 +100,7 @@ public:
 
     virtual void process(IPacket& packet) override
     {
-        LTrace("Processing:", packet.size());
+        // LTrace("Processing:", packet.size())
 
         if (!packet.hasData())
             throw std::invalid_argument("Incompatible packet type");
@@ -109,32 +111,54 @@ public:
             emitHeader();
         }
 
-        // Get hex stream length
-        std::ostringstream ost;
-        ost << std::hex << packet.size();
+        char header[20];
+        size_t len = formatChunkSize(header, packet.size());
 
-        // Emit separate packets for nocopy
+        // Emit the chunk as a single gather packet so the payload
+        // is written along with its framing without being copied
         if (nocopy) {
-            emit(ost.str());
-            emit("\r\n", 2);
-            if (!frameSeparator.empty())
-                emit(frameSeparator);
-            emit(packet.data(), packet.size());
-            emit("\r\n", 2);
+            GatherPacket chunk;
+            chunk.add(header, len);
+            chunk.add(frameSeparator);
+            chunk.add(packet.data(), packet.size());
+            chunk.add("\r\n", 2);
+            emit(chunk);
         }
 
         // Concat pieces for non fragmented
         else {
-            ost << "\r\n";
-            if (!frameSeparator.empty())
-                ost << frameSeparator;
-            ost.write(packet.data(), packet.size());
-            ost << "\r\n";
-            emit(ost.str());
+            _buffer.clear();
+            _buffer.insert(_buffer.end(), header, header + len);
+            _buffer.insert(_buffer.end(), frameSeparator.begin(), frameSeparator.end());
+            _buffer.insert(_buffer.end(), packet.data(), packet.data() + packet.size());
+            _buffer.insert(_buffer.end(), { '\r', '\n' });
+            RawPacket chunk(_buffer.data(), _buffer.size());
+            emit(chunk);
         }
     }
 
+    /// Writes the chunk size line for the given payload size,
+    /// which needs at most 18 bytes. Returns the line length.
+    static size_t formatChunkSize(char* buf, size_t size)
+    {
+        static const char digits[] = "0123456789abcdef";
+        char rev[16];
+        size_t n = 0;
+        do {
+            rev[n++] = digits[size & 0xF];
+            size >>= 4;
+        } while (size);
+        for (size_t i = 0; i < n; i++)
+            buf[i] = rev[n - 1 - i];
+        buf[n++] = '\r';
+        buf[n++] = '\n';
+        return n;
+    }
+
     PacketSignal emitter;
+
+protected:
+    Buffer _buffer; ///< Chunk buffer reused when copying
 };
 
 
@@ -202,19 +226,25 @@ public:
         }
     }
 
+    /// Returns the MIME header which precedes each part.
+    /// The header is rendered once from the content type.
+    virtual const std::string& chunkHeader()
+    {
+        if (_chunkHeader.empty()) {
+            _chunkHeader += "--end\r\nContent-Type: ";
+            _chunkHeader += contentType;
+            _chunkHeader += "\r\n";
+            if (isBase64)
+                _chunkHeader += "Content-Transfer-Encoding: base64\r\n";
+            _chunkHeader += "\r\n";
+        }
+        return _chunkHeader;
+    }
+
     /// Sets HTTP header for the current chunk.
     virtual void emitChunkHeader()
     {
-        // Write the chunk header
-        std::ostringstream hst;
-
-        hst << "--end\r\n"
-            << "Content-Type: " << contentType << "\r\n";
-        if (isBase64)
-            hst << "Content-Transfer-Encoding: base64\r\n";
-        hst << "\r\n";
-
-        emit(hst.str());
+        emit(chunkHeader());
     }
 
     virtual void process(IPacket& packet)
@@ -225,15 +255,28 @@ public:
             emitHeader();
         }
 
-        // Broadcast the HTTP header separately
-        // so we don't need to copy any data.
-        emitChunkHeader();
+        // Emit the part header, payload and the line break ending the
+        // part as a single gather packet so no data is copied.
+        if (packet.hasData()) {
+            GatherPacket part;
+            part.add(chunkHeader());
+            part.add(packet.data(), packet.size());
+            part.add("\r\n", 2);
+            emit(part);
+        }
 
-        // Proxy the input packet.
-        emit(packet);
+        // Proxy other packet types after a separate header.
+        else {
+            emitChunkHeader();
+            emit(packet);
+            emit("\r\n", 2);
+        }
     }
 
     PacketSignal emitter;
+
+protected:
+    std::string _chunkHeader;
 };
 
 
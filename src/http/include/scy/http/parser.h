@@ -26,7 +26,23 @@ namespace http {
 class HTTP_API ParserObserver
 {
 public:
+    /// Called when a new message begins, including each request on a
+    /// keep-alive connection.
+    virtual void onParserBegin() {}
+
     virtual void onParserHeader(const std::string& name, const std::string& value) = 0;
+
+    /// Called with each header as spans into the buffer being parsed,
+    /// or into parser storage if it was split across reads. The spans
+    /// are only valid for the duration of the call.
+    ///
+    /// The default implementation copies the spans into strings and
+    /// calls the string overload, so observers which handle headers
+    /// without copying them should override this.
+    virtual void onParserHeader(const ConstBuffer& name, const ConstBuffer& value)
+    {
+        onParserHeader(name.str(), value.str());
+    }
     virtual void onParserHeadersEnd(bool upgrade) = 0;
     virtual void onParserChunk(const char* data, size_t len) = 0;
     virtual void onParserEnd() = 0;
@@ -59,10 +75,18 @@ public:
     /// Returns true if the connection should be upgraded.
     bool upgrade() const;
 
+    /// Returns the type of messages parsed.
+    http_parser_type type() const;
+
     void setRequest(http::Request* request);
     void setResponse(http::Response* response);
     void setObserver(ParserObserver* observer);
 
+    /// Sets whether parsed headers are stored in the message, which is
+    /// the default. When disabled headers are only reported to the
+    /// observer as spans, and no strings are built for them.
+    void setStoreHeaders(bool flag);
+
     http::Message* message();
     ParserObserver* observer() const;
 
@@ -70,8 +94,9 @@ protected:
     void init();
 
     /// Callbacks
+    void onMessageBegin();
     void onURL(const std::string& value);
-    void onHeader(const std::string& name, const std::string& value);
+    void onHeader(const ConstBuffer& name, const ConstBuffer& value);
     void onHeadersEnd();
     void onBody(const char* buf, size_t len);
     void onMessageEnd();
@@ -97,12 +122,39 @@ protected:
     http_parser_settings _settings;
     http_parser_type _type;
 
+    /// A URL, header field or header value being parsed.
+    ///
+    /// The token points into the buffer being parsed, and is only copied
+    /// into its own storage if it is split across parse() calls.
+    struct Token
+    {
+        const char* at = nullptr;
+        size_t len = 0;
+        std::string copy;
+        bool copied = false;
+
+        void append(const char* data, size_t size);
+        void detach();
+        void clear();
+        bool empty() const { return len == 0; }
+        ConstBuffer buffer() const { return ConstBuffer(copied ? copy.data() : at ? at : "", len); }
+        std::string str() const { return copied ? copy : std::string(at, len); }
+    };
+
+    /// Emits the completed header, if any.
+    void flushHeader();
+
+    /// Emits the completed URL, if any.
+    void flushURL();
+
     bool _wasHeaderValue;
-    std::string _lastHeaderField;
-    std::string _lastHeaderValue;
+    Token _url;
+    Token _headerField;
+    Token _headerValue;
 
     bool _complete;
     bool _upgrade;
+    bool _storeHeaders;
     
     Error _error;
 };
@@ -149,6 +149,9 @@ public:
     }
 
 private:
+    /// Renders the status line for uncommon versions and reasons.
+    void writeStatusLine(std::string& str) const;
+
     StatusCode _status;
     std::string _reason;
 };
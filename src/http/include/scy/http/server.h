@@ -19,10 +19,14 @@
 #include "scy/http/parser.h"
 #include "scy/http/request.h"
 #include "scy/http/response.h"
+#include "scy/http/websocketdeflate.h"
 #include "scy/logger.h"
 #include "scy/net/socket.h"
 #include "scy/timer.h"
+#include <cstdint>
 #include <ctime>
+#include <memory>
+#include <vector>
 
 
 namespace scy {
@@ -33,13 +37,34 @@ class HTTP_API Server;
 class HTTP_API ServerResponder;
 
 
+/// HTTP server connection timeouts in milliseconds.
+/// A timeout of zero disables it.
+struct ServerTimeouts
+{
+    std::int64_t header { 30000 }; ///< Time allowed to receive the request headers
+    std::int64_t body { 60000 };   ///< Inactivity allowed while receiving the request body
+    std::int64_t idle { 60000 };   ///< Inactivity allowed once the request is complete
+    std::int64_t write { 60000 };  ///< Time allowed for a write queue which is not draining
+};
+
+
+/// Number of connections closed by each kind of timeout.
+struct ServerTimeoutStats
+{
+    std::uint64_t header { 0 };
+    std::uint64_t body { 0 };
+    std::uint64_t idle { 0 };
+    std::uint64_t write { 0 };
+};
+
+
 /// HTTP server connection.
 class HTTP_API ServerConnection : public Connection
 {
 public:
     typedef std::shared_ptr<ServerConnection> Ptr;
 
-    ServerConnection(Server& server, net::TCPSocket::Ptr socket);
+    ServerConnection(Server& server, net::Socket::Ptr socket);
     virtual ~ServerConnection();
 
     Server& server();
@@ -48,18 +73,51 @@ public:
     Signal<void(ServerConnection&)> Close; ///< Signals when the connection is closed
 
 protected:
+    virtual void onMessageBegin() override;
     virtual void onHeaders() override;
     virtual void onPayload(const MutableBuffer& buffer) override;
     virtual void onComplete() override;
     virtual void onClose() override;
 
+    /// Renders the response header along with a Date header,
+    /// unless one has been set.
+    virtual void writeHeader(std::string& buf) override;
+
     http::Message* incomingHeader() override;
     http::Message* outgoingHeader() override;
 
 protected:
+    /// Request phases for timeout purposes.
+    enum Phase
+    {
+        ReadingHeader,
+        ReadingBody,
+        Idle,
+        Upgraded
+    };
+
+    /// Activity snapshot which is updated lazily by the server's
+    /// timeout checks. Times are loop times in milliseconds.
+    struct Activity
+    {
+        std::uint64_t requestStartedAt { 0 }; ///< Time the current request began
+        std::uint64_t recvAt { 0 };    ///< Time bytes were last seen received
+        std::uint64_t sendAt { 0 };    ///< Time bytes were last seen sent
+        std::uint64_t stalledAt { 0 }; ///< Time the write queue stopped draining
+        std::uint64_t bytesIn { 0 };
+        std::uint64_t bytesOut { 0 };
+        size_t writeQueueSize { 0 };
+        std::uint64_t checkTick { 0 }; ///< Timer tick of the next scheduled check
+    };
+
     Server& _server;
     ServerResponder* _responder;
     bool _upgrade;
+    Phase _phase;
+    Activity _activity;
+    size_t _slot; ///< Index in the server's connection list
+
+    friend class Server;
 };
 
 
@@ -120,7 +178,7 @@ public:
 
     /// Factory method for instantiating the ServerConnection
     /// instance using the given Socket.
-    virtual ServerConnection::Ptr createConnection(Server& server, const net::TCPSocket::Ptr& socket)
+    virtual ServerConnection::Ptr createConnection(Server& server, const net::Socket::Ptr& socket)
     {
         return std::make_shared<ServerConnection>(server, socket);
     }
@@ -156,9 +214,54 @@ public:
     /// Shutdown the HTTP server.
     void shutdown();
 
+    /// Adopts a connected socket as a new server connection.
+    /// This allows the server to run over transports other than its
+    /// listening socket, such as a net::MemorySocket pair.
+    void accept(const net::Socket::Ptr& socket);
+
     /// Return the server bind address.
     net::Address& address();
 
+    /// Enables traffic counters on connections accepted from now on.
+    /// See net::Socket::enableStats().
+    void enableStats(bool flag = true);
+
+    /// Returns the traffic counters summed over all connections,
+    /// including those which have already closed.
+    net::SocketStats stats() const;
+
+    /// Returns the number of open connections.
+    size_t numConnections() const;
+
+    /// Sets the connection timeouts.
+    ///
+    /// Timeouts are checked by a single timer wheel per server, so a
+    /// connection is only visited when one of its deadlines is due.
+    /// Activity is sampled from the socket counters at each check, so a
+    /// connection may outlive its body or idle timeout by up to that
+    /// timeout again. Upgraded connections are only subject to the write
+    /// timeout, since their protocol manages its own liveness.
+    /// Applies to connections accepted from now on.
+    void setTimeouts(const ServerTimeouts& timeouts);
+
+    /// Returns the connection timeouts.
+    const ServerTimeouts& timeouts() const;
+
+    /// Returns the number of connections closed by each timeout.
+    const ServerTimeoutStats& timeoutStats() const;
+
+    /// Sets the permessage-deflate options for WebSocket connections.
+    /// Compression is disabled by default. Applies to connections
+    /// upgraded from now on.
+    void setWebSocketDeflate(const ws::DeflateOptions& options);
+
+    /// Returns the permessage-deflate options for WebSocket connections.
+    const ws::DeflateOptions& webSocketDeflate() const;
+
+    /// Returns the Date header field for the current time, including
+    /// the trailing CRLF. The field is rendered at most once per second.
+    const std::string& dateHeader();
+
     /// Signals when a new connection has been created.
     /// A reference to the new connection object is provided.
     Signal<void(ServerConnection::Ptr)> Connection;
@@ -172,15 +275,36 @@ protected:
     void onClientSocketAccept(const net::TCPSocket::Ptr& socket);
     void onConnectionReady(ServerConnection& conn);
     void onConnectionClose(ServerConnection& conn);
+    void onRequestBegin(ServerConnection& conn);
     void onSocketClose(net::Socket& socket);
     void onTimer();
 
+    /// Checks the given connection's deadlines, closing it if one has
+    /// expired or rescheduling the next check otherwise.
+    void checkTimeouts(const ServerConnection::Ptr& conn, std::uint64_t now);
+
+    /// Schedules a timeout check in `delay` milliseconds, unless one
+    /// is due sooner.
+    void scheduleTimeout(const ServerConnection::Ptr& conn, std::int64_t delay);
+
 protected:
     net::Address _address;
     net::TCPSocket::Ptr _socket;
     Timer _timer;
     ServerConnectionFactory* _factory;
-    std::vector<ServerConnection::Ptr> _connections;
+    std::vector<ServerConnection::Ptr> _connections; ///< Indexed by ServerConnection::_slot
+    net::SocketStats _closedStats;
+    bool _statsEnabled;
+    ServerTimeouts _timeouts;
+    ServerTimeoutStats _timeoutStats;
+    std::int64_t _resolution;
+    std::vector<std::vector<std::weak_ptr<ServerConnection>>> _wheel;
+    std::vector<std::weak_ptr<ServerConnection>> _due;
+    size_t _wheelPos;
+    std::uint64_t _tick; ///< Number of timer ticks since start
+    std::time_t _dateTime;
+    std::string _dateHeader;
+    ws::DeflateOptions _wsDeflate;
 
     friend class ServerConnection;
 };
@@ -19,6 +19,7 @@
 #include "scy/http/request.h"
 #include "scy/http/response.h"
 #include "scy/http/connection.h"
+#include "scy/http/websocketdeflate.h"
 #include "scy/net/socketemitter.h"
 #include "scy/net/socket.h"
 #include "scy/net/tcpsocket.h"
@@ -109,6 +110,16 @@ static std::string ProtocolGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 static std::string ProtocolVersion = "13";
 
 
+/// Applies the 4 byte masking key to `len` bytes of `src` and writes the
+/// result to `dst`, which may be the same as `src` to mask in place.
+/// The key is given in the order it appears in the frame header.
+///
+/// Masking and unmasking are the same operation. Blocks are processed
+/// with AVX2, SSE2 or NEON where the host supports them, and 64 bits at
+/// a time otherwise.
+HTTP_API void mask(const char* src, char* dst, size_t len, const char key[4]);
+
+
 //
 // WebSocket Framer
 //
@@ -136,8 +147,32 @@ public:
     /// Return true when the handshake has completed successfully.
     virtual uint64_t readFrame(BitReader& frame, char*& payload);
 
+    /// Reads frame data incrementally from the given buffer.
+    ///
+    /// Frame headers which are split across reads are buffered, while
+    /// payload is unmasked and returned in place without copying as it
+    /// arrives. Each call returns the next piece of the current frame's
+    /// payload, and frameRemaining() returns the number of payload bytes
+    /// still to come. The first piece is returned once the header has
+    /// been read, and is empty if no payload has arrived yet.
+    ///
+    /// Returns false when the buffer has been consumed.
+    /// Throws a std::runtime_error if the frame header is invalid.
+    virtual bool readFrameData(BitReader& frame, char*& payload, size_t& len);
+
     bool handshakeComplete() const;
 
+    /// Sets the permessage-deflate options offered by the client or
+    /// accepted by the server. Must be set before the handshake.
+    void setDeflateOptions(const DeflateOptions& options);
+
+    /// Returns the permessage-deflate options.
+    const DeflateOptions& deflateOptions() const;
+
+    /// Returns the compression state if permessage-deflate has been
+    /// negotiated, or nullptr otherwise.
+    PerMessageDeflate* deflate() const;
+
     //
     /// Server side
 
@@ -162,9 +197,17 @@ public:
 
 protected:
     /// Returns the frame flags of the most recently received frame.
-    /// Set by readFrame()
+    /// Set by readFrame() and readFrameData()
     int frameFlags() const;
 
+    /// Returns true if the data most recently returned by
+    /// readFrameData() begins a frame.
+    bool frameBegin() const;
+
+    /// Returns the number of payload bytes of the current frame which
+    /// have not been returned by readFrameData().
+    uint64_t frameRemaining() const;
+
     /// Returns true if the payload must be masched.
     /// Used by writeFrame()
     bool mustMaskPayload() const;
@@ -184,8 +227,19 @@ private:
     bool _maskPayload;
     Random _rnd;
     std::string _key; // client handshake key
+    char _frameHeader[MAX_HEADER_LENGTH]; ///< Header of the frame being read
+    size_t _frameHeaderSize;   ///< Header bytes buffered so far
+    bool _frameReading;        ///< Header parsed and payload being read
+    bool _frameMasked;
+    char _frameMask[4];
+    bool _frameBegin;          ///< Last payload returned begins a frame
+    uint64_t _frameLength;     ///< Payload length of the frame being read
+    uint64_t _frameRemaining;  ///< Payload bytes still to be read
+    DeflateOptions _deflateOptions;
+    std::unique_ptr<PerMessageDeflate> _deflate;
 
     friend class WebSocketAdapter;
+    friend class BroadcastGroup;
 };
 
 
@@ -205,6 +259,46 @@ public:
 
     virtual bool shutdown(uint16_t statusCode, const std::string& statusMessage);
 
+    /// Sets the permessage-deflate options.
+    /// See WebSocketFramer::setDeflateOptions()
+    /// The maxMessageSize option is replaced by maxMessageSize().
+    void setDeflateOptions(const DeflateOptions& options);
+
+    /// Returns the compression state if permessage-deflate has been
+    /// negotiated, or nullptr otherwise.
+    PerMessageDeflate* deflate() const;
+
+    /// Returns true if a frame with the given length and flags is sent
+    /// compressed, which is only the case for whole text or binary
+    /// messages once permessage-deflate has been negotiated.
+    bool shouldCompress(size_t len, int flags) const;
+
+    /// Delivers whole messages, reassembling frames which are split
+    /// across reads and continuation frames. Messages which arrive in a
+    /// single read are still delivered in place.
+    ///
+    /// By default payload is delivered as it arrives, and
+    /// messageComplete() tells when a message ends. Note that receivers
+    /// which parse each payload as a whole message, as was possible
+    /// while frames were only accepted whole, must enable this, since a
+    /// frame larger than a socket read now arrives in pieces.
+    void setReassembleMessages(bool flag);
+
+    /// Sets the largest message accepted, or 0 for no limit.
+    /// Larger messages are rejected as soon as their frame headers
+    /// arrive, and the socket is closed with an error.
+    /// Compressed messages are also limited to this size once inflated,
+    /// so this is the single limit for both.
+    /// The default is 16MB.
+    void setMaxMessageSize(size_t size);
+
+    bool reassembleMessages() const;
+    size_t maxMessageSize() const;
+
+    /// Returns true if the payload being delivered ends a message.
+    /// Control frames are always delivered whole.
+    bool messageComplete() const;
+
     /// Pointer to the underlying socket.
     /// Sent data will be proxied to this socket.
     net::Socket::Ptr socket;
@@ -234,11 +328,27 @@ public:
 protected:
     virtual ~WebSocketAdapter();
 
+    /// Handles payload returned by the framer, decompressing and
+    /// reassembling it as required. Returns true with the data to
+    /// deliver, or false if there is nothing to deliver yet.
+    virtual bool handleFrameData(char*& data, size_t& len);
+
     friend class WebSocketFramer;
+    friend class BroadcastGroup;
 
     WebSocketFramer framer;
     http::Request& _request;
     http::Response& _response;
+    Buffer _deflated;           ///< Compressed payload of the message being sent
+    Buffer _inflated;           ///< Decompressed payload of the frame being received
+    bool _inflating { false };  ///< Receiving the frames of a compressed message
+    Buffer _message;            ///< Message being reassembled
+    Buffer _control;            ///< Control frame split across reads
+    size_t _messageSize { 0 };  ///< Payload bytes received for the current message
+    size_t _maxMessageSize { 16 * 1024 * 1024 };
+    bool _reassemble { false };
+    bool _fragmented { false }; ///< Receiving the frames of a message
+    bool _messageComplete { false };
 };
 
 
@@ -0,0 +1,151 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup http
+/// @{
+
+
+#ifndef SCY_HTTP_WebSocketBroadcast_H
+#define SCY_HTTP_WebSocketBroadcast_H
+
+
+#include "scy/base.h"
+#include "scy/buffer.h"
+#include "scy/http/http.h"
+#include "scy/http/connection.h"
+#include "scy/http/websocket.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace scy {
+namespace http {
+namespace ws {
+
+
+/// What a BroadcastGroup does with a member whose write queue has
+/// grown beyond the group limit.
+enum class SlowMemberPolicy
+{
+    Queue, ///< Queue the message regardless of the backlog.
+    Skip,  ///< Drop the message for that member.
+    Close  ///< Close the member connection.
+};
+
+
+/// Delivery counters for a BroadcastGroup.
+struct BroadcastStats
+{
+    uint64_t messages { 0 };   ///< Messages broadcast
+    uint64_t delivered { 0 };  ///< Messages queued to members
+    uint64_t skipped { 0 };    ///< Messages dropped for slow members
+    uint64_t closed { 0 };     ///< Slow members closed
+    uint64_t failed { 0 };     ///< Sends which failed
+    uint64_t compressed { 0 }; ///< Messages compressed per member
+    uint64_t bytes { 0 };      ///< Bytes queued to members
+};
+
+
+/// Fans messages out to a group of server side WebSocket connections,
+/// such as the members of a chat room or the viewers of a live feed.
+///
+/// Each message is framed once into a reference counted buffer which
+/// is queued to every member, so the cost of a broadcast is one frame
+/// plus one write per member. Unmasked server frames are identical for
+/// all members, except for those which negotiated permessage-deflate;
+/// their messages are compressed with their own context as usual.
+///
+/// Members are held weakly and closed connections are removed during
+/// the next broadcast. Connections may be added or removed from within
+/// callbacks run by a broadcast.
+class HTTP_API BroadcastGroup
+{
+public:
+    BroadcastGroup(SlowMemberPolicy policy = SlowMemberPolicy::Skip,
+                   size_t maxQueueSize = 1024 * 1024);
+    virtual ~BroadcastGroup();
+
+    /// Adds a connection which has been upgraded to a WebSocket.
+    /// Returns false if it is not a server side WebSocket connection
+    /// or is already a member.
+    bool add(const Connection::Ptr& conn);
+
+    /// Removes a connection from the group.
+    /// Returns false if it is not a member.
+    bool remove(const Connection::Ptr& conn);
+
+    /// Returns true if the connection is a member.
+    bool has(const Connection::Ptr& conn) const;
+
+    /// Returns the number of members, including any which have
+    /// closed since the last broadcast.
+    size_t size() const;
+
+    /// Removes all members.
+    void clear();
+
+    /// Sends a message to every member.
+    /// Returns the number of members the message was queued to.
+    size_t broadcast(const char* data, size_t len, int flags = ws::SendFlags::Text);
+    size_t broadcast(const std::string& data, int flags = ws::SendFlags::Text);
+
+    /// Sets the policy for members whose write queue holds more than
+    /// `maxQueueSize` bytes.
+    void setSlowMemberPolicy(SlowMemberPolicy policy, size_t maxQueueSize);
+
+    SlowMemberPolicy slowMemberPolicy() const;
+    size_t maxQueueSize() const;
+
+    /// Returns the delivery counters.
+    const BroadcastStats& stats() const;
+
+    /// Resets the delivery counters.
+    void resetStats();
+
+protected:
+    struct Member
+    {
+        std::weak_ptr<Connection> conn;
+        Connection* key;
+    };
+
+    /// Returns the number of bytes waiting to be written to the socket.
+    static size_t queueSize(net::Socket& socket);
+
+    /// Frames the message once for all members.
+    std::shared_ptr<const Buffer> frame(const char* data, size_t len, int flags);
+
+    /// Removes the member at the given index, moving the last member
+    /// into its place.
+    void erase(size_t index);
+
+    WebSocketFramer _framer;
+    std::vector<Member> _members;
+    std::unordered_map<Connection*, size_t> _index;
+    SlowMemberPolicy _policy;
+    size_t _maxQueueSize;
+    BroadcastStats _stats;
+    bool _broadcasting;
+
+private:
+    BroadcastGroup(const BroadcastGroup&) = delete;
+    BroadcastGroup& operator=(const BroadcastGroup&) = delete;
+};
+
+
+} // namespace ws
+} // namespace http
+} // namespace scy
+
+
+#endif // SCY_HTTP_WebSocketBroadcast_H
+
+
+/// @\}
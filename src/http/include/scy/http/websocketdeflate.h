@@ -0,0 +1,149 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup http
+/// @{
+
+
+#ifndef SCY_HTTP_WebSocketDeflate_H
+#define SCY_HTTP_WebSocketDeflate_H
+
+
+#include "scy/base.h"
+#include "scy/buffer.h"
+#include "scy/http/http.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+struct z_stream_s;
+
+
+namespace scy {
+namespace http {
+namespace ws {
+
+
+/// Options for the permessage-deflate extension (RFC 7692).
+///
+/// Clients offer the extension with these parameters and servers accept
+/// the first offer compatible with them. Window bits range from 9 to 15,
+/// since zlib cannot produce raw deflate streams with an 8 bit window.
+///
+/// The maxMessageSize option applies where PerMessageDeflate is used
+/// directly. WebSocketAdapter replaces it with its own limit, see
+/// WebSocketAdapter::setMaxMessageSize().
+struct DeflateOptions
+{
+    bool enabled { false };                  ///< Offer or accept the extension
+    int level { -1 };                        ///< zlib compression level, or -1 for the default
+    int memLevel { 8 };                      ///< zlib memory level from 1 to 9
+    int serverMaxWindowBits { 15 };          ///< Window used to compress server messages
+    int clientMaxWindowBits { 15 };          ///< Window used to compress client messages
+    bool serverNoContextTakeover { false };  ///< Server resets its compressor after each message
+    bool clientNoContextTakeover { false };  ///< Client resets its compressor after each message
+    size_t threshold { 64 };                 ///< Smaller messages are sent uncompressed
+    size_t maxMessageSize { 16 * 1024 * 1024 }; ///< Largest inflated message, or 0 for no limit
+};
+
+
+/// Compression state for a WebSocket connection which has negotiated
+/// the permessage-deflate extension.
+///
+/// zlib contexts are allocated when first used. A compressor which must
+/// not take over its context is released after each message, as is a
+/// decompressor whose peer does not take over its context, so idle
+/// connections using no context takeover hold no zlib memory at all.
+/// Memory held by the contexts is accounted per instance and in total.
+class HTTP_API PerMessageDeflate
+{
+public:
+    /// Extension name used in the Sec-WebSocket-Extensions header.
+    static const char* Name;
+
+    /// Creates the compression state using the given options.
+    /// The client side must call accept() with the server response to
+    /// complete negotiation.
+    PerMessageDeflate(const DeflateOptions& options, bool server);
+    ~PerMessageDeflate();
+
+    /// Returns the extension offer for a client handshake request.
+    static std::string offer(const DeflateOptions& options);
+
+    /// Negotiates the extension from the Sec-WebSocket-Extensions header
+    /// of a client handshake request.
+    ///
+    /// Returns the state for the first offer compatible with the server
+    /// options and sets the response header value, or returns nullptr if
+    /// there is none.
+    static PerMessageDeflate* negotiate(const std::string& offers,
+                                        const DeflateOptions& options,
+                                        std::string& response);
+
+    /// Applies the parameters of the server response on the client side.
+    /// Throws a std::runtime_error if the response is not acceptable.
+    void accept(const std::string& response);
+
+    /// Compresses a whole message into `out`, replacing its contents.
+    /// The trailing empty block is removed as required by RFC 7692.
+    void compress(const char* data, size_t len, Buffer& out);
+
+    /// Decompresses a frame of a compressed message and appends the
+    /// result to `out`. The `fin` flag marks the final frame.
+    /// Throws a std::runtime_error if the data is invalid or the message
+    /// exceeds the maximum size.
+    void decompress(const char* data, size_t len, bool fin, Buffer& out);
+
+    /// Sets the largest inflated message, or 0 for no limit.
+    void setMaxMessageSize(size_t size);
+
+    /// Returns the negotiated options.
+    const DeflateOptions& options() const;
+
+    /// Returns the number of bytes held by this instance's zlib contexts.
+    size_t memoryUsage() const;
+
+    /// Returns the number of bytes held by all zlib contexts.
+    static size_t totalMemoryUsage();
+
+protected:
+    /// Parses the parameters of a single extension offer or response.
+    /// Returns false if a parameter is unknown, repeated or invalid.
+    static bool parse(const std::string& extension, DeflateOptions& params,
+                      bool& serverBits, bool& clientBits);
+
+    void releaseCompressor();
+    void releaseDecompressor();
+
+    static void* zalloc(void* opaque, unsigned items, unsigned size);
+    static void zfree(void* opaque, void* address);
+
+    DeflateOptions _options;
+    bool _server;
+    z_stream_s* _deflate;
+    z_stream_s* _inflate;
+    size_t _inflated; ///< Bytes inflated for the current message
+    size_t _memory;
+
+    static std::atomic<size_t> _totalMemory;
+
+private:
+    PerMessageDeflate(const PerMessageDeflate&) = delete;
+    PerMessageDeflate& operator=(const PerMessageDeflate&) = delete;
+};
+
+
+} // namespace ws
+} // namespace http
+} // namespace scy
+
+
+#endif // SCY_HTTP_WebSocketDeflate_H
+
+
+/// @\}
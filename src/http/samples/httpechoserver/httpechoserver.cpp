@@ -30,6 +30,8 @@ int main(int argc, char** argv)
     // runMulticoreEchoServers();
     raiseHTTPSEchoServer();
     // rlibuv::raiseBenchmarkServer();
+    // runConnectionChurnBenchmark();
+    // runResponseBenchmark();
 
 
     net::SSLManager::instance().shutdown();
@@ -1,7 +1,10 @@
+#include "scy/http/client.h"
 #include "scy/http/server.h"
+#include "scy/net/memorysocket.h"
 #include "scy/net/sslmanager.h"
 #include "scy/net/sslsocket.h"
 #include "scy/application.h"
+#include "scy/time.h"
 
 
 namespace scy {
@@ -150,4 +153,90 @@ void runMulticoreBenchmarkServers()
 }
 
 
+// -----------------------------------------------------------------------------
+// Response benchmark
+
+/// Issues requests over loopback TCP connections with a fixed number in
+/// flight, and reports the requests per second for a small response.
+void runResponseBenchmark(size_t numRequests = 20000, size_t concurrency = 32)
+{
+    http::Server srv(net::Address("127.0.0.1", HttpPort));
+    srv.enableStats();
+    srv.start();
+
+    srv.Connection += [](http::ServerConnection::Ptr conn) {
+        conn->response().setContentLength(14);
+        conn->send("hello universe", 14);
+    };
+
+    size_t numStarted = 0;
+    size_t numComplete = 0;
+    std::vector<http::ClientConnection::Ptr> conns;
+    conns.reserve(numRequests);
+    std::function<void()> request = [&]() {
+        auto conn = std::make_shared<http::ClientConnection>(
+            http::URL("http://127.0.0.1:" + std::to_string(HttpPort) + "/"));
+        auto ptr = conn.get();
+        conn->Complete += [&, ptr](const http::Response&) {
+            ptr->close();
+            if (++numComplete == numRequests)
+                srv.shutdown();
+            else if (numStarted < numRequests) {
+                numStarted++;
+                request();
+            }
+        };
+        conn->send();
+        conns.push_back(conn);
+    };
+
+    const uint64_t start = time::hrtime();
+    for (; numStarted < std::min(concurrency, numRequests); ++numStarted)
+        request();
+    uv::runLoop();
+    const uint64_t elapsed = time::hrtime() - start;
+
+    std::cout << "HTTP response benchmark (" << numComplete << "): "
+              << size_t(numComplete / (elapsed / 1e9)) << " requests/sec, "
+              << (srv.stats().packetsOut * 1.0 / numComplete) << " writes per response"
+              << std::endl;
+}
+
+
+// -----------------------------------------------------------------------------
+// Connection churn benchmark
+
+/// Opens and closes many connections over in-memory sockets to measure
+/// the server's connection bookkeeping without kernel or fd limits.
+void runConnectionChurnBenchmark(size_t numConnections = 50000)
+{
+    http::Server srv(address);
+    std::vector<net::MemorySocket::Ptr> clients;
+    clients.reserve(numConnections);
+
+    const uint64_t start = time::hrtime();
+    for (size_t i = 0; i < numConnections; ++i) {
+        auto pair = net::MemorySocket::createPair();
+        srv.accept(pair.second);
+        clients.push_back(pair.first);
+    }
+    const uint64_t opened = time::hrtime();
+
+    // Close every other connection first so removals are spread
+    // throughout the connection list rather than at either end.
+    for (size_t i = 0; i < numConnections; i += 2)
+        clients[i]->close();
+    for (size_t i = 1; i < numConnections; i += 2)
+        clients[i]->close();
+    uv::runLoop();
+    const uint64_t closed = time::hrtime();
+    assert(srv.numConnections() == 0);
+
+    std::cout << "HTTP connection churn (" << numConnections << "): "
+              << ((opened - start) / numConnections) << "ns per open, "
+              << ((closed - opened) / numConnections) << "ns per close"
+              << std::endl;
+}
+
+
 } // namespace scy
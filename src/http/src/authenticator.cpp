@@ -61,6 +61,8 @@ void Authenticator::authenticate(http::Request& request, const http::Response& r
 {
     for (http::Response::ConstIterator iter = response.find("WWW-Authenticate");
          iter != response.end(); ++iter) {
+        if (util::icompare(iter->first, "WWW-Authenticate") != 0)
+            continue;
         if (isBasicCredentials(iter->second)) {
             BasicAuthenticator(_username, _password).authenticate(request);
             return;
@@ -91,6 +93,8 @@ void Authenticator::proxyAuthenticate(http::Request& request, const http::Respon
 {
     for (http::Response::ConstIterator iter = response.find("Proxy-Authenticate");
          iter != response.end(); ++iter) {
+        if (util::icompare(iter->first, "Proxy-Authenticate") != 0)
+            continue;
         if (isBasicCredentials(iter->second)) {
             BasicAuthenticator(_username, _password).proxyAuthenticate(request);
             return;
@@ -26,7 +26,7 @@ namespace http {
 //
 
 
-ClientConnection::ClientConnection(const URL& url, const net::TCPSocket::Ptr& socket)
+ClientConnection::ClientConnection(const URL& url, const net::Socket::Ptr& socket)
     : Connection(socket)
     , _url(url)
     , _connect(false)
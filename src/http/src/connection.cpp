@@ -25,7 +25,7 @@ namespace scy {
 namespace http {
 
 
-Connection::Connection(const net::TCPSocket::Ptr& socket)
+Connection::Connection(const net::Socket::Ptr& socket)
     : _socket(socket)
     , _adapter(nullptr)
     //, _timeout(30 * 60 * 1000),
@@ -57,6 +57,16 @@ ssize_t Connection::send(const char* data, size_t len, int flags)
 }
 
 
+ssize_t Connection::sendv(const ConstBuffer* bufs, size_t nbufs, int flags)
+{
+    assert(!_closed);
+    if (_closed)
+        return -1;
+
+    return _adapter->sendv(bufs, nbufs, flags);
+}
+
+
 ssize_t Connection::sendHeader()
 {
     if (!_shouldSendHeader)
@@ -64,17 +74,60 @@ ssize_t Connection::sendHeader()
     _shouldSendHeader = false;
     assert(outgoingHeader());
 
-    // std::ostringstream os;
-    // outgoingHeader()->write(os);
-    // std::string head(os.str().c_str(), os.str().length());
-
-    std::string head;
-    head.reserve(256);
-    outgoingHeader()->write(head);
+    _header.clear();
+    writeHeader(_header);
 
     // Send headers directly to the Socket,
     // bypassing the ConnectionAdapter
-    return _socket->send(head.c_str(), head.length());
+    auto buf = constBuffer(_header);
+    return _socket->sendv(&buf, 1);
+}
+
+
+ssize_t Connection::sendHeader(const char* data, size_t len, int flags)
+{
+    auto buf = constBuffer(data, len);
+    if (sendHeader(&buf, 1, flags) < 0)
+        return -1;
+    return len;
+}
+
+
+ssize_t Connection::sendHeader(const ConstBuffer* bufs, size_t nbufs, int flags)
+{
+    if (!_shouldSendHeader)
+        return _socket->sendv(bufs, nbufs, flags);
+    _shouldSendHeader = false;
+    assert(outgoingHeader());
+
+    _header.clear();
+    writeHeader(_header);
+
+    // Submit the header and body together so small messages
+    // cost a single system call
+    static const size_t MAX_BUFS = 16;
+    if (nbufs >= MAX_BUFS) {
+        auto header = constBuffer(_header);
+        if (_socket->sendv(&header, 1, flags) < 0)
+            return -1;
+        return _socket->sendv(bufs, nbufs, flags);
+    }
+    ConstBuffer all[MAX_BUFS];
+    size_t len = 0;
+    all[0] = constBuffer(_header);
+    for (size_t i = 0; i < nbufs; i++) {
+        all[i + 1] = bufs[i];
+        len += bufs[i].size();
+    }
+    if (_socket->sendv(all, nbufs + 1, flags) < 0)
+        return -1;
+    return len;
+}
+
+
+void Connection::writeHeader(std::string& buf)
+{
+    outgoingHeader()->write(buf);
 }
 
 
@@ -181,7 +234,7 @@ Response& Connection::response()
 }
 
 
-net::TCPSocket::Ptr& Connection::socket()
+net::Socket::Ptr& Connection::socket()
 {
     return _socket;
 }
@@ -262,11 +315,17 @@ ssize_t ConnectionAdapter::send(const char* data, size_t len, int flags)
         // Send headers on initial send
         if (_connection &&
             _connection->shouldSendHeader()) {
-            ssize_t res = _connection->sendHeader();
 
             // The initial packet may be empty to push the headers through
             if (len == 0)
-                return res;
+                return _connection->sendHeader();
+
+            // Send the headers and body together if the body is not
+            // being sent through another adapter
+            if (sender() == _connection->socket().get())
+                return _connection->sendHeader(data, len, flags);
+
+            _connection->sendHeader();
         }
 
         // Other packets should not be empty
@@ -285,6 +344,25 @@ ssize_t ConnectionAdapter::send(const char* data, size_t len, int flags)
 }
 
 
+ssize_t ConnectionAdapter::sendv(const ConstBuffer* bufs, size_t nbufs, int flags)
+{
+    if (_connection &&
+        _connection->shouldSendHeader()) {
+
+        // Send the headers and body together if the body is not
+        // being sent through another adapter
+        if (sender() == _connection->socket().get())
+            return _connection->sendHeader(bufs, nbufs, flags);
+
+        _connection->sendHeader();
+    }
+
+    if (!sender())
+        return -1;
+    return sender()->sendv(bufs, nbufs, flags);
+}
+
+
 void ConnectionAdapter::removeReceiver(SocketAdapter* adapter)
 {
     if (_connection == adapter)
@@ -298,7 +376,8 @@ void ConnectionAdapter::onSocketRecv(net::Socket& socket, const MutableBuffer& b
 {
     // LTrace("On socket recv: ", buf.size())
 
-    if (_parser.complete()) {
+    // Requests on a keep-alive connection are parsed in turn
+    if (_parser.complete() && _parser.type() == HTTP_RESPONSE) {
         // Buggy HTTP servers might send late data or multiple responses,
         // in which case the parser state might already be HPE_OK.
         // In this case we discard the late message and log the error here,
@@ -316,12 +395,26 @@ void ConnectionAdapter::onSocketRecv(net::Socket& socket, const MutableBuffer& b
 //
 // Parser callbacks
 
+void ConnectionAdapter::onParserBegin()
+{
+    if (_connection)
+        _connection->onMessageBegin();
+}
+
+
 void ConnectionAdapter::onParserHeader(const std::string& /* name */,
                                        const std::string& /* value */)
 {
 }
 
 
+void ConnectionAdapter::onParserHeader(const ConstBuffer& /* name */,
+                                       const ConstBuffer& /* value */)
+{
+    // Headers are read from the message
+}
+
+
 void ConnectionAdapter::onParserHeadersEnd(bool upgrade)
 {
     // LTrace("On headers end: ", _parser.upgrade())
@@ -0,0 +1,618 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup http
+/// @{
+
+
+#include "scy/http/fileresponder.h"
+#include "scy/datetime.h"
+#include "scy/http/url.h"
+#include "scy/logger.h"
+#include "scy/net/tcpsocket.h"
+#include "scy/util.h"
+#include <fcntl.h>
+#include <limits>
+#include <sstream>
+#include <sys/stat.h>
+
+
+using std::endl;
+
+
+namespace scy {
+namespace http {
+
+
+namespace {
+
+
+/// Returns true if the If-None-Match field matches the entity tag.
+/// Entity tags are compared weakly as required for GET and HEAD.
+bool matchETag(const std::string& header, const std::string& etag)
+{
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos)
+            end = header.size();
+        size_t first = header.find_first_not_of(" \t", pos);
+        size_t last = end;
+        while (last > first && (header[last - 1] == ' ' || header[last - 1] == '\t'))
+            last--;
+        if (first < last) {
+            if (header.compare(first, last - first, "*") == 0)
+                return true;
+            if (last - first > 2 && header.compare(first, 2, "W/") == 0)
+                first += 2;
+            if (header.compare(first, last - first, etag) == 0)
+                return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+
+/// Reads a decimal number, returning false if there are no digits or
+/// the value overflows.
+bool readNumber(const char*& p, uint64_t& value)
+{
+    const char* start = p;
+    value = 0;
+    while (*p >= '0' && *p <= '9') {
+        if (value > (UINT64_MAX - 9) / 10)
+            return false;
+        value = value * 10 + static_cast<uint64_t>(*p++ - '0');
+    }
+    return p != start;
+}
+
+
+/// Parses a Range field holding a single byte range.
+/// Returns 1 if the range applies, 0 if the field should be ignored,
+/// or -1 if the range cannot be satisfied.
+int parseRange(const std::string& header, uint64_t size, uint64_t& offset, uint64_t& length)
+{
+    // Multiple ranges are answered with the whole file
+    if (header.compare(0, 6, "bytes=") != 0 || header.find(',') != std::string::npos)
+        return 0;
+
+    const char* p = header.c_str() + 6;
+    uint64_t first = 0;
+    uint64_t last = 0;
+    bool hasFirst = readNumber(p, first);
+    if (*p++ != '-')
+        return 0;
+    bool hasLast = readNumber(p, last);
+    if (*p != '\0')
+        return 0;
+
+    // A suffix range selects the last bytes of the file
+    if (!hasFirst) {
+        if (!hasLast)
+            return 0;
+        if (last == 0 || size == 0)
+            return -1;
+        offset = size - std::min(last, size);
+        length = size - offset;
+        return 1;
+    }
+
+    if (hasLast && last < first)
+        return 0;
+    if (first >= size)
+        return -1;
+    if (!hasLast || last >= size)
+        last = size - 1;
+    offset = first;
+    length = last - first + 1;
+    return 1;
+}
+
+
+} // namespace
+
+
+//
+// Cached File
+//
+
+
+CachedFile::CachedFile(uv::Loop* loop, uv_file fd)
+    : loop(loop)
+    , fd(fd)
+    , size(0)
+    , inode(0)
+    , mtime(0)
+{
+}
+
+
+CachedFile::~CachedFile()
+{
+    uv_fs_t req;
+    uv_fs_close(loop, &req, fd, nullptr);
+    uv_fs_req_cleanup(&req);
+}
+
+
+//
+// File Cache
+//
+
+
+FileCache::FileCache(uv::Loop* loop, size_t maxSize, std::int64_t revalidate)
+    : _loop(loop)
+    , _maxSize(maxSize)
+    , _revalidate(revalidate)
+{
+}
+
+
+FileCache::~FileCache()
+{
+}
+
+
+CachedFile::Ptr FileCache::open(const std::string& path)
+{
+    auto now = uv_now(_loop);
+    auto it = _index.find(path);
+    if (it != _index.end()) {
+        auto entry = it->second;
+        _entries.splice(_entries.begin(), _entries, entry);
+        if (_revalidate > 0 && now - entry->checkedAt < static_cast<std::uint64_t>(_revalidate))
+            return entry->file;
+
+        // Keep the open file unless it has been replaced or modified
+        uv_fs_t req;
+        int err = uv_fs_stat(_loop, &req, path.c_str(), nullptr);
+        auto& file = entry->file;
+        bool unchanged = err == 0 &&
+                         req.statbuf.st_ino == file->inode &&
+                         req.statbuf.st_size == file->size &&
+                         static_cast<std::time_t>(req.statbuf.st_mtim.tv_sec) == file->mtime;
+        uv_fs_req_cleanup(&req);
+        if (unchanged) {
+            entry->checkedAt = now;
+            return entry->file;
+        }
+        _entries.erase(entry);
+        _index.erase(it);
+    }
+
+    auto file = load(path);
+    if (!file || _maxSize == 0)
+        return file;
+
+    _entries.push_front(Entry{path, file, now});
+    _index[path] = _entries.begin();
+    evict();
+    return file;
+}
+
+
+CachedFile::Ptr FileCache::load(const std::string& path)
+{
+    uv_fs_t req;
+    int fd = uv_fs_open(_loop, &req, path.c_str(), O_RDONLY, 0, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (fd < 0)
+        return nullptr;
+
+    auto file = std::make_shared<CachedFile>(_loop, fd);
+    int err = uv_fs_fstat(_loop, &req, fd, nullptr);
+    bool regular = err == 0 && (req.statbuf.st_mode & S_IFMT) == S_IFREG;
+    file->size = req.statbuf.st_size;
+    file->inode = req.statbuf.st_ino;
+    file->mtime = static_cast<std::time_t>(req.statbuf.st_mtim.tv_sec);
+    uv_fs_req_cleanup(&req);
+    if (!regular)
+        return nullptr;
+
+    std::ostringstream etag;
+    etag << '"' << std::hex << file->mtime << '-' << file->size << '"';
+    file->etag = etag.str();
+    file->lastModified = DateTimeFormatter::format(
+        Timestamp::fromEpochTime(file->mtime), DateTimeFormat::HTTP_FORMAT);
+    file->contentType = contentType(path);
+    return file;
+}
+
+
+void FileCache::remove(const std::string& path)
+{
+    auto it = _index.find(path);
+    if (it != _index.end()) {
+        _entries.erase(it->second);
+        _index.erase(it);
+    }
+}
+
+
+void FileCache::clear()
+{
+    _entries.clear();
+    _index.clear();
+}
+
+
+void FileCache::setMaxSize(size_t size)
+{
+    _maxSize = size;
+    evict();
+}
+
+
+size_t FileCache::maxSize() const
+{
+    return _maxSize;
+}
+
+
+void FileCache::setRevalidate(std::int64_t milliseconds)
+{
+    _revalidate = milliseconds;
+}
+
+
+std::int64_t FileCache::revalidate() const
+{
+    return _revalidate;
+}
+
+
+size_t FileCache::size() const
+{
+    return _entries.size();
+}
+
+
+void FileCache::evict()
+{
+    while (_entries.size() > _maxSize) {
+        _index.erase(_entries.back().path);
+        _entries.pop_back();
+    }
+}
+
+
+const char* FileCache::contentType(const std::string& path)
+{
+    static const struct
+    {
+        const char* ext;
+        const char* type;
+    } types[] = {
+        { "html", "text/html" },
+        { "htm", "text/html" },
+        { "css", "text/css" },
+        { "js", "application/javascript" },
+        { "mjs", "application/javascript" },
+        { "json", "application/json" },
+        { "txt", "text/plain" },
+        { "xml", "application/xml" },
+        { "svg", "image/svg+xml" },
+        { "png", "image/png" },
+        { "jpg", "image/jpeg" },
+        { "jpeg", "image/jpeg" },
+        { "gif", "image/gif" },
+        { "webp", "image/webp" },
+        { "ico", "image/x-icon" },
+        { "woff", "font/woff" },
+        { "woff2", "font/woff2" },
+        { "wasm", "application/wasm" },
+        { "pdf", "application/pdf" },
+        { "mp4", "video/mp4" },
+        { "m4v", "video/mp4" },
+        { "webm", "video/webm" },
+        { "mkv", "video/x-matroska" },
+        { "ts", "video/mp2t" },
+        { "m3u8", "application/vnd.apple.mpegurl" },
+        { "mpd", "application/dash+xml" },
+        { "mp3", "audio/mpeg" },
+        { "m4a", "audio/mp4" },
+        { "aac", "audio/aac" },
+        { "ogg", "audio/ogg" },
+        { "opus", "audio/opus" },
+        { "wav", "audio/wav" },
+    };
+
+    size_t dot = path.find_last_of("./");
+    if (dot != std::string::npos && path[dot] == '.') {
+        std::string ext(path.substr(dot + 1));
+        for (auto& entry : types) {
+            if (util::icompare(ext, entry.ext) == 0)
+                return entry.type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+
+//
+// File Responder
+//
+
+
+const size_t FileResponder::ChunkSize;
+
+
+/// State of a body which is read through user space.
+struct FileResponder::Transfer
+{
+    uv_fs_t req;
+    FileResponder* responder;
+    std::shared_ptr<bool> alive;
+    CachedFile::Ptr file;
+    Buffer buffer;
+    uint64_t offset;
+    uint64_t remaining;
+};
+
+
+FileResponder::FileResponder(ServerConnection& connection, const std::string& root, FileCache& cache)
+    : ServerResponder(connection)
+    , _root(root)
+    , _cache(cache)
+    , _alive(std::make_shared<bool>(true))
+{
+    // Paths are resolved by appending the request path
+    while (!_root.empty() && (_root.back() == '/' || _root.back() == '\\'))
+        _root.pop_back();
+}
+
+
+FileResponder::~FileResponder()
+{
+    *_alive = false;
+}
+
+
+void FileResponder::onClose()
+{
+    *_alive = false;
+}
+
+
+bool FileResponder::resolve(const std::string& uri, std::string& path) const
+{
+    std::string target(URL::decode(uri.substr(0, uri.find_first_of("?#"))));
+    if (target.empty() || target[0] != '/' ||
+        target.find_first_of(std::string("\\\0", 2)) != std::string::npos)
+        return false;
+
+    // Reject parent directory segments
+    for (size_t start = 1, end; start <= target.size(); start = end + 1) {
+        end = target.find('/', start);
+        if (end == std::string::npos)
+            end = target.size();
+        if (target.compare(start, end - start, "..") == 0)
+            return false;
+    }
+
+    path = _root + target;
+    if (target.back() == '/')
+        path += "index.html";
+    return true;
+}
+
+
+void FileResponder::onRequest(Request& request, Response& response)
+{
+    // Keep the connection open for further requests unless the client
+    // asked for it to be closed
+    response.setKeepAlive(request.getKeepAlive());
+
+    const bool head = request.getMethod() == Method::Head;
+    if (!head && request.getMethod() != Method::Get) {
+        response.set("Allow", "GET, HEAD");
+        return sendStatus(StatusCode::MethodNotAllowed);
+    }
+
+    std::string path;
+    if (!resolve(request.getURI(), path))
+        return sendStatus(StatusCode::BadRequest);
+
+    auto file = _cache.open(path);
+    if (!file)
+        return sendStatus(StatusCode::NotFound);
+
+    response.set("ETag", file->etag);
+    response.set("Last-Modified", file->lastModified);
+    response.set("Accept-Ranges", "bytes");
+
+    // If-None-Match takes precedence over If-Modified-Since
+    bool notModified = false;
+    auto match = request.find("If-None-Match");
+    auto since = request.find("If-Modified-Since");
+    if (match != request.end())
+        notModified = matchETag(match->second, file->etag);
+    else if (since != request.end()) {
+        DateTime time;
+        int tzd;
+        notModified = DateTimeParser::tryParse(DateTimeFormat::HTTP_FORMAT, since->second, time, tzd) &&
+                      time.timestamp().epochTime() >= file->mtime;
+    }
+    if (notModified)
+        return sendStatus(StatusCode::NotModified);
+
+    uint64_t offset = 0;
+    uint64_t length = file->size;
+    auto range = request.find("Range");
+    if (range != request.end()) {
+        int res = parseRange(range->second, file->size, offset, length);
+        if (res < 0) {
+            response.set("Content-Range", "bytes */" + std::to_string(file->size));
+            return sendStatus(StatusCode::RangeNotSatisfiable);
+        }
+        if (res > 0) {
+            response.setStatus(StatusCode::PartialContent);
+            response.set("Content-Range", "bytes " + std::to_string(offset) + "-" +
+                                              std::to_string(offset + length - 1) + "/" +
+                                              std::to_string(file->size));
+        }
+    }
+
+    response.setContentType(file->contentType);
+    response.setContentLength(length);
+    if (_connection.sendHeader() < 0)
+        return;
+    if (head || length == 0)
+        return finish();
+
+    sendBody(file, offset, length);
+}
+
+
+void FileResponder::sendStatus(StatusCode status)
+{
+    auto& response = _connection.response();
+    response.setStatus(status);
+    if (status != StatusCode::NotModified)
+        response.setContentLength(0);
+    if (_connection.sendHeader() >= 0)
+        finish();
+}
+
+
+void FileResponder::sendBody(const CachedFile::Ptr& file, uint64_t offset, uint64_t length)
+{
+    // Send from the page cache where the socket allows it. The callback
+    // holds a reference to the file so it stays open until done.
+    auto tcp = dynamic_cast<net::TCPSocket*>(_connection.socket().get());
+    if (tcp && length <= std::numeric_limits<size_t>::max()) {
+        auto alive = _alive;
+        bool sending = tcp->sendFile(file->fd, static_cast<int64_t>(offset), static_cast<size_t>(length),
+            [this, alive, file, length](int64_t result) {
+                if (!*alive)
+                    return;
+                if (result == static_cast<int64_t>(length))
+                    finish();
+                else {
+                    LDebug("File transfer failed: ", result < 0 ? uv_strerror(static_cast<int>(result)) : "short write")
+                    _connection.close();
+                }
+            });
+        if (sending)
+            return;
+    }
+
+    auto transfer = new Transfer;
+    transfer->req.data = transfer;
+    transfer->responder = this;
+    transfer->alive = _alive;
+    transfer->file = file;
+    transfer->buffer.resize(static_cast<size_t>(std::min<uint64_t>(length, ChunkSize)));
+    transfer->offset = offset;
+    transfer->remaining = length;
+    readNext(transfer);
+}
+
+
+void FileResponder::readNext(Transfer* transfer)
+{
+    auto buf = uv_buf_init(transfer->buffer.data(), static_cast<unsigned>(
+        std::min<uint64_t>(transfer->remaining, transfer->buffer.size())));
+    int err = uv_fs_read(_connection.socket()->loop(), &transfer->req, transfer->file->fd,
+        &buf, 1, static_cast<int64_t>(transfer->offset), [](uv_fs_t* req) {
+            auto transfer = reinterpret_cast<Transfer*>(req->data);
+            auto result = req->result;
+            uv_fs_req_cleanup(req);
+
+            // The responder is gone if the connection has closed
+            auto responder = transfer->responder;
+            if (!*transfer->alive)
+                return delete transfer;
+            if (result <= 0) {
+                delete transfer;
+                return responder->_connection.close();
+            }
+            if (responder->_connection.socket()->send(transfer->buffer.data(), result) < 0)
+                return delete transfer;
+
+            transfer->offset += result;
+            transfer->remaining -= result;
+            if (transfer->remaining == 0) {
+                delete transfer;
+                return responder->finish();
+            }
+
+            // Read the next chunk once this one has been written
+            responder->afterWrite([transfer](bool ok) {
+                if (ok)
+                    transfer->responder->readNext(transfer);
+                else
+                    delete transfer;
+            });
+        });
+    if (err) {
+        delete transfer;
+        _connection.close();
+    }
+}
+
+
+void FileResponder::afterWrite(std::function<void(bool ok)> func)
+{
+    // Queue an empty write behind the pending data, since its callback
+    // is invoked once everything before it has been written.
+    auto tcp = dynamic_cast<net::TCPSocket*>(_connection.socket().get());
+    if (tcp && tcp->writeQueueSize() > 0) {
+        auto buf = constBuffer("", 0);
+        tcp->writev(&buf, 1, [alive = _alive, func](int status) {
+            func(!status && *alive);
+        });
+    }
+    else
+        func(true);
+}
+
+
+void FileResponder::finish()
+{
+    // Persistent connections are left idle for the next request
+    if (_connection.response().getKeepAlive())
+        return;
+
+    afterWrite([this](bool ok) {
+        if (ok)
+            _connection.close();
+    });
+}
+
+
+//
+// File Responder Factory
+//
+
+
+FileResponderFactory::FileResponderFactory(const std::string& root, uv::Loop* loop)
+    : _root(root)
+    , _cache(loop)
+{
+}
+
+
+ServerResponder* FileResponderFactory::createResponder(ServerConnection& connection)
+{
+    return new FileResponder(connection, _root, _cache);
+}
+
+
+FileCache& FileResponderFactory::cache()
+{
+    return _cache;
+}
+
+
+} // namespace http
+} // namespace scy
+
+
+/// @\}
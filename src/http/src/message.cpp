@@ -29,6 +29,10 @@ const std::string Message::CONNECTION = "Connection";
 const std::string Message::CONNECTION_KEEP_ALIVE = "Keep-Alive";
 const std::string Message::CONNECTION_CLOSE = "Close";
 const std::string Message::EMPTY;
+const std::uint32_t Message::CONTENT_LENGTH_HASH = NVCollection::hash("Content-Length", 14);
+const std::uint32_t Message::CONTENT_TYPE_HASH = NVCollection::hash("Content-Type", 12);
+const std::uint32_t Message::TRANSFER_ENCODING_HASH = NVCollection::hash("Transfer-Encoding", 17);
+const std::uint32_t Message::CONNECTION_HASH = NVCollection::hash("Connection", 10);
 
 
 Message::Message()
@@ -57,15 +61,15 @@ void Message::setVersion(const std::string& version)
 void Message::setContentLength(uint64_t length)
 {
     if (int(length) != UNKNOWN_CONTENT_LENGTH)
-        set(CONTENT_LENGTH, util::itostr<uint64_t>(length));
+        set(CONTENT_LENGTH, CONTENT_LENGTH_HASH, util::itostr<uint64_t>(length));
     else
-        erase(CONTENT_LENGTH);
+        erase(CONTENT_LENGTH, CONTENT_LENGTH_HASH);
 }
 
 
 uint64_t Message::getContentLength() const
 {
-    const std::string& contentLength = get(CONTENT_LENGTH, EMPTY);
+    const std::string& contentLength = get(CONTENT_LENGTH, CONTENT_LENGTH_HASH, EMPTY);
     if (!contentLength.empty()) {
         return util::strtoi<uint64_t>(contentLength);
     } else
@@ -76,15 +80,15 @@ uint64_t Message::getContentLength() const
 void Message::setTransferEncoding(const std::string& transferEncoding)
 {
     if (util::icompare(transferEncoding, IDENTITY_TRANSFER_ENCODING) == 0)
-        erase(TRANSFER_ENCODING);
+        erase(TRANSFER_ENCODING, TRANSFER_ENCODING_HASH);
     else
-        set(TRANSFER_ENCODING, transferEncoding);
+        set(TRANSFER_ENCODING, TRANSFER_ENCODING_HASH, transferEncoding);
 }
 
 
 const std::string& Message::getTransferEncoding() const
 {
-    return get(TRANSFER_ENCODING, IDENTITY_TRANSFER_ENCODING);
+    return get(TRANSFER_ENCODING, TRANSFER_ENCODING_HASH, IDENTITY_TRANSFER_ENCODING);
 }
 
 
@@ -106,30 +110,30 @@ bool Message::isChunkedTransferEncoding() const
 void Message::setContentType(const std::string& contentType)
 {
     if (contentType.empty())
-        erase(CONTENT_TYPE);
+        erase(CONTENT_TYPE, CONTENT_TYPE_HASH);
     else
-        set(CONTENT_TYPE, contentType);
+        set(CONTENT_TYPE, CONTENT_TYPE_HASH, contentType);
 }
 
 
 const std::string& Message::getContentType() const
 {
-    return get(CONTENT_TYPE, UNKNOWN_CONTENT_TYPE);
+    return get(CONTENT_TYPE, CONTENT_TYPE_HASH, UNKNOWN_CONTENT_TYPE);
 }
 
 
 void Message::setKeepAlive(bool keepAlive)
 {
     if (keepAlive)
-        set(CONNECTION, CONNECTION_KEEP_ALIVE);
+        set(CONNECTION, CONNECTION_HASH, CONNECTION_KEEP_ALIVE);
     else
-        set(CONNECTION, CONNECTION_CLOSE);
+        set(CONNECTION, CONNECTION_HASH, CONNECTION_CLOSE);
 }
 
 
 bool Message::getKeepAlive() const
 {
-    const std::string& connection = get(CONNECTION, EMPTY);
+    const std::string& connection = get(CONNECTION, CONNECTION_HASH, EMPTY);
     if (!connection.empty())
         return util::icompare(connection, CONNECTION_CLOSE) != 0;
     else
@@ -145,7 +149,7 @@ const std::string& Message::getVersion() const
 
 bool Message::hasContentLength() const
 {
-    return has(CONTENT_LENGTH);
+    return find(CONTENT_LENGTH, CONTENT_LENGTH_HASH) != end();
 }
 
 
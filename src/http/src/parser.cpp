@@ -29,6 +29,7 @@ Parser::Parser(http::Response* response)
     , _request(nullptr)
     , _response(response)
     , _type(HTTP_RESPONSE)
+    , _storeHeaders(true)
 {
     init();
     reset();
@@ -40,6 +41,7 @@ Parser::Parser(http::Request* request)
     , _request(request)
     , _response(nullptr)
     , _type(HTTP_REQUEST)
+    , _storeHeaders(true)
 {
     init();
     reset();
@@ -51,6 +53,7 @@ Parser::Parser(http_parser_type type)
     , _request(nullptr)
     , _response(nullptr)
     , _type(type)
+    , _storeHeaders(true)
 {
     init();
     reset();
@@ -85,12 +88,18 @@ size_t Parser::parse(const char* data, size_t len)
 {
     // LTrace("Parse: ", len)
 
-    if (_complete) {
+    // Requests may follow each other on a keep-alive connection
+    if (_complete && (_type != HTTP_REQUEST || _error.any())) {
         throw std::runtime_error("HTTP parser already complete");
     }
 
     size_t nparsed = ::http_parser_execute(&_parser, &_settings, data, len);
 
+    // Tokens split across reads must not point into the caller's buffer
+    _url.detach();
+    _headerField.detach();
+    _headerValue.detach();
+
     if (_parser.upgrade) {
         // The parser has only parsed the HTTP headers, there
         // may still be unread data from the request body in the buffer.
@@ -111,6 +120,10 @@ void Parser::reset()
 {
     _complete = false;
     _upgrade = false;
+    _wasHeaderValue = false;
+    _url.clear();
+    _headerField.clear();
+    _headerValue.clear();
     //_shouldKeepAlive = false;
     _error.reset();
 }
@@ -140,6 +153,12 @@ void Parser::setObserver(ParserObserver* observer)
 }
 
 
+void Parser::setStoreHeaders(bool flag)
+{
+    _storeHeaders = flag;
+}
+
+
 http::Message* Parser::message()
 {
     return _request ? reinterpret_cast<http::Message*>(_request)
@@ -166,10 +185,25 @@ bool Parser::upgrade() const
 }
 
 
+http_parser_type Parser::type() const
+{
+    return _type;
+}
+
+
 //
 // Callbacks
 
 
+void Parser::onMessageBegin()
+{
+    // LTrace("On message begin")
+    reset();
+    if (_observer)
+        _observer->onParserBegin();
+}
+
+
 void Parser::onURL(const std::string& value)
 {
     // LTrace("onURL: ", value)
@@ -179,17 +213,80 @@ void Parser::onURL(const std::string& value)
 }
 
 
-void Parser::onHeader(const std::string& name, const std::string& value)
+void Parser::onHeader(const ConstBuffer& name, const ConstBuffer& value)
 {
-    // LTrace("On header: ",  name,  ":", value)
+    // LTrace("On header: ",  name.str(),  ":", value.str())
 
-    if (message())
-        message()->add(name, value);
     if (_observer)
         _observer->onParserHeader(name, value);
 }
 
 
+void Parser::flushURL()
+{
+    if (_url.empty())
+        return;
+    onURL(_url.str());
+    _url.clear();
+}
+
+
+void Parser::flushHeader()
+{
+    if (_headerField.empty())
+        return;
+
+    // Report the spans, and build strings only for the message
+    ConstBuffer name(_headerField.buffer());
+    ConstBuffer value(_headerValue.buffer());
+    onHeader(name, value);
+    if (_storeHeaders && message())
+        message()->add(name.str(), value.str());
+    _headerField.clear();
+    _headerValue.clear();
+}
+
+
+//
+// Tokens
+
+
+void Parser::Token::append(const char* data, size_t size)
+{
+    if (size == 0)
+        return;
+    if (copied)
+        copy.append(data, size);
+    else if (at && at + len != data) {
+        // Not contiguous with the existing data, so take a copy
+        copy.assign(at, len);
+        copy.append(data, size);
+        copied = true;
+    }
+    else if (!at)
+        at = data;
+    len += size;
+}
+
+
+void Parser::Token::detach()
+{
+    if (at && !copied) {
+        copy.assign(at, len);
+        copied = true;
+    }
+}
+
+
+void Parser::Token::clear()
+{
+    at = nullptr;
+    len = 0;
+    copy.clear();
+    copied = false;
+}
+
+
 void Parser::onHeadersEnd()
 {
     _upgrade = _parser.upgrade > 0;
@@ -242,7 +339,7 @@ int Parser::on_message_begin(http_parser* parser)
     auto self = reinterpret_cast<Parser*>(parser->data);
     assert(self);
 
-    self->reset();
+    self->onMessageBegin();
     return 0;
 }
 
@@ -251,9 +348,7 @@ int Parser::on_url(http_parser* parser, const char* at, size_t len)
 {
     auto self = reinterpret_cast<Parser*>(parser->data);
     assert(self);
-    assert(at && len);
-
-    self->onURL(std::string(at, len));
+    self->_url.append(at, len);
     return 0;
 }
 
@@ -277,16 +372,12 @@ int Parser::on_header_field(http_parser* parser, const char* at, size_t len)
     assert(self);
 
     if (self->_wasHeaderValue) {
-        if (!self->_lastHeaderField.empty()) {
-            self->onHeader(self->_lastHeaderField, self->_lastHeaderValue);
-            self->_lastHeaderValue.clear();
-        }
-        self->_lastHeaderField = std::string(at, len);
+        self->flushHeader();
         self->_wasHeaderValue = false;
-    } else {
-        self->_lastHeaderField += std::string(at, len);
     }
-
+    else
+        self->flushURL();
+    self->_headerField.append(at, len);
     return 0;
 }
 
@@ -296,13 +387,8 @@ int Parser::on_header_value(http_parser* parser, const char* at, size_t len)
     auto self = reinterpret_cast<Parser*>(parser->data);
     assert(self);
 
-    if (!self->_wasHeaderValue) {
-        self->_lastHeaderValue = std::string(at, len);
-        self->_wasHeaderValue = true;
-    } else {
-        self->_lastHeaderValue += std::string(at, len);
-    }
-
+    self->_headerValue.append(at, len);
+    self->_wasHeaderValue = true;
     return 0;
 }
 
@@ -313,9 +399,8 @@ int Parser::on_headers_complete(http_parser* parser)
     assert(self);
 
     // Add last entry if any
-    if (!self->_lastHeaderField.empty()) {
-        self->onHeader(self->_lastHeaderField, self->_lastHeaderValue);
-    }
+    self->flushURL();
+    self->flushHeader();
 
     // HTTP version
     // start_line_.version(parser_.http_major, parser_.http_minor);
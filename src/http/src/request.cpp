@@ -131,10 +131,9 @@ void Request::setCookies(const NVCollection& cookies)
 
 void Request::getCookies(NVCollection& cookies) const
 {
-    NVCollection::ConstIterator it = find("Cookie");
-    while (it != end() && util::icompare(it->first, "Cookie") == 0) {
-        http::splitParameters(it->second.begin(), it->second.end(), cookies);
-        ++it;
+    for (NVCollection::ConstIterator it = find("Cookie"); it != end(); ++it) {
+        if (util::icompare(it->first, "Cookie") == 0)
+            http::splitParameters(it->second.begin(), it->second.end(), cookies);
     }
 }
 
@@ -21,6 +21,61 @@ namespace scy {
 namespace http {
 
 
+namespace {
+
+
+/// Pre-rendered HTTP/1.1 status lines for the commonly sent statuses.
+struct StatusLines
+{
+    static const int MIN_CODE = 100;
+    static const int MAX_CODE = 599;
+
+    std::string lines[MAX_CODE - MIN_CODE + 1];
+
+    StatusLines()
+    {
+        for (StatusCode status : {
+                StatusCode::SwitchingProtocols, StatusCode::OK,
+                StatusCode::Created, StatusCode::NoContent,
+                StatusCode::PartialContent, StatusCode::MovedPermanently,
+                StatusCode::Found, StatusCode::NotModified,
+                StatusCode::BadRequest, StatusCode::Unauthorized,
+                StatusCode::Forbidden, StatusCode::NotFound,
+                StatusCode::RangeNotSatisfiable,
+                StatusCode::InternalServerError, StatusCode::Unavailable }) {
+            const int code = static_cast<int>(status);
+            lines[code - MIN_CODE] = Message::HTTP_1_1 + " " +
+                std::to_string(code) + " " + getStatusCodeReason(status) + "\r\n";
+        }
+    }
+
+    /// Returns the rendered line for the given status and reason,
+    /// or nullptr if it has not been rendered.
+    const std::string* find(StatusCode status, const std::string& reason) const
+    {
+        int code = static_cast<int>(status);
+        if (code < MIN_CODE || code > MAX_CODE)
+            return nullptr;
+        const std::string& line = lines[code - MIN_CODE];
+        const size_t prefix = Message::HTTP_1_1.size() + 5; // "HTTP/1.1 200 "
+        if (line.size() != prefix + reason.size() + 2 ||
+            line.compare(prefix, reason.size(), reason) != 0)
+            return nullptr;
+        return &line;
+    }
+};
+
+
+const StatusLines& statusLines()
+{
+    static const StatusLines lines;
+    return lines;
+}
+
+
+} // namespace
+
+
 Response::Response()
     : _status(StatusCode::OK)
     , _reason(getStatusCodeReason(StatusCode::OK))
@@ -107,12 +162,12 @@ void Response::addCookie(const Cookie& cookie)
 void Response::getCookies(std::vector<Cookie>& cookies) const
 {
     cookies.clear();
-    NVCollection::ConstIterator it = find("Set-Cookie");
-    while (it != end() && util::icompare(it->first, "Set-Cookie") == 0) {
+    for (NVCollection::ConstIterator it = find("Set-Cookie"); it != end(); ++it) {
+        if (util::icompare(it->first, "Set-Cookie") != 0)
+            continue;
         NVCollection nvc;
         http::splitParameters(it->second.begin(), it->second.end(), nvc);
         cookies.push_back(Cookie(nvc));
-        ++it;
     }
 }
 
@@ -126,6 +181,19 @@ void Response::write(std::ostream& ostr) const
 
 
 void Response::write(std::string& str) const
+{
+    const std::string* line = _version == HTTP_1_1
+        ? statusLines().find(_status, _reason) : nullptr;
+    if (line)
+        str.append(*line);
+    else
+        writeStatusLine(str);
+    http::Message::write(str);
+    str.append("\r\n");
+}
+
+
+void Response::writeStatusLine(std::string& str) const
 {
     str.append(_version);
     str.append(" ");
@@ -133,8 +201,6 @@ void Response::write(std::string& str) const
     str.append(" ");
     str.append(_reason);
     str.append("\r\n");
-    http::Message::write(str);
-    str.append("\r\n");
 }
 
 
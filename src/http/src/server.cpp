@@ -14,6 +14,9 @@
 #include "scy/logger.h"
 #include "scy/util.h"
 
+#include <algorithm>
+#include <limits>
+
 
 using std::endl;
 
@@ -22,11 +25,41 @@ namespace scy {
 namespace http {
 
 
+namespace {
+
+
+/// Number of slots in the timeout wheel. Checks due beyond one
+/// revolution are made at the end of it and rescheduled.
+const size_t TIMEOUT_WHEEL_SLOTS = 512;
+
+
+/// Returns the timer wheel tick for the given timeouts, which is half
+/// the shortest timeout within the range of 10ms to 1s.
+std::int64_t timeoutResolution(const ServerTimeouts& timeouts)
+{
+    std::int64_t shortest = 2000;
+    for (auto timeout : { timeouts.header, timeouts.body, timeouts.idle, timeouts.write }) {
+        if (timeout > 0)
+            shortest = std::min(shortest, timeout);
+    }
+    return std::max<std::int64_t>(10, shortest / 2);
+}
+
+
+} // namespace
+
+
 Server::Server(const std::string& host, short port, net::TCPSocket::Ptr socket, ServerConnectionFactory* factory)
     : _address(host, port)
     , _socket(socket)
-    , _timer(5000, 5000, socket->loop())
+    , _timer(socket->loop())
     , _factory(factory)
+    , _statsEnabled(false)
+    , _resolution(timeoutResolution(_timeouts))
+    , _wheel(TIMEOUT_WHEEL_SLOTS)
+    , _wheelPos(0)
+    , _tick(0)
+    , _dateTime(0)
 {
     // LTrace("Create")
 }
@@ -35,8 +68,14 @@ Server::Server(const std::string& host, short port, net::TCPSocket::Ptr socket,
 Server::Server(const net::Address& address, net::TCPSocket::Ptr socket, ServerConnectionFactory* factory)
     : _address(address)
     , _socket(socket)
-    , _timer(5000, 5000, socket->loop())
+    , _timer(socket->loop())
     , _factory(factory)
+    , _statsEnabled(false)
+    , _resolution(timeoutResolution(_timeouts))
+    , _wheel(TIMEOUT_WHEEL_SLOTS)
+    , _wheelPos(0)
+    , _tick(0)
+    , _dateTime(0)
 {
     // LTrace("Create")
 }
@@ -61,6 +100,8 @@ void Server::start()
     LDebug("HTTP server listening on ", _address)
 
     _timer.Timeout += slot(this, &Server::onTimer);
+    _timer.setTimeout(_resolution);
+    _timer.setInterval(_resolution);
     _timer.start();
 }
 
@@ -76,6 +117,8 @@ void Server::shutdown()
     }
 
     _timer.stop();
+    for (auto& slot : _wheel)
+        slot.clear();
 
     Shutdown.emit();
 }
@@ -94,9 +137,29 @@ void Server::onClientSocketAccept(const net::TCPSocket::Ptr& socket)
 {
     // LTrace("On accept socket connection")
 
+    accept(socket);
+}
+
+
+void Server::accept(const net::Socket::Ptr& socket)
+{
+    // Activity for the body and idle timeouts is read from the counters
+    bool timeouts = _timeouts.header > 0 || _timeouts.body > 0 ||
+                    _timeouts.idle > 0 || _timeouts.write > 0;
+    if (_statsEnabled || timeouts)
+        socket->enableStats();
     ServerConnection::Ptr conn = _factory->createConnection(*this, socket);
     conn->Close += slot(this, &Server::onConnectionClose);
+    conn->_slot = _connections.size();
     _connections.push_back(conn);
+
+    if (timeouts) {
+        auto now = uv_now(socket->loop());
+        conn->_activity.requestStartedAt = now;
+        conn->_activity.recvAt = now;
+        conn->_activity.sendAt = now;
+        scheduleTimeout(conn, _timeouts.header > 0 ? _timeouts.header : _resolution);
+    }
 }
 
 
@@ -104,12 +167,8 @@ void Server::onConnectionReady(ServerConnection& conn)
 {
     // LTrace("On connection ready")
 
-    for (auto it = _connections.begin(); it != _connections.end(); ++it) {
-        if (it->get() == &conn) {
-            Connection.emit(*it);
-            return;
-        }
-    }
+    if (conn._slot < _connections.size() && _connections[conn._slot].get() == &conn)
+        Connection.emit(_connections[conn._slot]);
 }
 
 
@@ -117,12 +176,35 @@ void Server::onConnectionClose(ServerConnection& conn)
 {
     // LTrace("On connection closed")
 
-    for (auto it = _connections.begin(); it != _connections.end(); ++it) {
-        if (it->get() == &conn) {
-            _connections.erase(it);
-            return;
-        }
+    size_t slot = conn._slot;
+    if (slot >= _connections.size() || _connections[slot].get() != &conn)
+        return;
+
+    if (conn.socket())
+        _closedStats += conn.socket()->stats();
+
+    // Swap the last connection into the vacated slot so removal is O(1).
+    // The connection may be destroyed when the reference is released.
+    ServerConnection::Ptr removed(std::move(_connections[slot]));
+    if (slot != _connections.size() - 1) {
+        _connections[slot] = std::move(_connections.back());
+        _connections[slot]->_slot = slot;
     }
+    _connections.pop_back();
+    conn._slot = std::numeric_limits<size_t>::max();
+}
+
+
+void Server::onRequestBegin(ServerConnection& conn)
+{
+    if (_timeouts.header <= 0 || conn._slot >= _connections.size() ||
+        _connections[conn._slot].get() != &conn)
+        return;
+
+    // Headers of each request on a keep-alive connection must arrive
+    // within the header timeout, however slowly their bytes trickle in
+    conn._activity.requestStartedAt = uv_now(_socket->loop());
+    scheduleTimeout(_connections[conn._slot], _timeouts.header);
 }
 
 
@@ -136,7 +218,103 @@ void Server::onTimer()
 {
     // LDebug("Num active HTTP server connections: ", connections.size())
 
-    // TODO: cleanup timed out pending connections
+    _tick++;
+    _wheelPos = (_wheelPos + 1) % _wheel.size();
+    _due.swap(_wheel[_wheelPos]);
+    auto now = uv_now(_socket->loop());
+    for (auto& entry : _due) {
+        // Skip checks which were superseded by a sooner one
+        auto conn = entry.lock();
+        if (conn && !conn->closed() && conn->_activity.checkTick == _tick)
+            checkTimeouts(conn, now);
+    }
+    _due.clear();
+}
+
+
+void Server::checkTimeouts(const ServerConnection::Ptr& conn, std::uint64_t now)
+{
+    auto& activity = conn->_activity;
+    auto& socket = conn->socket();
+
+    // Sample the socket for activity since the last check
+    auto stats = socket->stats();
+    if (stats.bytesIn != activity.bytesIn) {
+        activity.bytesIn = stats.bytesIn;
+        activity.recvAt = now;
+    }
+    if (stats.bytesOut != activity.bytesOut) {
+        activity.bytesOut = stats.bytesOut;
+        activity.sendAt = now;
+    }
+
+    // The write queue is stalled while it is not shrinking
+    size_t queued = 0;
+    if (auto tcp = dynamic_cast<net::TCPSocket*>(socket.get()))
+        queued = tcp->writeQueueSize();
+    if (queued == 0)
+        activity.stalledAt = 0;
+    else if (queued < activity.writeQueueSize || !activity.stalledAt)
+        activity.stalledAt = now;
+    activity.writeQueueSize = queued;
+
+    std::uint64_t* expired = nullptr;
+    std::int64_t next = std::numeric_limits<std::int64_t>::max();
+    auto check = [&](std::int64_t timeout, std::uint64_t since, std::uint64_t& counter) {
+        if (timeout <= 0 || expired)
+            return;
+        std::int64_t remaining = static_cast<std::int64_t>(since + timeout - now);
+        if (remaining <= 0)
+            expired = &counter;
+        else
+            next = std::min(next, remaining);
+    };
+
+    switch (conn->_phase) {
+        case ServerConnection::ReadingHeader:
+            check(_timeouts.header, activity.requestStartedAt, _timeoutStats.header);
+            break;
+        case ServerConnection::ReadingBody:
+            check(_timeouts.body, activity.recvAt, _timeoutStats.body);
+            break;
+        case ServerConnection::Idle:
+            // A connection which is still writing is not idle, but is
+            // checked again until its queue drains
+            if (queued == 0)
+                check(_timeouts.idle, std::max(activity.recvAt, activity.sendAt), _timeoutStats.idle);
+            else if (_timeouts.idle > 0)
+                next = std::min(next, _resolution);
+            break;
+        case ServerConnection::Upgraded:
+            break;
+    }
+    if (_timeouts.write > 0) {
+        if (activity.stalledAt) {
+            check(_timeouts.write, activity.stalledAt, _timeoutStats.write);
+            next = std::min(next, _resolution); // sample the queue each tick
+        } else
+            next = std::min(next, _timeouts.write);
+    }
+
+    if (expired) {
+        (*expired)++;
+        LDebug("Closing timed out connection: ", socket->peerAddress())
+        conn->close();
+    }
+    else if (next != std::numeric_limits<std::int64_t>::max())
+        scheduleTimeout(conn, next);
+}
+
+
+void Server::scheduleTimeout(const ServerConnection::Ptr& conn, std::int64_t delay)
+{
+    size_t ticks = static_cast<size_t>((delay + _resolution - 1) / _resolution);
+    ticks = std::max<size_t>(1, std::min(ticks, _wheel.size() - 1));
+    auto& activity = conn->_activity;
+    if (activity.checkTick > _tick && activity.checkTick <= _tick + ticks)
+        return;
+    activity.checkTick = _tick + ticks;
+    _wheel[(_wheelPos + ticks) % _wheel.size()].push_back(conn);
 }
 
 
@@ -146,16 +324,90 @@ net::Address& Server::address()
 }
 
 
+void Server::enableStats(bool flag)
+{
+    _statsEnabled = flag;
+}
+
+
+net::SocketStats Server::stats() const
+{
+    net::SocketStats stats(_closedStats);
+    for (auto& conn : _connections) {
+        if (conn->socket())
+            stats += conn->socket()->stats();
+    }
+    return stats;
+}
+
+
+const std::string& Server::dateHeader()
+{
+    std::time_t now = std::time(nullptr);
+    if (now != _dateTime) {
+        _dateTime = now;
+        _dateHeader = "Date: " + DateTimeFormatter::format(
+            Timestamp::fromEpochTime(now), DateTimeFormat::HTTP_FORMAT) + "\r\n";
+    }
+    return _dateHeader;
+}
+
+
+size_t Server::numConnections() const
+{
+    return _connections.size();
+}
+
+
+void Server::setTimeouts(const ServerTimeouts& timeouts)
+{
+    _timeouts = timeouts;
+    _resolution = timeoutResolution(_timeouts);
+    if (_timer.active()) {
+        _timer.stop();
+        _timer.setTimeout(_resolution);
+        _timer.setInterval(_resolution);
+        _timer.start();
+    }
+}
+
+
+const ServerTimeouts& Server::timeouts() const
+{
+    return _timeouts;
+}
+
+
+const ServerTimeoutStats& Server::timeoutStats() const
+{
+    return _timeoutStats;
+}
+
+
+void Server::setWebSocketDeflate(const ws::DeflateOptions& options)
+{
+    _wsDeflate = options;
+}
+
+
+const ws::DeflateOptions& Server::webSocketDeflate() const
+{
+    return _wsDeflate;
+}
+
+
 //
 // Server Connection
 //
 
 
-ServerConnection::ServerConnection(Server& server, net::TCPSocket::Ptr socket)
+ServerConnection::ServerConnection(Server& server, net::Socket::Ptr socket)
     : Connection(socket)
     , _server(server)
     , _responder(nullptr)
     , _upgrade(false)
+    , _phase(ReadingHeader)
+    , _slot(std::numeric_limits<size_t>::max())
 {
     // LTrace("Create")
 
@@ -181,6 +433,24 @@ Server& ServerConnection::server()
 }
 
 
+void ServerConnection::onMessageBegin()
+{
+    // LTrace("On message begin")
+
+    // Reset the connection for the next request on a keep-alive
+    // connection. The first request is timed from when the connection
+    // was accepted.
+    if (_phase == Idle) {
+        _phase = ReadingHeader;
+        _request.clear();
+        _response.clear();
+        _response.setStatus(http::StatusCode::OK);
+        _shouldSendHeader = true;
+        _server.onRequestBegin(*this);
+    }
+}
+
+
 void ServerConnection::onHeaders()
 {
     // LTrace("On headers")
@@ -216,6 +486,7 @@ void ServerConnection::onHeaders()
         // a deferred delete on the old adapter. No more callbacks will be
         // received from the old adapter after replaceAdapter is called.
         auto wsAdapter = new ws::ConnectionAdapter(this, ws::ServerSide);
+        wsAdapter->setDeflateOptions(_server._wsDeflate);
         replaceAdapter(wsAdapter);
 
         // Send the handshake request to the WS adapter for handling.
@@ -235,10 +506,14 @@ void ServerConnection::onHeaders()
         wsAdapter->onSocketRecv(*socket().get(), mutableBuffer(buffer), socket()->peerAddress());
     }
 
+    _phase = _upgrade ? Upgraded : ReadingBody;
+
     // Notify the server the connection is ready for data flow
     _server.onConnectionReady(*this);
 
     // Instantiate the responder now that request headers have been parsed
+    if (_responder)
+        delete _responder;
     _responder = _server.createResponder(*this);
 
     // Upgraded connections don't receive the onHeaders callback
@@ -275,6 +550,9 @@ void ServerConnection::onComplete()
         return;
     }
 
+    if (_phase != Upgraded)
+        _phase = Idle;
+
     // The HTTP request is complete.
     // The request handler can give a response.
     if (_responder)
@@ -293,6 +571,17 @@ void ServerConnection::onClose()
 }
 
 
+void ServerConnection::writeHeader(std::string& buf)
+{
+    Connection::writeHeader(buf);
+
+    // Origin servers must send a Date header. The cached field is
+    // inserted before the blank line ending the header.
+    if (!_response.has("Date") && buf.size() >= 2)
+        buf.insert(buf.size() - 2, _server.dateHeader());
+}
+
+
 http::Message* ServerConnection::incomingHeader()
 {
     return reinterpret_cast<http::Message*>(&_request);
@@ -11,15 +11,27 @@
 
 #include "scy/http/websocket.h"
 #include "scy/base64.h"
+#include "scy/cpu.h"
 #include "scy/crypto/hash.h"
 #include "scy/http/client.h"
 #include "scy/http/server.h"
 #include "scy/logger.h"
 #include "scy/numeric.h"
 #include "scy/random.h"
+#include <cstring>
 #include <stdexcept>
 #include <inttypes.h>
 
+#ifdef SCY_CPU_X86
+#define SCY_WS_X86 1
+#include <immintrin.h>
+#endif
+
+#ifdef SCY_CPU_NEON
+#define SCY_WS_NEON 1
+#include <arm_neon.h>
+#endif
+
 
 using std::endl;
 
@@ -93,13 +105,14 @@ bool WebSocketAdapter::shutdown(uint16_t statusCode, const std::string& statusMe
 }
 
 
-ssize_t WebSocketAdapter::send(const char* data, size_t len, int flags)
+ssize_t WebSocketAdapter::send(const char* data, size_t len, const net::Address& /* peerAddr */, int flags)
 {
-    return send(data, len, socket->peerAddress(), flags);
+    // The peer address is implied by the connection
+    return send(data, len, flags);
 }
 
 
-ssize_t WebSocketAdapter::send(const char* data, size_t len, const net::Address& peerAddr, int flags)
+ssize_t WebSocketAdapter::send(const char* data, size_t len, int flags)
 {
     LTrace("Send: ",  len,  ": ", std::string(data, len))
     assert(framer.handshakeComplete());
@@ -108,6 +121,21 @@ ssize_t WebSocketAdapter::send(const char* data, size_t len, const net::Address&
     if (!flags)
         flags = ws::SendFlags::Text;
 
+    // Compress the message if permessage-deflate was negotiated
+    auto deflate = framer.deflate();
+    if (shouldCompress(len, flags)) {
+        try {
+            deflate->compress(data, len, _deflated);
+        } catch (std::exception& exc) {
+            LError("Compression error: ", exc.what())
+            socket->setError(exc.what());
+            return -1;
+        }
+        data = _deflated.data();
+        len = _deflated.size();
+        flags |= unsigned(ws::FrameFlags::Rsv1);
+    }
+
     // Frame and send the data
     Buffer buffer;
     buffer.reserve(len + WebSocketFramer::MAX_HEADER_LENGTH);
@@ -115,7 +143,19 @@ ssize_t WebSocketAdapter::send(const char* data, size_t len, const net::Address&
     framer.writeFrame(data, len, flags, writer);
 
     assert(socket);
-    return SocketAdapter::send(writer.begin(), writer.position(), peerAddr, 0);
+    return SocketAdapter::send(writer.begin(), writer.position(), 0);
+}
+
+
+bool WebSocketAdapter::shouldCompress(size_t len, int flags) const
+{
+    // Only whole data messages are compressed, since control frames must
+    // not be and each fragment would otherwise be compressed on its own
+    auto deflate = framer.deflate();
+    unsigned opcode = flags & unsigned(ws::Opcode::Bitmask);
+    return deflate && len >= deflate->options().threshold &&
+           (flags & unsigned(ws::FrameFlags::Fin)) &&
+           (opcode == unsigned(ws::Opcode::Text) || opcode == unsigned(ws::Opcode::Binary));
 }
 
 
@@ -223,50 +263,19 @@ void WebSocketAdapter::onSocketRecv(net::Socket&, const MutableBuffer& buffer, c
 
     if (framer.handshakeComplete()) {
 
-        // Note: The spec wants us to buffer partial frames, but our
-        // software does not require this feature, and furthermore
-        // it goes against our nocopy where possible policy.
-        // This may need to change in the future, but for now
-        // we just parse and emit packets as they arrive.
-        //
-        // Incoming frames may be joined, so we parse them
-        // in a loop until the read buffer is empty.
+        // Frames may be joined or split across reads, so the framer
+        // buffers partial headers and returns payload in place as it
+        // arrives. Payload is delivered as it arrives unless whole
+        // messages have been requested.
         BitReader reader(buffer);
-        size_t total = reader.available();
-        size_t offset = reader.position();
-        while (offset < total) {
-            char* payload = nullptr;
-            uint64_t payloadLength = 0;
+        char* payload = nullptr;
+        size_t len = 0;
+        for (;;) {
             try {
-                // Restore buffer state for next read
-                // reader.position(offset);
-                // reader.limit(total);
-
-                // STrace << "Read frame at: "
-                //      << "\n\tinputPosition: " << offset
-                //      << "\n\tinputLength: " << total
-                //      << "\n\tbufferPosition: " << reader.position()
-                //      << "\n\tbufferAvailable: " << reader.available()
-                //      << "\n\tbufferLimit: " << reader.limit()
-                //      << "\n\tbuffer: " << std::string(reader.current(),
-                //      reader.limit())
-                //      << endl;
-
-                // Parse a frame to throw
-                // int payloadLength = framer.readFrame(reader);
-                payloadLength = framer.readFrame(reader, payload);
-                assert(payload);
-
-                // Update the next frame offset
-                offset = reader.position(); // + payloadLength;
-                if (offset < total)
-                    LTrace("Splitting joined packet at ",  offset,  " of ", total)
-
-                // Drop empty packets
-                if (!payloadLength) {
-                    LDebug("Dropping empty frame")
+                if (!framer.readFrameData(reader, payload, len))
+                    break;
+                if (!handleFrameData(payload, len))
                     continue;
-                }
             } catch (std::exception& exc) {
                 LError("Parser error: ", exc.what())
                 socket->setError(exc.what());
@@ -275,12 +284,14 @@ void WebSocketAdapter::onSocketRecv(net::Socket&, const MutableBuffer& buffer, c
 
             // Emit the result packet
             assert(payload);
-            assert(payloadLength);
+            assert(len);
             net::SocketEmitter::onSocketRecv(*socket.get(),
-                mutableBuffer(payload, (size_t)payloadLength),
-                peerAddress);
+                mutableBuffer(payload, len), peerAddress);
+
+            // Stop if the socket was closed by the callback
+            if (!framer.handshakeComplete())
+                return;
         }
-        assert(offset == total);
     } else {
         try {
             if (framer.mode() == ws::ClientSide)
@@ -296,6 +307,118 @@ void WebSocketAdapter::onSocketRecv(net::Socket&, const MutableBuffer& buffer, c
 }
 
 
+bool WebSocketAdapter::handleFrameData(char*& data, size_t& len)
+{
+    int flags = framer.frameFlags();
+    bool last = framer.frameRemaining() == 0;
+
+    // Control frames may arrive between the frames of a message, and
+    // are small enough to buffer when split across reads
+    if ((flags & unsigned(ws::Opcode::Bitmask)) >= unsigned(ws::Opcode::Close)) {
+        if (framer.frameBegin())
+            _control.clear();
+        if (!last || !_control.empty()) {
+            _control.insert(_control.end(), data, data + len);
+            if (!last)
+                return false;
+            data = _control.data();
+            len = _control.size();
+        }
+        _messageComplete = true;
+        return len > 0;
+    }
+
+    // Check the frame sequence when a frame begins
+    if (framer.frameBegin()) {
+        bool continuation = (flags & unsigned(ws::Opcode::Bitmask)) == unsigned(ws::Opcode::Continuation);
+        if (continuation != _fragmented)
+            throw std::runtime_error(_fragmented ? "WebSocket error: Expected continuation frame"
+                                                 : "WebSocket error: Unexpected continuation frame");
+        if (!_fragmented) {
+            // Release the memory of large reassembled messages
+            if (_message.capacity() > 65536)
+                Buffer().swap(_message);
+            _message.clear();
+            _messageSize = 0;
+
+            // Compressed messages are flagged by RSV1 on their first frame
+            if (flags & unsigned(ws::FrameFlags::Rsv1)) {
+                if (!framer.deflate())
+                    throw std::runtime_error("WebSocket error: Compressed frame without permessage-deflate");
+                _inflating = true;
+            }
+        } else if (flags & unsigned(ws::FrameFlags::Rsv1))
+            throw std::runtime_error("WebSocket error: Reserved frame flags set");
+    }
+
+    // Reject messages which are too big before their payload arrives
+    _messageSize += len;
+    if (_maxMessageSize && _messageSize + framer.frameRemaining() > _maxMessageSize)
+        throw std::runtime_error("WebSocket error: Message too big"); //, ws::ErrorPayloadTooBig
+
+    bool fin = last && (flags & unsigned(ws::FrameFlags::Fin));
+    _fragmented = !fin;
+    if (_inflating) {
+        _inflating = !fin;
+        _inflated.clear();
+        framer.deflate()->decompress(data, len, fin, _inflated);
+        data = _inflated.data();
+        len = _inflated.size();
+    }
+
+    if (_reassemble && !(fin && _message.empty())) {
+        _message.insert(_message.end(), data, data + len);
+        if (_maxMessageSize && _message.size() > _maxMessageSize)
+            throw std::runtime_error("WebSocket error: Message too big"); //, ws::ErrorPayloadTooBig
+        if (!fin)
+            return false;
+        data = _message.data();
+        len = _message.size();
+    }
+
+    // Drop empty packets
+    _messageComplete = fin;
+    if (!len) {
+        LDebug("Dropping empty frame")
+        return false;
+    }
+    return true;
+}
+
+
+void WebSocketAdapter::setReassembleMessages(bool flag)
+{
+    _reassemble = flag;
+}
+
+
+void WebSocketAdapter::setMaxMessageSize(size_t size)
+{
+    _maxMessageSize = size;
+    framer._deflateOptions.maxMessageSize = size;
+    if (framer._deflate)
+        framer._deflate->setMaxMessageSize(size);
+}
+
+
+bool WebSocketAdapter::reassembleMessages() const
+{
+    return _reassemble;
+}
+
+
+size_t WebSocketAdapter::maxMessageSize() const
+{
+    return _maxMessageSize;
+}
+
+
+bool WebSocketAdapter::messageComplete() const
+{
+    return _messageComplete;
+}
+
+
 void WebSocketAdapter::onSocketClose(net::Socket&)
 {
     LTrace("On close")
@@ -305,12 +428,34 @@ void WebSocketAdapter::onSocketClose(net::Socket&)
     _response.clear();
     framer._headerState = 0;
     framer._frameFlags = 0;
+    framer._frameHeaderSize = 0;
+    framer._frameReading = false;
+    framer._deflate.reset();
+    _inflating = false;
+    _fragmented = false;
+    _message.clear();
+    _control.clear();
 
     // Emit closed event
     net::SocketEmitter::onSocketClose(*socket.get());
 }
 
 
+void WebSocketAdapter::setDeflateOptions(const DeflateOptions& options)
+{
+    // Inflated messages are bound by the adapter's own limit
+    DeflateOptions opts(options);
+    opts.maxMessageSize = _maxMessageSize;
+    framer.setDeflateOptions(opts);
+}
+
+
+PerMessageDeflate* WebSocketAdapter::deflate() const
+{
+    return framer.deflate();
+}
+
+
 //
 // WebSocket Connection Adapter
 //
@@ -337,6 +482,143 @@ void ConnectionAdapter::onHandshakeComplete()
 }
 
 
+//
+// WebSocket Masking
+//
+// Block kernels mask whole blocks starting at a key aligned position,
+// using a key already rotated to that position, and return the number
+// of bytes processed. Block sizes are multiples of 4 so the caller can
+// finish the tail with the unrotated key.
+//
+
+
+namespace {
+
+
+typedef size_t (*mask_kernel)(const uint8_t* in, uint8_t* out, size_t len, const uint8_t key[4]);
+
+
+size_t mask_scalar(const uint8_t* in, uint8_t* out, size_t len, const uint8_t key[4])
+{
+    uint8_t wide[8];
+    std::memcpy(wide, key, 4);
+    std::memcpy(wide + 4, key, 4);
+    uint64_t k;
+    std::memcpy(&k, wide, 8);
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        std::memcpy(&v, in + i, 8);
+        v ^= k;
+        std::memcpy(out + i, &v, 8);
+    }
+    return i;
+}
+
+
+#ifdef SCY_WS_X86
+
+
+size_t mask_sse2(const uint8_t* in, uint8_t* out, size_t len, const uint8_t key[4])
+{
+    int32_t k;
+    std::memcpy(&k, key, 4);
+    const __m128i k128 = _mm_set1_epi32(k);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(v, k128));
+    }
+    return i + mask_scalar(in + i, out + i, len - i, key);
+}
+
+
+SCY_TARGET("avx2")
+size_t mask_avx2(const uint8_t* in, uint8_t* out, size_t len, const uint8_t key[4])
+{
+    int32_t k;
+    std::memcpy(&k, key, 4);
+    const __m256i k256 = _mm256_set1_epi32(k);
+
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(a, k256));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 32), _mm256_xor_si256(b, k256));
+    }
+    return i + mask_sse2(in + i, out + i, len - i, key);
+}
+
+
+#endif // SCY_WS_X86
+
+
+#ifdef SCY_WS_NEON
+
+
+size_t mask_neon(const uint8_t* in, uint8_t* out, size_t len, const uint8_t key[4])
+{
+    uint32_t k;
+    std::memcpy(&k, key, 4);
+    const uint8x16_t k128 = vreinterpretq_u8_u32(vdupq_n_u32(k));
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+        vst1q_u8(out + i, veorq_u8(vld1q_u8(in + i), k128));
+    return i + mask_scalar(in + i, out + i, len - i, key);
+}
+
+
+#endif // SCY_WS_NEON
+
+
+mask_kernel selectKernel()
+{
+#if defined(SCY_WS_X86)
+    if (cpu::hasAVX2())
+        return mask_avx2;
+    return mask_sse2;
+#elif defined(SCY_WS_NEON)
+    return mask_neon;
+#else
+    return mask_scalar;
+#endif
+}
+
+
+} // namespace
+
+
+void mask(const char* src, char* dst, size_t len, const char key[4])
+{
+    static const mask_kernel kernel = selectKernel();
+
+    auto in = reinterpret_cast<const uint8_t*>(src);
+    auto out = reinterpret_cast<uint8_t*>(dst);
+    auto k = reinterpret_cast<const uint8_t*>(key);
+
+    // Short payloads such as control frames are not worth a kernel call
+    size_t i = 0;
+    if (len >= 32) {
+        // Mask up to the first 32 byte boundary of the output so block
+        // stores never straddle cache lines, then rotate the key so it
+        // starts at that position.
+        size_t head = (32 - (reinterpret_cast<uintptr_t>(out) & 31)) & 31;
+        for (; i < head; i++)
+            out[i] = in[i] ^ k[i & 3];
+
+        const uint8_t rotated[4] = { k[i & 3], k[(i + 1) & 3],
+                                     k[(i + 2) & 3], k[(i + 3) & 3] };
+        i += kernel(in + i, out + i, len - i, rotated);
+    }
+    for (; i < len; i++)
+        out[i] = in[i] ^ k[i & 3];
+}
+
+
 //
 // WebSocket Framer
 //
@@ -347,6 +629,12 @@ WebSocketFramer::WebSocketFramer(ws::Mode mode)
     , _frameFlags(0)
     , _headerState(0)
     , _maskPayload(mode == ws::ClientSide)
+    , _frameHeaderSize(0)
+    , _frameReading(false)
+    , _frameMasked(false)
+    , _frameBegin(false)
+    , _frameLength(0)
+    , _frameRemaining(0)
 {
 }
 
@@ -386,6 +674,8 @@ void WebSocketFramer::createClientHandshakeRequest(http::Request& request)
     assert(request.has("Sec-WebSocket-Version"));
     request.set("Sec-WebSocket-Key", _key);
     assert(request.has("Sec-WebSocket-Key"));
+    if (_deflateOptions.enabled)
+        request.set("Sec-WebSocket-Extensions", PerMessageDeflate::offer(_deflateOptions));
     _headerState++;
 }
 
@@ -444,6 +734,15 @@ void WebSocketFramer::acceptServerRequest(http::Request& request, http::Response
         response.set("Connection", "Upgrade");
         response.set("Sec-WebSocket-Accept", computeAccept(key));
 
+        // Accept the first compatible permessage-deflate offer
+        std::string extensions = request.get("Sec-WebSocket-Extensions", "");
+        if (_deflateOptions.enabled && !extensions.empty()) {
+            std::string accepted;
+            _deflate.reset(PerMessageDeflate::negotiate(extensions, _deflateOptions, accepted));
+            if (_deflate)
+                response.set("Sec-WebSocket-Extensions", accepted);
+        }
+
         // Set headerState 2 since the handshake was accepted.
         _headerState = 2;
     } else
@@ -453,7 +752,8 @@ void WebSocketFramer::acceptServerRequest(http::Request& request, http::Response
 
 size_t WebSocketFramer::writeFrame(const char* data, size_t len, int flags, BitWriter& frame)
 {
-    assert(flags == ws::SendFlags::Text || flags == ws::SendFlags::Binary);
+    assert(!(flags & ~(unsigned(ws::FrameFlags::Fin) | unsigned(ws::FrameFlags::Rsv1) |
+                       unsigned(ws::Opcode::Bitmask))));
     assert(frame.position() == 0);
     // assert(frame.limit() >= size_t(len + MAX_HEADER_LENGTH));
 
@@ -472,18 +772,22 @@ size_t WebSocketFramer::writeFrame(const char* data, size_t len, int flags, BitW
     } else {
         lenByte |= 127;
         frame.putU8(lenByte);
-        frame.putU64(static_cast<uint16_t>(len));
+        frame.putU64(static_cast<uint64_t>(len));
     }
 
     if (_maskPayload) {
-        auto mask = _rnd.next();
-        auto m = reinterpret_cast<const char*>(&mask);
-        auto b = reinterpret_cast<const char*>(data);
+        auto key = _rnd.next();
+        auto m = reinterpret_cast<const char*>(&key);
         frame.put(m, 4);
-        // auto p = frame.current();
-        for (unsigned i = 0; i < len; i++) {
-            // p[i] = b[i] ^ m[i % 4];
-            frame.putU8(b[i] ^ m[i % 4]);
+
+        // Mask straight into the frame if it has room, otherwise
+        // let the writer grow and mask the copied payload in place.
+        if (frame.available() >= len) {
+            ws::mask(data, frame.current(), len, m);
+            frame.skip(len);
+        } else {
+            frame.put(data, len);
+            ws::mask(frame.current() - len, frame.current() - len, len, m);
         }
     } else {
         // memcpy(frame.current(), data, len); // offset?
@@ -574,12 +878,8 @@ uint64_t WebSocketFramer::readFrame(BitReader& frame, char*& payload)
         const_cast<char*>(frame.begin() + (offset + payloadOffset)));
 
     // Unmask the payload if required
-    if (lengthByte & FRAME_FLAG_MASK) {
-        auto p = reinterpret_cast<char*>(payload); // frame.data());
-        for (uint64_t i = 0; i < payloadLength; i++) {
-            p[i] ^= mask[i % 4];
-        }
-    }
+    if (lengthByte & FRAME_FLAG_MASK)
+        ws::mask(payload, payload, size_t(payloadLength), mask);
 
     // Update frame length to include payload plus header
     frame.seek(size_t(offset + payloadOffset + payloadLength));
@@ -591,6 +891,88 @@ uint64_t WebSocketFramer::readFrame(BitReader& frame, char*& payload)
 }
 
 
+bool WebSocketFramer::readFrameData(BitReader& frame, char*& payload, size_t& len)
+{
+    assert(handshakeComplete());
+
+    if (!_frameReading) {
+        // Buffer the header until it is complete. The second byte
+        // gives the length of the rest of the header.
+        auto headerLength = [this]() -> size_t {
+            if (_frameHeaderSize < 2)
+                return 2;
+            uint8_t lengthByte = static_cast<uint8_t>(_frameHeader[1]);
+            size_t length = 2;
+            if (lengthByte & FRAME_FLAG_MASK)
+                length += 4;
+            if ((lengthByte & 0x7f) == 127)
+                length += 8;
+            else if ((lengthByte & 0x7f) == 126)
+                length += 2;
+            return length;
+        };
+        for (;;) {
+            size_t length = headerLength();
+            size_t n = std::min(length - _frameHeaderSize, frame.available());
+            frame.get(_frameHeader + _frameHeaderSize, n);
+            _frameHeaderSize += n;
+            if (_frameHeaderSize < length)
+                return false;
+            if (headerLength() == length)
+                break;
+        }
+
+        // Parse the frame header
+        BitReader headerReader(_frameHeader, _frameHeaderSize);
+        uint8_t flags, lengthByte;
+        headerReader.getU8(flags);
+        headerReader.getU8(lengthByte);
+        uint64_t payloadLength = lengthByte & 0x7f;
+        if (payloadLength == 127) {
+            headerReader.getU64(payloadLength);
+            if (payloadLength >> 63)
+                throw std::runtime_error("WebSocket error: Invalid payload length"); //, ws::ErrorPayloadTooBig
+        } else if (payloadLength == 126) {
+            uint16_t l;
+            headerReader.getU16(l);
+            payloadLength = l;
+        }
+        if (flags & (unsigned(ws::FrameFlags::Rsv2) | unsigned(ws::FrameFlags::Rsv3)))
+            throw std::runtime_error("WebSocket error: Reserved frame flags set");
+        if ((flags & unsigned(ws::Opcode::Bitmask)) >= unsigned(ws::Opcode::Close) &&
+            (payloadLength > 125 || !(flags & unsigned(ws::FrameFlags::Fin))))
+            throw std::runtime_error("WebSocket error: Invalid control frame");
+
+        _frameMasked = (lengthByte & FRAME_FLAG_MASK) != 0;
+        if (_frameMasked)
+            headerReader.get(_frameMask, 4);
+        _frameFlags = flags;
+        _frameLength = _frameRemaining = payloadLength;
+        _frameHeaderSize = 0;
+        _frameReading = true;
+        _frameBegin = true;
+    } else if (!frame.available())
+        return false;
+    else
+        _frameBegin = false;
+
+    // Return the payload which has arrived in place
+    len = size_t(std::min<uint64_t>(_frameRemaining, frame.available()));
+    payload = const_cast<char*>(frame.current());
+    if (_frameMasked) {
+        // Rotate the key to the payload offset
+        size_t k = size_t((_frameLength - _frameRemaining) & 3);
+        const char key[4] = { _frameMask[k], _frameMask[(k + 1) & 3],
+                              _frameMask[(k + 2) & 3], _frameMask[(k + 3) & 3] };
+        ws::mask(payload, payload, len, key);
+    }
+    frame.skip(len);
+    _frameRemaining -= len;
+    _frameReading = _frameRemaining > 0;
+    return true;
+}
+
+
 void WebSocketFramer::completeClientHandshake(http::Response& response)
 {
     assert(_mode == ws::ClientSide);
@@ -605,6 +987,13 @@ void WebSocketFramer::completeClientHandshake(http::Response& response)
     std::string accept = response.get("Sec-WebSocket-Accept", "");
     if (accept != computeAccept(_key))
         throw std::runtime_error("WebSocket error: Invalid or missing Sec-WebSocket-Accept header in handshake esponse"); //, ws::ErrorNoHandshake
+    std::string extensions = response.get("Sec-WebSocket-Extensions", "");
+    if (!extensions.empty()) {
+        if (!_deflateOptions.enabled)
+            throw std::runtime_error("WebSocket error: Unexpected Sec-WebSocket-Extensions header in handshake response");
+        _deflate.reset(new PerMessageDeflate(_deflateOptions, false));
+        _deflate->accept(extensions);
+    }
 
     _headerState++;
     assert(handshakeComplete());
@@ -629,6 +1018,36 @@ int WebSocketFramer::frameFlags() const
 }
 
 
+bool WebSocketFramer::frameBegin() const
+{
+    return _frameBegin;
+}
+
+
+uint64_t WebSocketFramer::frameRemaining() const
+{
+    return _frameRemaining;
+}
+
+
+void WebSocketFramer::setDeflateOptions(const DeflateOptions& options)
+{
+    _deflateOptions = options;
+}
+
+
+const DeflateOptions& WebSocketFramer::deflateOptions() const
+{
+    return _deflateOptions;
+}
+
+
+PerMessageDeflate* WebSocketFramer::deflate() const
+{
+    return _deflate.get();
+}
+
+
 bool WebSocketFramer::mustMaskPayload() const
 {
     return _maskPayload;
@@ -0,0 +1,238 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup http
+/// @{
+
+
+#include "scy/http/websocketbroadcast.h"
+#include "scy/logger.h"
+#include "scy/net/memorysocket.h"
+#include "scy/net/tcpsocket.h"
+
+
+namespace scy {
+namespace http {
+namespace ws {
+
+
+BroadcastGroup::BroadcastGroup(SlowMemberPolicy policy, size_t maxQueueSize)
+    : _framer(ws::ServerSide)
+    , _policy(policy)
+    , _maxQueueSize(maxQueueSize)
+    , _broadcasting(false)
+{
+}
+
+
+BroadcastGroup::~BroadcastGroup()
+{
+    assert(!_broadcasting);
+}
+
+
+bool BroadcastGroup::add(const Connection::Ptr& conn)
+{
+    auto adapter = conn ? dynamic_cast<ws::ConnectionAdapter*>(conn->adapter()) : nullptr;
+    if (!adapter || adapter->framer.mode() != ws::ServerSide ||
+        _index.find(conn.get()) != _index.end())
+        return false;
+
+    _index[conn.get()] = _members.size();
+    _members.push_back({ conn, conn.get() });
+    return true;
+}
+
+
+bool BroadcastGroup::remove(const Connection::Ptr& conn)
+{
+    auto it = _index.find(conn.get());
+    if (it == _index.end())
+        return false;
+
+    // Leave a tombstone for the broadcast loop to erase
+    if (_broadcasting) {
+        _members[it->second].conn.reset();
+        _members[it->second].key = nullptr;
+        _index.erase(it);
+    } else
+        erase(it->second);
+    return true;
+}
+
+
+bool BroadcastGroup::has(const Connection::Ptr& conn) const
+{
+    return _index.find(conn.get()) != _index.end();
+}
+
+
+size_t BroadcastGroup::size() const
+{
+    return _index.size();
+}
+
+
+void BroadcastGroup::clear()
+{
+    if (_broadcasting) {
+        for (auto& member : _members) {
+            member.conn.reset();
+            member.key = nullptr;
+        }
+    } else
+        _members.clear();
+    _index.clear();
+}
+
+
+size_t BroadcastGroup::broadcast(const std::string& data, int flags)
+{
+    return broadcast(data.data(), data.size(), flags);
+}
+
+
+size_t BroadcastGroup::broadcast(const char* data, size_t len, int flags)
+{
+    assert(!_broadcasting && "recursive broadcast");
+
+    // Set default text flag if none specified
+    if (!flags)
+        flags = ws::SendFlags::Text;
+
+    _stats.messages++;
+    _broadcasting = true;
+
+    std::shared_ptr<const Buffer> shared;
+    std::vector<Connection::Ptr> slow;
+    size_t delivered = 0;
+    for (size_t i = 0; i < _members.size();) {
+        auto conn = _members[i].conn.lock();
+        if (!conn || conn->closed()) {
+            erase(i);
+            continue;
+        }
+        i++;
+
+        auto adapter = dynamic_cast<ws::ConnectionAdapter*>(conn->adapter());
+        auto& socket = conn->socket();
+        if (!adapter || !socket || !adapter->framer.handshakeComplete())
+            continue;
+
+        if (_policy != SlowMemberPolicy::Queue &&
+            queueSize(*socket) > _maxQueueSize) {
+            if (_policy == SlowMemberPolicy::Close)
+                slow.push_back(conn);
+            else
+                _stats.skipped++;
+            continue;
+        }
+
+        // Members using permessage-deflate compress with their own context
+        ssize_t res;
+        if (adapter->shouldCompress(len, flags)) {
+            res = adapter->send(data, len, flags);
+            _stats.compressed++;
+        } else {
+            if (!shared)
+                shared = frame(data, len, flags);
+            res = socket->sendShared(shared);
+        }
+
+        if (res < 0)
+            _stats.failed++;
+        else {
+            delivered++;
+            _stats.bytes += static_cast<uint64_t>(res);
+        }
+    }
+
+    _broadcasting = false;
+    _stats.delivered += delivered;
+
+    // Close slow members once the loop no longer refers to them
+    for (auto& conn : slow) {
+        LDebug("Closing slow broadcast member: ", conn->socket()->peerAddress())
+        _stats.closed++;
+        remove(conn);
+        conn->close();
+    }
+    return delivered;
+}
+
+
+std::shared_ptr<const Buffer> BroadcastGroup::frame(const char* data, size_t len, int flags)
+{
+    auto buffer = std::make_shared<Buffer>(len + WebSocketFramer::MAX_HEADER_LENGTH);
+    BitWriter writer(buffer->data(), buffer->size());
+    _framer.writeFrame(data, len, flags, writer);
+    buffer->resize(writer.position());
+    return buffer;
+}
+
+
+size_t BroadcastGroup::queueSize(net::Socket& socket)
+{
+    if (auto tcp = dynamic_cast<net::TCPSocket*>(&socket))
+        return tcp->writeQueueSize();
+    if (auto mem = dynamic_cast<net::MemorySocket*>(&socket))
+        return mem->pending();
+    return 0;
+}
+
+
+void BroadcastGroup::erase(size_t index)
+{
+    auto key = _members[index].key;
+    if (index + 1 < _members.size()) {
+        _members[index] = std::move(_members.back());
+        if (_members[index].key)
+            _index[_members[index].key] = index;
+    }
+    _members.pop_back();
+    if (key)
+        _index.erase(key);
+}
+
+
+void BroadcastGroup::setSlowMemberPolicy(SlowMemberPolicy policy, size_t maxQueueSize)
+{
+    _policy = policy;
+    _maxQueueSize = maxQueueSize;
+}
+
+
+SlowMemberPolicy BroadcastGroup::slowMemberPolicy() const
+{
+    return _policy;
+}
+
+
+size_t BroadcastGroup::maxQueueSize() const
+{
+    return _maxQueueSize;
+}
+
+
+const BroadcastStats& BroadcastGroup::stats() const
+{
+    return _stats;
+}
+
+
+void BroadcastGroup::resetStats()
+{
+    _stats = BroadcastStats();
+}
+
+
+} // namespace ws
+} // namespace http
+} // namespace scy
+
+
+/// @\}
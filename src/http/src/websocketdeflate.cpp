@@ -0,0 +1,375 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup http
+/// @{
+
+
+#include "scy/http/websocketdeflate.h"
+#include "scy/logger.h"
+#include "scy/util.h"
+#include "zlib.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace scy {
+namespace http {
+namespace ws {
+
+
+const char* PerMessageDeflate::Name = "permessage-deflate";
+
+std::atomic<size_t> PerMessageDeflate::_totalMemory(0);
+
+
+namespace {
+
+
+/// Empty stored block which ends every flushed deflate message.
+const char EmptyBlock[4] = { '\x00', '\x00', '\xff', '\xff' };
+
+/// Output buffer growth while deflating or inflating.
+const size_t ChunkSize = 16384;
+
+/// Allocations are prefixed with their size so zfree can account for it.
+const size_t HeaderSize = alignof(std::max_align_t) > sizeof(size_t)
+                              ? alignof(std::max_align_t) : sizeof(size_t);
+
+
+/// Parses a window bits parameter value, which may be quoted.
+bool parseWindowBits(std::string value, int& bits)
+{
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+        value = value.substr(1, value.size() - 2);
+    if (value.empty() || value.size() > 2 ||
+        !std::all_of(value.begin(), value.end(), ::isdigit))
+        return false;
+    bits = std::stoi(value);
+    return bits >= 8 && bits <= 15;
+}
+
+
+} // namespace
+
+
+PerMessageDeflate::PerMessageDeflate(const DeflateOptions& options, bool server)
+    : _options(options)
+    , _server(server)
+    , _deflate(nullptr)
+    , _inflate(nullptr)
+    , _inflated(0)
+    , _memory(0)
+{
+}
+
+
+PerMessageDeflate::~PerMessageDeflate()
+{
+    releaseCompressor();
+    releaseDecompressor();
+    assert(_memory == 0);
+}
+
+
+std::string PerMessageDeflate::offer(const DeflateOptions& options)
+{
+    // Always declare support for client_max_window_bits so the server
+    // may limit our window, which costs nothing since zlib handles it.
+    std::string value(Name);
+    if (options.serverNoContextTakeover)
+        value += "; server_no_context_takeover";
+    if (options.clientNoContextTakeover)
+        value += "; client_no_context_takeover";
+    if (options.serverMaxWindowBits < 15)
+        value += "; server_max_window_bits=" + std::to_string(options.serverMaxWindowBits);
+    if (options.clientMaxWindowBits < 15)
+        value += "; client_max_window_bits=" + std::to_string(options.clientMaxWindowBits);
+    else
+        value += "; client_max_window_bits";
+    return value;
+}
+
+
+bool PerMessageDeflate::parse(const std::string& extension, DeflateOptions& params,
+                              bool& serverBits, bool& clientBits)
+{
+    std::vector<std::string> tokens = util::split(extension, ';');
+    if (tokens.empty() || util::trim(tokens[0]) != Name)
+        return false;
+
+    bool serverNoContext = false, clientNoContext = false;
+    serverBits = clientBits = false;
+    for (size_t i = 1; i < tokens.size(); i++) {
+        std::string param(util::trim(tokens[i]));
+        std::string value;
+        size_t eq = param.find('=');
+        bool hasValue = eq != std::string::npos;
+        if (hasValue) {
+            value = util::trim(param.substr(eq + 1));
+            param = util::trim(param.substr(0, eq));
+        }
+
+        if (param == "server_no_context_takeover") {
+            if (serverNoContext || hasValue)
+                return false;
+            serverNoContext = params.serverNoContextTakeover = true;
+        } else if (param == "client_no_context_takeover") {
+            if (clientNoContext || hasValue)
+                return false;
+            clientNoContext = params.clientNoContextTakeover = true;
+        } else if (param == "server_max_window_bits") {
+            if (serverBits || !parseWindowBits(value, params.serverMaxWindowBits))
+                return false;
+            serverBits = true;
+        } else if (param == "client_max_window_bits") {
+            // The value is optional in offers
+            if (clientBits || (hasValue && !parseWindowBits(value, params.clientMaxWindowBits)))
+                return false;
+            clientBits = true;
+        } else
+            return false;
+    }
+    return true;
+}
+
+
+PerMessageDeflate* PerMessageDeflate::negotiate(const std::string& offers,
+                                                const DeflateOptions& options,
+                                                std::string& response)
+{
+    for (auto& extension : util::split(offers, ',')) {
+        DeflateOptions params;
+        bool serverBits, clientBits;
+        if (!parse(extension, params, serverBits, clientBits))
+            continue;
+
+        // zlib cannot compress with the 8 bit window the client requires
+        DeflateOptions negotiated(options);
+        negotiated.serverMaxWindowBits = std::min(options.serverMaxWindowBits, params.serverMaxWindowBits);
+        if (negotiated.serverMaxWindowBits < 9)
+            continue;
+
+        // The client window can only be limited if the client supports it
+        negotiated.clientMaxWindowBits = clientBits
+            ? std::min(options.clientMaxWindowBits, params.clientMaxWindowBits) : 15;
+        negotiated.serverNoContextTakeover |= params.serverNoContextTakeover;
+        negotiated.clientNoContextTakeover |= params.clientNoContextTakeover;
+
+        response = Name;
+        if (negotiated.serverNoContextTakeover)
+            response += "; server_no_context_takeover";
+        if (negotiated.clientNoContextTakeover)
+            response += "; client_no_context_takeover";
+        if (serverBits || negotiated.serverMaxWindowBits < 15)
+            response += "; server_max_window_bits=" + std::to_string(negotiated.serverMaxWindowBits);
+        if (clientBits && negotiated.clientMaxWindowBits < 15)
+            response += "; client_max_window_bits=" + std::to_string(negotiated.clientMaxWindowBits);
+        return new PerMessageDeflate(negotiated, true);
+    }
+    return nullptr;
+}
+
+
+void PerMessageDeflate::accept(const std::string& response)
+{
+    assert(!_server);
+
+    DeflateOptions params;
+    bool serverBits, clientBits;
+    if (response.find(',') != std::string::npos ||
+        !parse(response, params, serverBits, clientBits))
+        throw std::runtime_error("WebSocket error: Invalid extension response: " + response);
+
+    // zlib cannot compress with an 8 bit window
+    if (clientBits && params.clientMaxWindowBits < 9)
+        throw std::runtime_error("WebSocket error: Unsupported client_max_window_bits in extension response");
+
+    _options.serverMaxWindowBits = params.serverMaxWindowBits;
+    _options.clientMaxWindowBits = std::min(_options.clientMaxWindowBits, params.clientMaxWindowBits);
+    _options.serverNoContextTakeover = params.serverNoContextTakeover;
+    _options.clientNoContextTakeover |= params.clientNoContextTakeover;
+}
+
+
+void PerMessageDeflate::compress(const char* data, size_t len, Buffer& out)
+{
+    if (!_deflate) {
+        _deflate = new z_stream();
+        _deflate->zalloc = &PerMessageDeflate::zalloc;
+        _deflate->zfree = &PerMessageDeflate::zfree;
+        _deflate->opaque = this;
+        int bits = _server ? _options.serverMaxWindowBits : _options.clientMaxWindowBits;
+        if (deflateInit2(_deflate, _options.level, Z_DEFLATED, -bits,
+                         _options.memLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+            releaseCompressor();
+            throw std::runtime_error("WebSocket error: Cannot initialize compressor");
+        }
+    }
+
+    out.clear();
+    _deflate->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    _deflate->avail_in = static_cast<uInt>(len);
+    do {
+        size_t pos = out.size();
+        out.resize(pos + std::max(ChunkSize, len / 2));
+        _deflate->next_out = reinterpret_cast<Bytef*>(&out[pos]);
+        _deflate->avail_out = static_cast<uInt>(out.size() - pos);
+        int ret = ::deflate(_deflate, Z_SYNC_FLUSH);
+        assert(ret == Z_OK || ret == Z_BUF_ERROR);
+        (void)ret;
+        out.resize(out.size() - _deflate->avail_out);
+    } while (_deflate->avail_out == 0);
+
+    // Strip the empty block which ends the flushed data, leaving a
+    // single empty block byte for empty messages
+    assert(out.size() >= 4 && std::memcmp(&out[out.size() - 4], EmptyBlock, 4) == 0);
+    out.resize(out.size() - 4);
+    if (out.empty())
+        out.push_back('\x00');
+
+    bool noContextTakeover = _server ? _options.serverNoContextTakeover
+                                     : _options.clientNoContextTakeover;
+    if (noContextTakeover)
+        releaseCompressor();
+}
+
+
+void PerMessageDeflate::decompress(const char* data, size_t len, bool fin, Buffer& out)
+{
+    if (!_inflate) {
+        _inflate = new z_stream();
+        _inflate->zalloc = &PerMessageDeflate::zalloc;
+        _inflate->zfree = &PerMessageDeflate::zfree;
+        _inflate->opaque = this;
+        int bits = _server ? _options.clientMaxWindowBits : _options.serverMaxWindowBits;
+        if (inflateInit2(_inflate, -bits) != Z_OK) {
+            releaseDecompressor();
+            throw std::runtime_error("WebSocket error: Cannot initialize decompressor");
+        }
+    }
+
+    // The final frame is followed by the empty block stripped by the peer
+    for (int pass = 0; pass < (fin ? 2 : 1); pass++) {
+        _inflate->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(pass ? EmptyBlock : data));
+        _inflate->avail_in = static_cast<uInt>(pass ? 4 : len);
+        do {
+            size_t pos = out.size();
+            out.resize(pos + ChunkSize);
+            _inflate->next_out = reinterpret_cast<Bytef*>(&out[pos]);
+            _inflate->avail_out = static_cast<uInt>(ChunkSize);
+            int ret = ::inflate(_inflate, Z_SYNC_FLUSH);
+            out.resize(out.size() - _inflate->avail_out);
+            _inflated += ChunkSize - _inflate->avail_out;
+
+            if (_options.maxMessageSize && _inflated > _options.maxMessageSize) {
+                releaseDecompressor();
+                throw std::runtime_error("WebSocket error: Compressed message too big");
+            }
+            if (ret == Z_STREAM_END) {
+                // The peer ended the deflate stream with a final block,
+                // so start a new one for any data which follows
+                inflateReset(_inflate);
+            } else if (ret == Z_BUF_ERROR && _inflate->avail_out > 0) {
+                break;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                releaseDecompressor();
+                throw std::runtime_error("WebSocket error: Invalid compressed data");
+            }
+        } while (_inflate->avail_in > 0 || _inflate->avail_out == 0);
+    }
+
+    if (fin) {
+        _inflated = 0;
+        bool noContextTakeover = _server ? _options.clientNoContextTakeover
+                                         : _options.serverNoContextTakeover;
+        if (noContextTakeover)
+            releaseDecompressor();
+    }
+}
+
+
+void PerMessageDeflate::releaseCompressor()
+{
+    if (_deflate) {
+        deflateEnd(_deflate);
+        delete _deflate;
+        _deflate = nullptr;
+    }
+}
+
+
+void PerMessageDeflate::releaseDecompressor()
+{
+    if (_inflate) {
+        inflateEnd(_inflate);
+        delete _inflate;
+        _inflate = nullptr;
+    }
+    _inflated = 0;
+}
+
+
+void PerMessageDeflate::setMaxMessageSize(size_t size)
+{
+    _options.maxMessageSize = size;
+}
+
+
+const DeflateOptions& PerMessageDeflate::options() const
+{
+    return _options;
+}
+
+
+size_t PerMessageDeflate::memoryUsage() const
+{
+    return _memory;
+}
+
+
+size_t PerMessageDeflate::totalMemoryUsage()
+{
+    return _totalMemory.load();
+}
+
+
+void* PerMessageDeflate::zalloc(void* opaque, unsigned items, unsigned size)
+{
+    size_t bytes = size_t(items) * size;
+    auto block = static_cast<char*>(std::malloc(HeaderSize + bytes));
+    if (!block)
+        return nullptr;
+    std::memcpy(block, &bytes, sizeof(bytes));
+    static_cast<PerMessageDeflate*>(opaque)->_memory += bytes;
+    _totalMemory += bytes;
+    return block + HeaderSize;
+}
+
+
+void PerMessageDeflate::zfree(void* opaque, void* address)
+{
+    auto block = static_cast<char*>(address) - HeaderSize;
+    size_t bytes;
+    std::memcpy(&bytes, block, sizeof(bytes));
+    static_cast<PerMessageDeflate*>(opaque)->_memory -= bytes;
+    _totalMemory -= bytes;
+    std::free(block);
+}
+
+
+} // namespace ws
+} // namespace http
+} // namespace scy
+
+
+/// @\}
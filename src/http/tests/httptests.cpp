@@ -103,6 +103,192 @@ int main(int argc, char** argv)
         expect(params.get("0") == "streaming");
     });
 
+    //
+    /// HTTP Parser Tests
+    //
+
+    describe("http parser", []() {
+        const std::string data =
+            "GET /streaming?format=MJPEG&width=400 HTTP/1.1\r\n"
+            "Host: localhost:1337\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101 Firefox/60.0\r\n"
+            "Accept: text/html,application/xhtml+xml\r\n"
+            "X-Multi: one\r\n"
+            "X-Multi: two\r\n"
+            "Connection: keep-alive\r\n"
+            "\r\n";
+
+        // Parse as a whole, split mid header and one byte at a time so
+        // tokens both point into the read buffer and span reads.
+        for (size_t chunk : { data.size(), data.size() / 2, (size_t)1 }) {
+            http::Request request;
+            http::Parser parser(&request);
+            std::string buffer;
+            for (size_t pos = 0; pos < data.size(); pos += chunk) {
+                // Copy each chunk so earlier reads are overwritten
+                buffer.assign(data, pos, chunk);
+                expect(parser.parse(buffer.data(), buffer.size()) == buffer.size());
+                buffer.assign(buffer.size(), 'x');
+            }
+            expect(parser.complete());
+            expect(request.getMethod() == "GET");
+            expect(request.getURI() == "/streaming?format=MJPEG&width=400");
+            expect(request.size() == 6);
+            expect(request.get("host") == "localhost:1337");
+            expect(request.get("User-Agent") == "Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101 Firefox/60.0");
+            expect(request.get("Accept") == "text/html,application/xhtml+xml");
+            expect(request.get("Connection") == "keep-alive");
+            auto it = request.find("X-Multi");
+            expect(it != request.end() && it->second == "one");
+            expect(++it != request.end() && it->second == "two");
+        }
+
+        // Headers may be handled as spans without being stored
+        struct SpanObserver : public http::ParserObserver
+        {
+            std::string headers;
+            bool complete = false;
+            void onParserHeader(const std::string&, const std::string&) override { expect(0 && "not called"); }
+            void onParserHeader(const ConstBuffer& name, const ConstBuffer& value) override
+            {
+                headers.append(name.cstr(), name.size()).append("=").append(value.cstr(), value.size()).append(";");
+            }
+            void onParserHeadersEnd(bool) override {}
+            void onParserChunk(const char*, size_t) override {}
+            void onParserEnd() override { complete = true; }
+            void onParserError(const Error&) override {}
+        };
+        for (size_t chunk : { data.size(), (size_t)1 }) {
+            http::Request request;
+            http::Parser parser(&request);
+            SpanObserver observer;
+            parser.setObserver(&observer);
+            parser.setStoreHeaders(false);
+            for (size_t pos = 0; pos < data.size(); pos += chunk)
+                parser.parse(data.data() + pos, std::min(chunk, data.size() - pos));
+            expect(observer.complete);
+            expect(request.empty());
+            expect(observer.headers.find("Host=localhost:1337;User-Agent=Mozilla") == 0);
+            expect(observer.headers.find("X-Multi=one;X-Multi=two;Connection=keep-alive;") != std::string::npos);
+        }
+    });
+
+    describe("http parser benchmark", []() {
+        const std::string data =
+            "GET /index.html HTTP/1.1\r\n"
+            "Host: localhost:1337\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101 Firefox/60.0\r\n"
+            "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+            "Accept-Language: en-US,en;q=0.5\r\n"
+            "Accept-Encoding: gzip, deflate\r\n"
+            "Cookie: session=0123456789abcdef0123456789abcdef\r\n"
+            "Connection: keep-alive\r\n"
+            "\r\n";
+
+        const int iterations = 100000;
+        http::Request request;
+        http::Parser parser(&request);
+        const uint64_t benchstart = time::hrtime();
+        for (int i = 0; i < iterations; i++) {
+            request.clear();
+            parser.reset();
+            parser.parse(data.data(), data.size());
+        }
+        const uint64_t benchdone = time::hrtime();
+        expect(parser.complete());
+        expect(request.size() == 7);
+
+        std::cout << "http parser benchmark: "
+            << ((benchdone - benchstart) * 1.0 / iterations) << "ns "
+            << "per request" << std::endl;
+    });
+
+    describe("chunked and multipart packetizers", []() {
+        std::vector<std::string> frames;
+        int gathered = 0;
+        auto collect = [&](IPacket& packet) {
+            Buffer buf;
+            packet.write(buf);
+            frames.emplace_back(buf.begin(), buf.end());
+            if (dynamic_cast<GatherPacket*>(&packet))
+                gathered++;
+        };
+
+        std::string payload(1000, 'x');
+        RawPacket packet(&payload[0], payload.size());
+
+        // Each chunk is emitted as a single gather packet
+        http::ChunkedAdapter chunked("text/plain");
+        chunked.emitter += collect;
+        chunked.process(packet);
+        chunked.process(packet);
+        expect(frames.size() == 3); // response header and two chunks
+        expect(gathered == 2);
+        expect(frames[1] == "3e8\r\n" + payload + "\r\n");
+        expect(frames[2] == frames[1]);
+
+        // Copy mode emits a contiguous packet
+        frames.clear();
+        gathered = 0;
+        http::ChunkedAdapter copying("text/plain", "\r\n", false);
+        copying.emitter += collect;
+        copying.process(packet);
+        expect(frames.size() == 2);
+        expect(gathered == 0);
+        expect(frames[1] == "3e8\r\n\r\n" + payload + "\r\n");
+
+        // Each part is emitted as a single gather packet
+        frames.clear();
+        gathered = 0;
+        http::MultipartAdapter multipart("image/jpeg");
+        multipart.emitter += collect;
+        multipart.process(packet);
+        expect(frames.size() == 2);
+        expect(gathered == 1);
+        expect(frames[1] == "--end\r\nContent-Type: image/jpeg\r\n\r\n" + payload + "\r\n");
+
+        // A gather packet is sent in a single socket write
+        auto pair = net::MemorySocket::createPair();
+        pair.first->enableStats();
+        std::string received;
+        net::SocketEmitter emitter(pair.second);
+        emitter.Recv += [&](net::Socket&, const MutableBuffer& buffer, const net::Address&) {
+            received.append(bufferCast<const char*>(buffer), buffer.size());
+        };
+        http::ChunkedAdapter sender("text/plain");
+        sender.emitter += [&](IPacket& packet) {
+            pair.first->sendPacket(packet, 0);
+        };
+        sender.process(packet);
+        expect(pair.first->stats().packetsOut == 2);
+        pair.first->close();
+        uv::runLoop();
+        const std::string chunk = "3e8\r\n" + payload + "\r\n";
+        expect(received.size() > chunk.size());
+        expect(received.substr(received.size() - chunk.size()) == chunk);
+    });
+
+    describe("chunked packetizer benchmark", []() {
+        const int iterations = 100000;
+        std::string payload(1024, 'x');
+        RawPacket packet(&payload[0], payload.size());
+        size_t total = 0;
+
+        http::ChunkedAdapter chunked("text/plain");
+        chunked.emitter += [&](IPacket& packet) {
+            total += packet.size();
+        };
+        const uint64_t benchstart = time::hrtime();
+        for (int i = 0; i < iterations; i++)
+            chunked.process(packet);
+        const uint64_t benchdone = time::hrtime();
+        expect(total > payload.size() * iterations);
+
+        std::cout << "chunked packetizer benchmark: "
+            << ((benchdone - benchstart) * 1.0 / iterations) << "ns "
+            << "per packet" << std::endl;
+    });
+
     //
     /// Default HTTP Client Connection Test
     //
@@ -234,6 +420,768 @@ int main(int argc, char** argv)
         expect(!conn->error().any());
     });
 
+    //
+    /// Server Timeout Test
+    //
+
+    describe("server timeouts", []() {
+        http::Server server(net::Address("127.0.0.1", 1339));
+        http::ServerTimeouts timeouts;
+        timeouts.header = 200;
+        timeouts.body = 200;
+        timeouts.idle = 200;
+        timeouts.write = 0;
+        server.setTimeouts(timeouts);
+        server.Connection += [](http::ServerConnection::Ptr conn) {
+            conn->response().add("Content-Length", "0");
+            conn->sendHeader();
+        };
+        server.start();
+
+        // Partial headers, an incomplete body, and a complete request
+        // followed by silence on a keep-alive connection.
+        static const std::vector<std::string> requests{
+            "GET / HTTP/1.1\r\nHost: loc",
+            "POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\nabc",
+            "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"
+        };
+        int closed = 0;
+        std::vector<net::SocketEmitter> clients;
+        clients.reserve(requests.size() + 1);
+        for (auto& request : requests) {
+            clients.emplace_back(std::make_shared<net::TCPSocket>());
+            auto& client = clients.back();
+            client.Connect += [request](net::Socket& socket) {
+                socket.send(request.c_str(), request.length());
+            };
+            client.Close += [&](net::Socket&) {
+                if (++closed == (int)requests.size() + 1)
+                    server.shutdown();
+            };
+            client->connect("127.0.0.1", 1339);
+        }
+
+        // A second request trickled a byte at a time on a keep-alive
+        // connection is held to the header timeout
+        Timer trickle(50, 50);
+        clients.emplace_back(std::make_shared<net::TCPSocket>());
+        auto& keepAlive = clients.back();
+        keepAlive.Connect += [](net::Socket& socket) {
+            socket.send(requests[2].c_str(), requests[2].length());
+        };
+        keepAlive.Recv += [&](net::Socket& socket, const MutableBuffer&, const net::Address&) {
+            if (trickle.active())
+                return;
+            const std::string header("GET / HTTP/1.1\r\nX-Trickle: ");
+            socket.send(header.c_str(), header.length());
+            trickle.start([&]() { keepAlive->send("a", 1); });
+        };
+        keepAlive.Close += [&](net::Socket&) {
+            trickle.stop();
+            if (++closed == (int)clients.size())
+                server.shutdown();
+        };
+        keepAlive->connect("127.0.0.1", 1339);
+
+        const uint64_t start = time::hrtime();
+        uv::runLoop();
+        const uint64_t elapsed = (time::hrtime() - start) / 1000000;
+
+        expect(closed == 4);
+        expect(server.numConnections() == 0);
+        expect(server.timeoutStats().header == 2);
+        expect(server.timeoutStats().body == 1);
+        expect(server.timeoutStats().idle == 1);
+        expect(server.timeoutStats().write == 0);
+        expect(elapsed >= 200 && elapsed < 2000);
+    });
+
+    //
+    /// Memory Transport Benchmarks
+    //
+
+    describe("http response single write", []() {
+        http::Server server(net::Address("127.0.0.1", 0));
+        server.enableStats();
+        server.Connection += [](http::ServerConnection::Ptr conn) {
+            conn->response().setContentLength(5);
+            conn->send("hello", 5);
+        };
+
+        auto pair = net::MemorySocket::createPair();
+        server.accept(pair.second);
+        auto conn = std::make_shared<http::ClientConnection>(
+            http::URL("http://127.0.0.1/"), pair.first);
+        std::string body;
+        bool complete = false;
+        conn->Payload += [&](const MutableBuffer& buffer) {
+            body.append(bufferCast<const char*>(buffer), buffer.size());
+        };
+        conn->Complete += [&](const http::Response& response) {
+            expect(response.getStatus() == http::StatusCode::OK);
+            expect(response.has("Date"));
+            expect(response.getDate().epochTime() > 0);
+            complete = true;
+            conn->close();
+        };
+        conn->send();
+        uv::runLoop();
+
+        expect(complete);
+        expect(body == "hello");
+
+        // The header and body were submitted together
+        expect(server.stats().packetsOut == 1);
+    });
+
+    describe("file responder", []() {
+        std::string root(SCY_BUILD_DIR);
+        fs::addnode(root, "fileresponder");
+        fs::mkdirr(root);
+        std::string path(root);
+        fs::addnode(path, "media.mp4");
+        std::string data;
+        for (int i = 0; data.size() < 1024 * 1024; i++)
+            data += std::to_string(i) + ",";
+        expect(fs::savefile(path, data.data(), data.size()));
+
+        auto factory = new http::FileResponderFactory(root);
+        auto file = factory->cache().open(path);
+        expect(file && file->size == data.size());
+        expect(file->contentType == std::string("video/mp4"));
+        const std::string etag(file->etag);
+        file.reset();
+
+        http::Server server(net::Address("127.0.0.1", 1340), net::makeSocket<net::TCPSocket>(), factory);
+        server.start();
+
+        // The full file, a byte range, a cached copy, a missing file
+        // and an attempt to leave the root directory
+        const std::vector<std::string> requests{
+            "GET /media.mp4 HTTP/1.1\r\nConnection: close\r\n\r\n",
+            "GET /media.mp4 HTTP/1.1\r\nRange: bytes=100-199\r\nConnection: close\r\n\r\n",
+            "GET /media.mp4 HTTP/1.1\r\nIf-None-Match: " + etag + "\r\nConnection: close\r\n\r\n",
+            "GET /missing.mp4 HTTP/1.1\r\nConnection: close\r\n\r\n",
+            "GET /../media.mp4 HTTP/1.1\r\nConnection: close\r\n\r\n"
+        };
+        std::vector<std::string> responses(requests.size());
+        int closed = 0;
+        std::vector<net::SocketEmitter> clients;
+        clients.reserve(requests.size() + 1);
+        for (size_t i = 0; i < requests.size(); i++) {
+            clients.emplace_back(std::make_shared<net::TCPSocket>());
+            auto& client = clients.back();
+            auto& request = requests[i];
+            auto& response = responses[i];
+            client.Connect += [&request](net::Socket& socket) {
+                socket.send(request.c_str(), request.length());
+            };
+            client.Recv += [&response](net::Socket&, const MutableBuffer& buffer, const net::Address&) {
+                response.append(bufferCast<const char*>(buffer), buffer.size());
+            };
+            client.Close += [&](net::Socket&) {
+                if (++closed == (int)requests.size() + 1)
+                    server.shutdown();
+            };
+            client->connect("127.0.0.1", 1340);
+        }
+
+        // Revalidations and misses on a persistent connection, which
+        // stays open until the last request asks for it to be closed
+        const std::vector<std::string> sequence{
+            "GET /media.mp4 HTTP/1.1\r\nIf-None-Match: " + etag + "\r\n\r\n",
+            "GET /missing.mp4 HTTP/1.1\r\n\r\n",
+            "GET /media.mp4 HTTP/1.1\r\nIf-None-Match: " + etag + "\r\nConnection: close\r\n\r\n"
+        };
+        std::vector<std::string> persistent;
+        clients.emplace_back(std::make_shared<net::TCPSocket>());
+        auto& keepAlive = clients.back();
+        keepAlive.Connect += [&](net::Socket& socket) {
+            persistent.emplace_back();
+            socket.send(sequence[0].c_str(), sequence[0].length());
+        };
+        keepAlive.Recv += [&](net::Socket& socket, const MutableBuffer& buffer, const net::Address&) {
+            // Each response is a header without a body
+            persistent.back().append(bufferCast<const char*>(buffer), buffer.size());
+            if (persistent.back().find("\r\n\r\n") == std::string::npos ||
+                persistent.size() == sequence.size())
+                return;
+            auto& next = sequence[persistent.size()];
+            persistent.emplace_back();
+            socket.send(next.c_str(), next.length());
+        };
+        keepAlive.Close += [&](net::Socket&) {
+            if (++closed == (int)requests.size() + 1)
+                server.shutdown();
+        };
+        keepAlive->connect("127.0.0.1", 1340);
+        uv::runLoop();
+
+        auto body = [](const std::string& response) {
+            size_t pos = response.find("\r\n\r\n");
+            return pos == std::string::npos ? std::string() : response.substr(pos + 4);
+        };
+        expect(closed == (int)requests.size() + 1);
+        expect(responses[0].find("HTTP/1.1 200 OK\r\n") == 0);
+        expect(responses[0].find("ETag: " + etag) != std::string::npos);
+        expect(body(responses[0]) == data);
+        expect(responses[1].find("HTTP/1.1 206 Partial Content\r\n") == 0);
+        expect(responses[1].find("Content-Range: bytes 100-199/" + std::to_string(data.size())) != std::string::npos);
+        expect(body(responses[1]) == data.substr(100, 100));
+        expect(responses[2].find("HTTP/1.1 304 Not Modified\r\n") == 0);
+        expect(body(responses[2]).empty());
+        expect(responses[3].find("HTTP/1.1 404 Not Found\r\n") == 0);
+        expect(responses[4].find("HTTP/1.1 400 Bad Request\r\n") == 0);
+        expect(persistent.size() == sequence.size());
+        expect(persistent[0].find("HTTP/1.1 304 Not Modified\r\n") == 0);
+        expect(persistent[0].find("Connection: Keep-Alive\r\n") != std::string::npos);
+        expect(persistent[1].find("HTTP/1.1 404 Not Found\r\n") == 0);
+        expect(persistent[1].find("Connection: Keep-Alive\r\n") != std::string::npos);
+        expect(persistent[2].find("HTTP/1.1 304 Not Modified\r\n") == 0);
+        expect(persistent[2].find("Connection: Close\r\n") != std::string::npos);
+
+        // Sockets without sendfile() read the file in chunks
+        auto pair = net::MemorySocket::createPair();
+        server.accept(pair.second);
+        auto conn = std::make_shared<http::ClientConnection>(
+            http::URL("http://127.0.0.1/media.mp4"), pair.first);
+        conn->request().set("Range", "bytes=-70000");
+        std::string received;
+        conn->Payload += [&](const MutableBuffer& buffer) {
+            received.append(bufferCast<const char*>(buffer), buffer.size());
+        };
+        conn->Complete += [&](const http::Response& response) {
+            expect(response.getStatus() == http::StatusCode::PartialContent);
+            conn->close();
+        };
+        conn->send();
+        uv::runLoop();
+
+        expect(received == data.substr(data.size() - 70000));
+        expect(factory->cache().size() == 1);
+        fs::unlink(path);
+        fs::rmdir(root);
+    });
+
+    describe("http memory transport benchmark", []() {
+        const int iterations = 2000;
+        http::Server server(net::Address("127.0.0.1", 0));
+        server.Connection += [](http::ServerConnection::Ptr conn) {
+            conn->response().add("Content-Length", "0");
+            conn->response().add("Connection", "close");
+            conn->sendHeader();
+        };
+
+        int numComplete = 0;
+        std::vector<http::ClientConnection::Ptr> conns;
+        const uint64_t benchstart = time::hrtime();
+        for (int i = 0; i < iterations; i++) {
+            auto pair = net::MemorySocket::createPair();
+            server.accept(pair.second);
+            auto conn = std::make_shared<http::ClientConnection>(
+                http::URL("http://127.0.0.1/"), pair.first);
+            auto ptr = conn.get();
+            conn->Complete += [&, ptr](const http::Response& response) {
+                expect(response.getStatus() == http::StatusCode::OK);
+                numComplete++;
+                ptr->close();
+            };
+            conn->send();
+            conns.push_back(conn);
+        }
+        uv::runLoop();
+        const uint64_t benchdone = time::hrtime();
+
+        expect(numComplete == iterations);
+        expect(server.numConnections() == 0);
+
+        // Time the parsers alone on the same exchange, so the remainder
+        // is spent in the connections, adapters and memory pair
+        const std::string requestData =
+            "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+        const std::string responseData =
+            "HTTP/1.1 200 OK\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        http::Request request;
+        http::Response response;
+        http::Parser requestParser(&request);
+        http::Parser responseParser(&response);
+        const uint64_t parsestart = time::hrtime();
+        for (int i = 0; i < iterations; i++) {
+            request.clear();
+            requestParser.reset();
+            requestParser.parse(requestData.data(), requestData.size());
+            response.clear();
+            responseParser.reset();
+            responseParser.parse(responseData.data(), responseData.size());
+        }
+        const uint64_t parsedone = time::hrtime();
+        expect(requestParser.complete() && responseParser.complete());
+
+        std::cout << "http memory transport benchmark: "
+            << ((benchdone - benchstart) * 1.0 / iterations) << "ns "
+            << "per request, of which parsing "
+            << ((parsedone - parsestart) * 1.0 / iterations) << "ns" << std::endl;
+    });
+
+    describe("websocket memory transport benchmark", []() {
+        const int iterations = 20000;
+        http::Server server(net::Address("127.0.0.1", 0));
+        server.Connection += [](http::ServerConnection::Ptr conn) {
+            conn->Payload += [](http::ServerConnection& conn, const MutableBuffer& buffer) {
+                conn.send(bufferCast<const char*>(buffer), buffer.size());
+            };
+        };
+
+        auto pair = net::MemorySocket::createPair();
+        server.accept(pair.second);
+        auto conn = std::make_shared<http::ClientConnection>(
+            http::URL("ws://127.0.0.1/websocket"), pair.first);
+        conn->replaceAdapter(new http::ws::ConnectionAdapter(conn.get(), http::ws::ClientSide));
+
+        int numReceived = 0;
+        conn->Payload += [&](const MutableBuffer& buffer) {
+            expect(buffer.size() == 4);
+            if (++numReceived < iterations)
+                conn->send("PING", 4);
+            else
+                conn->close();
+        };
+
+        const uint64_t benchstart = time::hrtime();
+        conn->send("PING", 4);
+        uv::runLoop();
+        const uint64_t benchdone = time::hrtime();
+
+        expect(numReceived == iterations);
+        expect(server.numConnections() == 0);
+
+        // Time the framers alone on the same round trip, so the remainder
+        // is spent in the connections, adapters and memory pair
+        http::ws::WebSocketFramer clientFramer(http::ws::ClientSide);
+        http::ws::WebSocketFramer serverFramer(http::ws::ServerSide);
+        http::Request request;
+        http::Response response;
+        clientFramer.createClientHandshakeRequest(request);
+        serverFramer.acceptServerRequest(request, response);
+        clientFramer.completeClientHandshake(response);
+
+        Buffer frame(32);
+        size_t total = 0;
+        const uint64_t framestart = time::hrtime();
+        for (int i = 0; i < iterations; i++) {
+            char* payload = nullptr;
+            BitWriter out(frame.data(), frame.size());
+            clientFramer.writeFrame("PING", 4, http::ws::SendFlags::Binary, out);
+            BitReader in(out.begin(), out.position());
+            total += serverFramer.readFrame(in, payload);
+            BitWriter back(frame.data(), frame.size());
+            serverFramer.writeFrame("PING", 4, http::ws::SendFlags::Binary, back);
+            BitReader reply(back.begin(), back.position());
+            total += clientFramer.readFrame(reply, payload);
+        }
+        const uint64_t framedone = time::hrtime();
+        expect(total == 8u * iterations);
+
+        std::cout << "websocket memory transport benchmark: "
+            << ((benchdone - benchstart) * 1.0 / iterations) << "ns "
+            << "per message round trip, of which framing "
+            << ((framedone - framestart) * 1.0 / iterations) << "ns" << std::endl;
+    });
+
+    describe("websocket masking", []() {
+        const char key[4] = { '\x12', '\x34', '\x56', '\x78' };
+        std::string data(300, '\0');
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = static_cast<char>(i * 7);
+
+        // Compare against the byte at a time reference for every length
+        // and alignment, both in place and out of place
+        char out[320];
+        for (size_t align = 0; align < 8; align++) {
+            for (size_t len = 0; len <= 256; len++) {
+                std::string expected(data, align, len);
+                for (size_t i = 0; i < len; i++)
+                    expected[i] ^= key[i % 4];
+
+                http::ws::mask(&data[align], out + (7 - align), len, key);
+                expect(std::string(out + (7 - align), len) == expected);
+
+                std::string inplace(data, align, len);
+                http::ws::mask(&inplace[0], &inplace[0], len, key);
+                expect(inplace == expected);
+            }
+        }
+
+        // Frames round trip between a client and server framer
+        http::ws::WebSocketFramer client(http::ws::ClientSide);
+        http::ws::WebSocketFramer server(http::ws::ServerSide);
+        http::Request request;
+        http::Response response;
+        client.createClientHandshakeRequest(request);
+        server.acceptServerRequest(request, response);
+        client.completeClientHandshake(response);
+
+        for (size_t len : { (size_t)5, (size_t)300, (size_t)70000 }) {
+            std::string payload(len, 'x');
+            for (size_t i = 0; i < len; i++)
+                payload[i] = static_cast<char>(i * 13);
+
+            Buffer buffer;
+            buffer.reserve(len + 14);
+            BitWriter writer(buffer);
+            client.writeFrame(payload.data(), len, http::ws::SendFlags::Binary, writer);
+            expect(writer.position() > len);
+
+            char* received = nullptr;
+            BitReader reader(writer.begin(), writer.position());
+            expect(server.readFrame(reader, received) == len);
+            expect(std::string(received, len) == payload);
+
+            // Frames written to a growing buffer are masked in place
+            Buffer dynamic;
+            DynamicBitWriter dwriter(dynamic);
+            client.writeFrame(payload.data(), len, http::ws::SendFlags::Binary, dwriter);
+            BitReader dreader(dwriter.begin(), dwriter.position());
+            expect(server.readFrame(dreader, received) == len);
+            expect(std::string(received, len) == payload);
+        }
+    });
+
+    describe("websocket permessage-deflate", []() {
+        using http::ws::PerMessageDeflate;
+        http::ws::DeflateOptions options;
+        options.enabled = true;
+
+        // Negotiation
+        expect(PerMessageDeflate::offer(options) == "permessage-deflate; client_max_window_bits");
+        std::string response;
+        std::unique_ptr<PerMessageDeflate> server(PerMessageDeflate::negotiate(
+            "permessage-deflate; client_max_window_bits", options, response));
+        expect(server && response == "permessage-deflate");
+        expect(!PerMessageDeflate::negotiate("permessage-deflate; foo", options, response));
+        expect(!PerMessageDeflate::negotiate("x-webkit-deflate-frame", options, response));
+        server.reset(PerMessageDeflate::negotiate(
+            "permessage-deflate; server_max_window_bits=8, permessage-deflate; server_max_window_bits=10", options, response));
+        expect(server && response == "permessage-deflate; server_max_window_bits=10");
+
+        http::ws::DeflateOptions limited(options);
+        limited.clientNoContextTakeover = true;
+        server.reset(PerMessageDeflate::negotiate(
+            "permessage-deflate; client_max_window_bits=10", limited, response));
+        expect(server && response == "permessage-deflate; client_no_context_takeover; client_max_window_bits=10");
+        PerMessageDeflate client(options, false);
+        client.accept(response);
+        expect(client.options().clientNoContextTakeover);
+        expect(client.options().clientMaxWindowBits == 10);
+
+        // Messages round trip, and since the client may not take over its
+        // context both sides release their zlib memory after each message
+        std::string message;
+        for (int i = 0; i < 200; i++)
+            message += "{\"type\":\"message\",\"from\":\"user" + std::to_string(i % 7) + "\",\"data\":\"hello\"},";
+        Buffer compressed, inflated;
+        size_t previous = 0;
+        for (int i = 0; i < 3; i++) {
+            client.compress(message.data(), message.size(), compressed);
+            expect(compressed.size() < message.size() / 4);
+            expect(!previous || compressed.size() == previous);
+            expect(client.memoryUsage() == 0);
+            previous = compressed.size();
+
+            // Decompress as two frames
+            inflated.clear();
+            size_t half = compressed.size() / 2;
+            server->decompress(compressed.data(), half, false, inflated);
+            server->decompress(compressed.data() + half, compressed.size() - half, true, inflated);
+            expect(std::string(inflated.begin(), inflated.end()) == message);
+            expect(server->memoryUsage() == 0);
+        }
+
+        // The server takes over its context, so repeats shrink
+        server->compress(message.data(), message.size(), compressed);
+        size_t first = compressed.size();
+        expect(server->memoryUsage() > 0);
+        expect(PerMessageDeflate::totalMemoryUsage() >= server->memoryUsage());
+        server->compress(message.data(), message.size(), compressed);
+        expect(compressed.size() < first);
+
+        // Oversized messages are rejected
+        http::ws::DeflateOptions small(options);
+        small.maxMessageSize = 1000;
+        PerMessageDeflate bounded(small, true);
+        client.compress(message.data(), message.size(), compressed);
+        try {
+            inflated.clear();
+            bounded.decompress(compressed.data(), compressed.size(), true, inflated);
+            expect(0 && "must throw");
+        } catch (std::exception&) {
+        }
+        expect(bounded.memoryUsage() == 0);
+
+        // Compressed messages are exchanged over a connection
+        http::Server httpServer(net::Address("127.0.0.1", 0));
+        httpServer.setWebSocketDeflate(options);
+        httpServer.Connection += [](http::ServerConnection::Ptr conn) {
+            conn->Payload += [](http::ServerConnection& conn, const MutableBuffer& buffer) {
+                conn.send(bufferCast<const char*>(buffer), buffer.size());
+            };
+        };
+
+        auto pair = net::MemorySocket::createPair();
+        pair.first->enableStats();
+        httpServer.accept(pair.second);
+        auto conn = std::make_shared<http::ClientConnection>(
+            http::URL("ws://127.0.0.1/websocket"), pair.first);
+        auto adapter = new http::ws::ConnectionAdapter(conn.get(), http::ws::ClientSide);
+        adapter->setDeflateOptions(options);
+        adapter->setMaxMessageSize(message.size());
+        conn->replaceAdapter(adapter);
+
+        // Inflated messages are bound by the adapter's limit
+        int numReceived = 0;
+        conn->Payload += [&](const MutableBuffer& buffer) {
+            expect(adapter->deflate() != nullptr);
+            expect(adapter->deflate()->options().maxMessageSize == message.size());
+
+            // Control frames and fragments are sent uncompressed
+            const int fin = unsigned(http::ws::FrameFlags::Fin);
+            expect(adapter->shouldCompress(message.size(), http::ws::SendFlags::Text));
+            expect(adapter->shouldCompress(message.size(), http::ws::SendFlags::Binary));
+            expect(!adapter->shouldCompress(message.size(), unsigned(http::ws::Opcode::Text)));
+            expect(!adapter->shouldCompress(message.size(), fin));
+            expect(!adapter->shouldCompress(100, fin | unsigned(http::ws::Opcode::Ping)));
+            expect(!adapter->shouldCompress(10, http::ws::SendFlags::Text));
+            expect(buffer.str() == message);
+            if (++numReceived < 3)
+                conn->send(message.data(), message.size());
+            else
+                conn->close();
+        };
+        conn->send(message.data(), message.size());
+        uv::runLoop();
+
+        expect(numReceived == 3);
+        expect(pair.first->stats().bytesOut < message.size());
+    });
+
+    describe("websocket broadcast group", []() {
+        std::string message;
+        for (int i = 0; i < 20; i++)
+            message += "{\"type\":\"presence\",\"user\":\"user" + std::to_string(i) + "\"},";
+
+        http::ws::DeflateOptions options;
+        options.enabled = true;
+        http::Server server(net::Address("127.0.0.1", 0));
+        server.setWebSocketDeflate(options);
+
+        // Members are added once upgraded, and each broadcasts to the
+        // group when all are ready
+        http::ws::BroadcastGroup group;
+        int numReady = 0;
+        server.Connection += [&](http::ServerConnection::Ptr conn) {
+            expect(group.add(conn));
+            expect(!group.add(conn));
+            conn->Payload += [&](http::ServerConnection&, const MutableBuffer&) {
+                if (++numReady < 3)
+                    return;
+                for (int i = 0; i < 3; i++)
+                    expect(group.broadcast(message) == 3);
+
+                // Members now have the messages queued, so they are slow
+                group.setSlowMemberPolicy(http::ws::SlowMemberPolicy::Skip, 0);
+                expect(group.broadcast(message) == 0);
+                group.setSlowMemberPolicy(http::ws::SlowMemberPolicy::Close, 0);
+                expect(group.broadcast(message) == 0);
+                expect(group.size() == 0);
+            };
+        };
+
+        std::vector<http::ClientConnection::Ptr> clients;
+        std::vector<net::Socket::Ptr> sockets;
+        int numReceived = 0;
+        for (int i = 0; i < 3; i++) {
+            auto pair = net::MemorySocket::createPair();
+            pair.first->enableStats();
+            server.accept(pair.second);
+            auto conn = std::make_shared<http::ClientConnection>(
+                http::URL("ws://127.0.0.1/websocket"), pair.first);
+            auto adapter = new http::ws::ConnectionAdapter(conn.get(), http::ws::ClientSide);
+            if (i == 0)
+                adapter->setDeflateOptions(options);
+            conn->replaceAdapter(adapter);
+            conn->Payload += [&](const MutableBuffer& buffer) {
+                expect(buffer.str() == message);
+                numReceived++;
+            };
+            conn->send("ready", 5);
+            clients.push_back(conn);
+            sockets.push_back(pair.first);
+        }
+        uv::runLoop();
+
+        expect(numReceived == 9);
+        auto& stats = group.stats();
+        expect(stats.messages == 5);
+        expect(stats.delivered == 9);
+        expect(stats.compressed == 3);
+        expect(stats.skipped == 3);
+        expect(stats.closed == 3);
+        expect(stats.failed == 0);
+
+        // The member using permessage-deflate received less
+        expect(sockets[0]->stats().bytesIn < sockets[1]->stats().bytesIn);
+        expect(sockets[1]->stats().bytesIn == sockets[2]->stats().bytesIn);
+        group.resetStats();
+        expect(group.stats().messages == 0);
+    });
+
+    describe("websocket frame reassembly", []() {
+        const int text = unsigned(http::ws::Opcode::Text);
+        const int fin = unsigned(http::ws::FrameFlags::Fin);
+        const int ping = fin | unsigned(http::ws::Opcode::Ping);
+
+        // A fragmented message with a ping between its frames
+        http::ws::WebSocketFramer framer(http::ws::ClientSide);
+        std::string frames;
+        auto writeFrame = [&](const std::string& data, int flags) {
+            Buffer frame(data.size() + 14);
+            BitWriter writer(frame.data(), frame.size());
+            framer.writeFrame(data.data(), data.size(), flags, writer);
+            frames.append(frame.data(), writer.position());
+        };
+        writeFrame("abcde", text);
+        writeFrame("ping", ping);
+        writeFrame("fghij", fin);
+        writeFrame(std::string(300, 'x'), fin | text);
+
+        // A frame with a 64 bit length, kept apart from the others
+        const size_t numFrameBytes = frames.size();
+        writeFrame(std::string(70000, 'y'), fin | text);
+        const std::string large = frames.substr(numFrameBytes);
+        frames.resize(numFrameBytes);
+
+        http::Server server(net::Address("127.0.0.1", 0));
+        http::ws::ConnectionAdapter* adapter = nullptr;
+        http::ServerConnection::Ptr serverConn;
+        std::vector<std::pair<std::string, bool>> received;
+        server.Connection += [&](http::ServerConnection::Ptr conn) {
+            serverConn = conn;
+            adapter = dynamic_cast<http::ws::ConnectionAdapter*>(conn->adapter());
+            conn->Payload += [&](http::ServerConnection& conn, const MutableBuffer& buffer) {
+                received.push_back({ buffer.str(), adapter->messageComplete() });
+                if (buffer.str() == "hello")
+                    conn.send("hello", 5);
+            };
+        };
+
+        // Feed the frames to the server a byte at a time, or in two reads
+        // split at the given offset, and join the pieces of each message
+        // received
+        auto feed = [&](const std::string& data, size_t split = 0) {
+            received.clear();
+            Buffer copy(data.begin(), data.end());
+            size_t offset = 0;
+            while (offset < copy.size()) {
+                size_t n = split ? (offset ? copy.size() - offset : split) : 1;
+                adapter->onSocketRecv(*serverConn->socket(), mutableBuffer(&copy[offset], n),
+                                      serverConn->socket()->peerAddress());
+                offset += n;
+            }
+            std::vector<std::string> messages(1);
+            for (auto& piece : received) {
+                messages.back() += piece.first;
+                if (piece.second)
+                    messages.emplace_back();
+            }
+            messages.pop_back();
+            return messages;
+        };
+
+        auto pair = net::MemorySocket::createPair();
+        server.accept(pair.second);
+        auto conn = std::make_shared<http::ClientConnection>(
+            http::URL("ws://127.0.0.1/websocket"), pair.first);
+        conn->replaceAdapter(new http::ws::ConnectionAdapter(conn.get(), http::ws::ClientSide));
+        conn->Payload += [&](const MutableBuffer&) {
+            // Payload is streamed as it arrives by default, while
+            // control frames are delivered whole
+            auto messages = feed(frames);
+            expect(received.size() == 311);
+            expect(received[4].first == "e" && !received[4].second);
+            expect(received[5].first == "ping" && received[5].second);
+            expect(received[10].first == "j" && received[10].second);
+            expect(messages.size() == 3);
+            expect(messages[2] == std::string(300, 'x'));
+
+            // Whole messages are delivered once reassembled
+            adapter->setReassembleMessages(true);
+            messages = feed(frames);
+            expect(received.size() == 3);
+            expect(messages.size() == 3);
+            expect(messages[0] == "ping");
+            expect(messages[1] == "abcdefghij");
+            expect(messages[2] == std::string(300, 'x'));
+
+            // Headers split inside their first two bytes, their 16 or 64
+            // bit length or their mask are buffered up to their end, and
+            // the payload which follows is delivered
+            const std::string medium = frames.substr(frames.size() - 308);
+            for (size_t split : { 1, 3, 6 }) {
+                messages = feed(medium, split);
+                expect(messages.size() == 1);
+                expect(messages[0] == std::string(300, 'x'));
+            }
+            for (size_t split : { 1, 5, 12 }) {
+                messages = feed(large, split);
+                expect(messages.size() == 1);
+                expect(messages[0] == std::string(70000, 'y'));
+            }
+
+            // Messages which are too big are rejected by their header
+            adapter->setMaxMessageSize(100);
+            feed(frames.substr(frames.size() - 308, 4));
+            expect(!serverConn->closed());
+            feed(frames.substr(frames.size() - 304, 4));
+            expect(serverConn->closed() || serverConn->socket()->error().any());
+        };
+        conn->send("hello", 5);
+        uv::runLoop();
+
+        expect(adapter != nullptr);
+    });
+
+    describe("websocket framer benchmark", []() {
+        const int iterations = 2000;
+        const size_t len = 65536;
+        http::ws::WebSocketFramer client(http::ws::ClientSide);
+        http::ws::WebSocketFramer server(http::ws::ServerSide);
+        http::Request request;
+        http::Response response;
+        client.createClientHandshakeRequest(request);
+        server.acceptServerRequest(request, response);
+        client.completeClientHandshake(response);
+
+        std::string payload(len, 'x');
+        Buffer buffer;
+        buffer.reserve(len + 14);
+        size_t total = 0;
+        const uint64_t benchstart = time::hrtime();
+        for (int i = 0; i < iterations; i++) {
+            BitWriter writer(buffer);
+            client.writeFrame(payload.data(), len, http::ws::SendFlags::Binary, writer);
+            char* received = nullptr;
+            BitReader reader(writer.begin(), writer.position());
+            total += server.readFrame(reader, received);
+        }
+        const uint64_t benchdone = time::hrtime();
+        expect(total == len * iterations);
+
+        // Each byte is masked by the client and unmasked by the server
+        std::cout << "websocket framer benchmark: "
+            << (total * 1000.0 / (benchdone - benchstart)) << "MB/s "
+            << "masked and unmasked" << std::endl;
+    });
+
     //
     /// Google Drive Upload Test
     //
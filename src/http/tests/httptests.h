@@ -8,16 +8,20 @@
 #include "scy/filesystem.h"
 #include "scy/http/client.h"
 #include "scy/http/connection.h"
+#include "scy/http/fileresponder.h"
 #include "scy/http/form.h"
 #include "scy/http/packetizers.h"
 #include "scy/http/server.h"
 #include "scy/http/url.h"
 #include "scy/http/util.h"
 #include "scy/http/websocket.h"
+#include "scy/http/websocketbroadcast.h"
 #include "scy/idler.h"
+#include "scy/net/memorysocket.h"
 #include "scy/net/sslcontext.h"
 #include "scy/net/sslmanager.h"
 #include "scy/test.h"
+#include "scy/time.h"
 #include "scy/timer.h"
 
 #include "../samples/httpechoserver/httpechoserver.h"
@@ -14,8 +14,8 @@
 
 
 #include "scy/net/net.h"
+#include <functional>
 #include <string>
-#include <memory>
 
 
 namespace scy {
@@ -26,7 +26,9 @@ namespace net {
 /// address. The address can belong either to the
 /// IPv4 or the IPv6 address family and consists of a
 /// host address and a port number.
-class Net_API AddressBase;
+///
+/// The native socket address is stored inline, so addresses are
+/// trivially copyable values which never allocate.
 class Net_API Address
 {
 public:
@@ -47,7 +49,7 @@ public:
     Address(const std::string& host, uint16_t port);
 
     /// Creates a Address by copying another one.
-    Address(const Address& addr);
+    Address(const Address& addr) = default;
 
     /// Creates a Address from a native socket address.
     Address(const struct sockaddr* addr, socklen_t length);
@@ -74,10 +76,10 @@ public:
     explicit Address(const std::string& hostAndPort);
 
     /// Destroys the Address.
-    ~Address();
+    ~Address() = default;
 
     /// Assigns another Address.
-    Address& operator=(const Address& addr);
+    Address& operator=(const Address& addr) = default;
 
     /// Swaps the Address with another one.
     void swap(Address& addr);
@@ -107,10 +109,15 @@ public:
     /// ie. not wildcard.
     bool valid() const;
 
+    /// Returns a hash of the binary address and port.
+    size_t hash() const;
+
     static uint16_t resolveService(const std::string& service);
 
     static bool validateIP(const std::string& address);
 
+    /// Addresses are ordered by family, then host address bytes, then
+    /// port. Comparisons operate on the binary address.
     bool operator<(const Address& addr) const;
     bool operator==(const Address& addr) const;
     bool operator!=(const Address& addr) const;
@@ -125,7 +132,7 @@ protected:
     void init(const std::string& host, uint16_t port);
 
 private:
-    std::shared_ptr<AddressBase> _base;
+    struct sockaddr_storage _addr;
 };
 
 
@@ -133,6 +140,22 @@ private:
 } // namespace scy
 
 
+namespace std {
+
+
+template <>
+struct hash<scy::net::Address>
+{
+    size_t operator()(const scy::net::Address& addr) const
+    {
+        return addr.hash();
+    }
+};
+
+
+} // namespace std
+
+
 #endif // SCY_Net_Address_H
 
 
@@ -19,6 +19,11 @@
 #include "scy/logger.h"
 #include "scy/util.h"
 
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 
 namespace scy {
 namespace net {
@@ -27,6 +32,9 @@ namespace net {
 namespace dns {
 
 
+/// Resolves the given host with a fresh system lookup.
+///
+/// Use Resolver::instance() to share cached and in-flight lookups.
 inline auto resolve(const std::string& host, int port,
                     std::function<void(int,const net::Address&)> callback,
                     uv::Loop* loop = uv::defaultLoop())
@@ -42,6 +50,87 @@ inline auto resolve(const std::string& host, int port,
 }
 
 
+/// Caching DNS resolver.
+///
+/// Answers are cached per host for the positive TTL, and failures for the
+/// negative TTL, since the system resolver does not expose record TTLs.
+/// Concurrent lookups for the same host are coalesced into a single
+/// uv_getaddrinfo request, so connection storms don't saturate the libuv
+/// threadpool.
+///
+/// A resolver is not thread-safe and must be used from its loop thread.
+/// Sockets resolve via the shared instance() of their loop.
+class Net_API Resolver
+{
+public:
+    typedef std::function<void(int, const net::Address&)> Callback;
+
+    Resolver(uv::Loop* loop = uv::defaultLoop());
+    ~Resolver();
+
+    /// Returns the shared resolver for the given loop.
+    static Resolver& instance(uv::Loop* loop = uv::defaultLoop());
+
+    /// Resolves the given host, invoking the callback with the address
+    /// and port or a libuv error code.
+    ///
+    /// Cached answers and IP addresses are returned synchronously,
+    /// otherwise the callback is invoked once the lookup completes.
+    void resolve(const std::string& host, uint16_t port, Callback callback);
+
+    /// Resolves the given host in the background so that subsequent
+    /// connections are answered from the cache.
+    void prewarm(const std::string& host);
+
+    /// Removes the cached answer for the given host.
+    void remove(const std::string& host);
+
+    /// Removes all cached answers. Lookups in flight are not affected.
+    void clear();
+
+    /// Sets the time in milliseconds that answers and failures are cached.
+    /// The defaults are 60 and 5 seconds respectively.
+    void setTTL(uint64_t positive, uint64_t negative);
+    uint64_t positiveTTL() const;
+    uint64_t negativeTTL() const;
+
+    /// Returns the number of cached hosts.
+    size_t size() const;
+
+    /// Returns the number of lookups issued to the system resolver.
+    uint64_t lookups() const;
+
+    uv::Loop* loop() const;
+
+protected:
+    struct Waiter
+    {
+        uint16_t port;
+        Callback callback;
+    };
+
+    struct Entry
+    {
+        int status = 0;
+        net::Address address;
+        uint64_t expires = 0;
+        bool pending = false;
+        std::vector<Waiter> waiters;
+    };
+
+    void lookup(const std::string& host);
+    void onLookup(const std::string& host, int status, const net::Address& address);
+    void purge();
+
+    uv::Loop* _loop;
+    std::shared_ptr<Resolver*> _self; ///< Reset on destruction for pending lookups
+    std::unordered_map<std::string, Entry> _entries;
+    uint64_t _positiveTTL;
+    uint64_t _negativeTTL;
+    uint64_t _lookups;
+};
+
+
 } // namespace dns
 } // namespace net
 } // namespace scy
@@ -0,0 +1,131 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup net
+/// @{
+
+
+#ifndef SCY_Net_MemorySocket_H
+#define SCY_Net_MemorySocket_H
+
+
+#include "scy/base.h"
+#include "scy/handle.h"
+#include "scy/net/address.h"
+#include "scy/net/net.h"
+#include "scy/net/socket.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+
+namespace scy {
+namespace net {
+
+
+/// In-process stream socket which exchanges data with a paired socket
+/// on the same event loop without making any system calls.
+///
+/// Memory sockets behave like connected TCP sockets, so protocol layers
+/// such as HTTP, WebSocket and STUN run on them unchanged. This makes them
+/// suitable for benchmarking those layers in isolation from the kernel.
+///
+/// Data sent on one side is received by the other on the next loop
+/// iteration, with all data sent in the meantime coalesced into a single
+/// receive. Closing either side closes the other once it has received
+/// any pending data.
+class Net_API MemorySocket : public uv::Handle<uv_idle_t>, public net::Socket
+{
+public:
+    typedef std::shared_ptr<MemorySocket> Ptr;
+    typedef std::vector<Ptr> Vec;
+
+    MemorySocket(uv::Loop* loop = uv::defaultLoop());
+    virtual ~MemorySocket();
+
+    /// Creates a pair of connected sockets on the given loop.
+    static std::pair<Ptr, Ptr> createPair(uv::Loop* loop = uv::defaultLoop());
+
+    /// Connects two open and unpaired sockets to each other.
+    /// Each side reports the other's bound address as its peer address.
+    static void pair(MemorySocket& a, MemorySocket& b);
+
+    /// Emits the Connect signal on the next loop iteration.
+    /// The address is ignored since the socket must already be paired,
+    /// otherwise the connection is refused.
+    virtual void connect(const net::Address& peerAddress) override;
+    virtual void connect(const std::string& host, uint16_t port) override;
+
+    /// Closes the peer once it has received all pending data.
+    virtual bool shutdown() override;
+    virtual void close() override;
+
+    /// Sets the address reported by address(), and by the peer's
+    /// peerAddress() once paired. No resources are bound.
+    virtual void bind(const net::Address& address, unsigned flags = 0) override;
+
+    virtual ssize_t send(const char* data, size_t len, int flags = 0) override;
+    virtual ssize_t send(const char* data, size_t len,
+                         const net::Address& peerAddress, int flags = 0) override;
+    virtual ssize_t sendv(const ConstBuffer* bufs, size_t nbufs, int flags = 0) override;
+
+    /// Returns the number of bytes sent but not yet received by the peer.
+    size_t pending() const;
+
+    /// Returns true if the socket is connected to a peer.
+    bool paired() const;
+
+    virtual net::Address address() const override;
+    virtual net::Address peerAddress() const override;
+
+    /// Returns the TCP transport protocol.
+    virtual net::TransportType transport() const override;
+
+    virtual void setError(const scy::Error& err) override;
+    virtual const scy::Error& error() const override;
+
+    virtual bool closed() const override;
+
+    virtual uv::Loop* loop() const override;
+
+    virtual void* self() override;
+
+protected:
+    virtual void init() override;
+    virtual void reset() override;
+
+    virtual void onError(const scy::Error& error) override;
+    virtual void onClose() override;
+
+    /// Starts the idle handle so pending events are delivered on the
+    /// next loop iteration.
+    void schedule();
+
+    /// Delivers the pending connect, data and close events.
+    void deliver();
+
+    static void onIdle(uv_idle_t* handle);
+
+    MemorySocket* _peer{nullptr};
+    net::Address _address;
+    net::Address _peerAddress;
+    Buffer _incoming;
+    Buffer _reading;
+    bool _connecting{false};
+    bool _eof{false};
+};
+
+
+} // namespace net
+} // namespace scy
+
+
+#endif // SCY_Net_MemorySocket_H
+
+
+/// @\}
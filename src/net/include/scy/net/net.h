@@ -64,6 +64,27 @@ typedef int socklen_t;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(3,9,0)
 #define SCY_HAS_KERNEL_SOCKET_LOAD_BALANCING 1
 #endif
+
+// Linux Kernel 3.0 added the sendmmsg() system call which, along with
+// recvmmsg(), transfers multiple datagrams with a single syscall.
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,0,0)
+#define SCY_HAS_KERNEL_MMSG 1
+#endif
+
+// Linux Kernel 4.18 added UDP generic segmentation offload (UDP_SEGMENT),
+// and 5.0 added UDP generic receive offload (UDP_GRO). Support is also
+// checked at runtime since the running kernel may be older.
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,18,0)
+#define SCY_HAS_KERNEL_UDP_GSO 1
+#endif
+
+// Linux Kernel 4.13 added kernel TLS (the "tls" TCP ULP) which encrypts
+// data written to a TCP socket using keys negotiated in user space.
+// TLS 1.3 and additional ciphers were added in later releases, so
+// support is also checked at runtime.
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,13,0)
+#define SCY_HAS_KERNEL_TLS 1
+#endif
 #endif
 
 
@@ -16,7 +16,9 @@
 #include "scy/base.h"
 #include "scy/packetfactory.h"
 #include "scy/packetsignal.h"
+#include "scy/packetstream.h"
 #include "scy/net/socket.h"
+#include "scy/net/tcpsocket.h"
 #include "scy/net/socketemitter.h"
 
 
@@ -51,47 +53,65 @@ public:
 };
 
 
-#if 0
 //
-// Packet Socket
+// Packet Stream Socket Adapter
 //
 
 
-class Net_API PacketSocket: public PacketSocketEmitter
+/// Proxies PacketStream packets to an output TCP socket.
+///
+/// When the socket write queue exceeds its high watermark the upstream
+/// PacketStream is paused, and packets bypass the adapter until the queue
+/// drains to the low watermark and the stream is resumed. This keeps memory
+/// bounded when the peer is slower than the producer.
+///
+/// The stream must be processed on the socket's event loop thread.
+class Net_API PacketStreamSocketAdapter : public PacketProcessor
 {
 public:
-    PacketSocket(Socket* socket);
-    //PacketSocket(Socket* base, bool shared = false);
-    virtual ~PacketSocket();    /// Returns the PacketSocketEmitter for this socket.
-    //PacketSocketEmitter& adapter() const;
+    PacketStreamSocketAdapter(const TCPSocket::Ptr& socket, PacketStream* stream = nullptr);
+    virtual ~PacketStreamSocketAdapter();
 
-    /// Compatibility method for PacketSignal delegates.
-    //virtual void send(IPacket& packet);
+    /// Sets the upstream PacketStream to pause on write pressure.
+    void setStream(PacketStream* stream);
+
+    /// Returns the output socket.
+    TCPSocket::Ptr socket() const;
+
+    /// Returns true if the adapter has paused the stream.
+    bool paused() const;
+
+    virtual void process(IPacket& packet) override;
+
+    PacketSignal emitter;
 
+protected:
+    virtual void onPressure(const size_t& size);
+    virtual void onDrain(const size_t& size);
+
+    TCPSocket::Ptr _socket;
+    PacketStream* _stream;
+    bool _paused;
 };
 
 
+#if 0
 //
-// Packet Stream Socket Adapter
+// Packet Socket
 //
 
-/// Proxies arbitrary PacketStream packets to an output Socket,
-/// ensuring the Socket MTU is not exceeded.
-/// Oversize packets will be split before sending.
-class Net_API PacketStreamSocketAdapter: public PacketProcessor, public PacketSignal
+
+class Net_API PacketSocket: public PacketSocketEmitter
 {
 public:
-    PacketStreamSocketAdapter(Socket& socket);
-    virtual ~PacketStreamSocketAdapter();
-
-protected:
-    virtual bool accepts(IPacket* packet);
-    virtual void process(IPacket& packet);
-    virtual void onStreamStateChange(const PacketStreamState& state);
+    PacketSocket(Socket* socket);
+    //PacketSocket(Socket* base, bool shared = false);
+    virtual ~PacketSocket();    /// Returns the PacketSocketEmitter for this socket.
+    //PacketSocketEmitter& adapter() const;
 
-    friend class PacketStream;
+    /// Compatibility method for PacketSignal delegates.
+    //virtual void send(IPacket& packet);
 
-    Socket _socket;
 };
 #endif
 
@@ -22,6 +22,7 @@
 #include "scy/net/socketadapter.h"
 
 #include "uv.h"
+#include <algorithm>
 
 
 namespace scy {
@@ -38,6 +39,35 @@ inline std::shared_ptr<SocketT> makeSocket(uv::Loop* loop = uv::defaultLoop())
 }
 
 
+/// Per-socket traffic counters. See Socket::enableStats().
+///
+/// Counters are measured at the application boundary, so for SSL
+/// sockets bytes are counted before encryption and after decryption.
+/// For TCP a packet is a single send or read.
+struct SocketStats
+{
+    uint64_t bytesIn { 0 };
+    uint64_t bytesOut { 0 };
+    uint64_t packetsIn { 0 };
+    uint64_t packetsOut { 0 };
+    uint64_t sendErrors { 0 };
+    size_t writeQueueHighWater { 0 }; ///< Largest write queue size in bytes
+    uint64_t callbackTime { 0 }; ///< Nanoseconds spent in receive callbacks
+
+    SocketStats& operator+=(const SocketStats& r)
+    {
+        bytesIn += r.bytesIn;
+        bytesOut += r.bytesOut;
+        packetsIn += r.packetsIn;
+        packetsOut += r.packetsOut;
+        sendErrors += r.sendErrors;
+        writeQueueHighWater = std::max(writeQueueHighWater, r.writeQueueHighWater);
+        callbackTime += r.callbackTime;
+        return *this;
+    }
+};
+
+
 /// Base socket implementation from which all sockets derive.
 class Net_API Socket : public SocketAdapter
 {
@@ -83,6 +113,15 @@ public:
     /// Closes the underlying socket.
     virtual void close() = 0;
 
+    /// Sends a buffer which may be shared with other sockets, such as a
+    /// frame broadcast to many connections. Sockets which write without
+    /// copying hold a reference to the buffer until the write completes.
+    /// By default a copy is sent.
+    virtual ssize_t sendShared(const std::shared_ptr<const Buffer>& buffer, int flags = 0)
+    {
+        return send(buffer->data(), buffer->size(), flags);
+    }
+
     /// The locally bound address.
     ///
     /// This function will not throw.
@@ -114,6 +153,29 @@ public:
     /// Returns the socket event loop.
     virtual uv::Loop* loop() const = 0;
 
+    /// Enables or disables the collection of traffic counters.
+    /// Stats are disabled by default and cost a branch per operation.
+    void enableStats(bool flag = true)
+    {
+        if (!flag)
+            _stats.reset();
+        else if (!_stats)
+            _stats = std::make_shared<SocketStats>();
+    }
+
+    /// Returns true if traffic counters are being collected.
+    bool statsEnabled() const { return !!_stats; }
+
+    /// Returns the traffic counters, which are all zero if disabled.
+    SocketStats stats() const { return _stats ? *_stats : SocketStats(); }
+
+    /// Resets the traffic counters.
+    void resetStats()
+    {
+        if (_stats)
+            *_stats = SocketStats();
+    }
+
     /// Optional client data pointer.
     ///
     /// The pointer is set to null on initialization
@@ -121,6 +183,38 @@ public:
     void* opaque { nullptr };
 
 protected:
+    /// Records the result of a send made by the application.
+    void recordSend(ssize_t result, size_t packets, size_t queueSize)
+    {
+        if (!_stats)
+            return;
+        if (result < 0)
+            _stats->sendErrors++;
+        else {
+            _stats->bytesOut += static_cast<uint64_t>(result);
+            _stats->packetsOut += packets;
+        }
+        if (queueSize > _stats->writeQueueHighWater)
+            _stats->writeQueueHighWater = queueSize;
+    }
+
+    /// Emits received data to the application, recording it if stats
+    /// are enabled. The counters are held by reference since the socket
+    /// may be destroyed by the callback.
+    void emitRecv(const MutableBuffer& buffer, const Address& peerAddress)
+    {
+        if (!_stats)
+            return onSocketRecv(*this, buffer, peerAddress);
+        auto stats = _stats;
+        stats->bytesIn += buffer.size();
+        stats->packetsIn++;
+        uint64_t start = uv_hrtime();
+        onSocketRecv(*this, buffer, peerAddress);
+        stats->callbackTime += uv_hrtime() - start;
+    }
+
+    std::shared_ptr<SocketStats> _stats;
+
     /// Initializes the underlying socket context.
     virtual void init() = 0;
 
@@ -54,7 +54,17 @@ public:
     virtual ssize_t send(const char* data, size_t len, int flags = 0);
     virtual ssize_t send(const char* data, size_t len, const Address& peerAddress, int flags = 0);
 
+    /// Sends the given buffers to the connected peer as a single write
+    /// where the transport allows, so a header and body can go out in one
+    /// system call. The buffers need not outlive the call.
+    /// Returns the number of bytes sent or -1 on error.
+    ///
+    /// The default implementation copies the buffers into a single send(),
+    /// so adapters which transform outgoing data need only override send().
+    virtual ssize_t sendv(const ConstBuffer* bufs, size_t nbufs, int flags = 0);
+
     /// Sends the given packet to the connected peer.
+    /// A GatherPacket is sent with sendv().
     /// Returns the number of bytes sent or -1 on error.
     /// No exception will be thrown.
     /// For TCP sockets the given peer address must match the
@@ -68,6 +78,14 @@ public:
     /// socket is closed.
     virtual void sendPacket(IPacket& packet);
 
+    /// Queues the given datagram to be sent along with other datagrams
+    /// batched in the current event loop iteration.
+    /// Returns the number of bytes queued or -1 on error.
+    /// No exception will be thrown.
+    /// Adapters and sockets which do not support batching send the data
+    /// immediately.
+    virtual ssize_t sendBatch(const char* data, size_t len, const Address& peerAddress, int flags = 0);
+
     /// Sets the pointer to the outgoing data adapter.
     /// Send methods proxy data to this adapter by default.
     virtual void setSender(SocketAdapter* adapter);
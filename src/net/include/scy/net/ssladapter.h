@@ -26,6 +26,13 @@
 #include <openssl/ssl.h>
 
 
+// Kernel TLS offload requires OpenSSL 1.1.1 for access to the TLS 1.3
+// traffic secrets and the HKDF and TLS PRF key derivation functions.
+#if defined(SCY_HAS_KERNEL_TLS) && OPENSSL_VERSION_NUMBER >= 0x10101000L
+#define SCY_HAS_SSL_KERNEL_TLS 1
+#endif
+
+
 namespace scy {
 namespace net {
 
@@ -35,6 +42,7 @@ namespace net {
 ///
 /// TODO: Decouple from SSLSocket implementation
 class Net_API SSLSocket;
+class Net_API SSLContext;
 class Net_API SSLAdapter
 {
 public:
@@ -66,24 +74,55 @@ public:
     /// Flushes the SSL read/write buffers.
     void flush();
 
+    /// Encrypts and sends the given data.
+    ///
+    /// Once the handshake is complete data is encrypted directly from the
+    /// caller's buffer, otherwise it is queued until the handshake is done.
+    void write(const char* data, size_t len);
+
     void addIncomingData(const char* data, size_t len);
     void addOutgoingData(const std::string& data);
     void addOutgoingData(const char* data, size_t len);
 
+    /// Returns true when encryption of outgoing data has been
+    /// offloaded to the kernel.
+    bool kernelTLS() const;
+
 protected:
     void handleError(int rc);
 
     void flushReadBIO();
     void flushWriteBIO();
 
+    /// Requests kernel TLS offload if enabled on the context.
+    void initKernelTLS();
+
+    /// Installs the transmit keys into the kernel if kernel TLS was
+    /// requested, once all data encrypted in user space has been sent.
+    void tryKernelTLS();
+    bool installKernelTLS();
+
+    /// Sends a close_notify alert via the kernel.
+    void sendKernelAlert();
+
+    static void keylogCallback(const SSL* ssl, const char* line);
+    static void messageCallback(int writep, int version, int contentType,
+                                const void* buf, size_t len, SSL* ssl, void* arg);
+
 protected:
     friend class net::SSLSocket;
+    friend class net::SSLContext;
 
     net::SSLSocket* _socket;
     SSL* _ssl;
     BIO* _readBIO;  ///< The incoming buffer we write encrypted SSL data into
     BIO* _writeBIO; ///<  The outgoing buffer we write to the socket
     std::vector<char> _bufferOut; ///<  The outgoing payload to be encrypted and sent
+    std::vector<char> _bufferIn; ///<  The decrypted incoming payload
+    std::vector<char> _bufferWrite; ///<  The encrypted data handed over to the socket
+    std::vector<unsigned char> _trafficSecret; ///< TLS 1.3 transmit traffic secret
+    uint64_t _txSequence; ///< Records written under the transmit keys
+    int _kernelTLS; ///< Kernel TLS state: -1 off, 0 pending, 1 active
 };
 
 
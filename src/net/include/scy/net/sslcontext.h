@@ -196,7 +196,10 @@ public:
     /// For session caching to work, it must be enabled
     /// on the server, as well as on the client side.
     ///
-    /// The default is disabled session caching.
+    /// The default is disabled session caching on the server, and
+    /// enabled on the client where sessions are stored in the
+    /// SSLManager's SSLSessionCache and offered automatically when
+    /// reconnecting to the same peer.
     ///
     /// To enable session caching on the server side, use the
     /// two-argument version of this method to specify
@@ -261,6 +264,25 @@ public:
     /// The feature can be disabled by calling this method.
     void disableStatelessSessionResumption();
 
+    /// Enables kernel TLS offload for connections using this context.
+    ///
+    /// Once the handshake is complete the negotiated transmit keys are
+    /// installed into the kernel, after which outgoing data is written
+    /// to the socket unencrypted and may be sent using sendfile().
+    /// Incoming data is still decrypted by OpenSSL.
+    ///
+    /// Offload is only available on Linux for TLS 1.2 and 1.3 using
+    /// AES-GCM or ChaCha20-Poly1305. Connections fall back to user space
+    /// encryption when the cipher or kernel is not supported.
+    ///
+    /// Renegotiation is disabled for offloaded connections, and a
+    /// connection is closed with an error if the peer requests a TLS 1.3
+    /// key update, since OpenSSL can no longer write records.
+    void enableKernelTLS(bool flag = true);
+
+    /// Returns true if kernel TLS offload is enabled.
+    bool kernelTLSEnabled() const;
+
 private:
     /// Create a SSL_CTX object according to Context configuration.
     void createSSLContext();
@@ -269,6 +291,7 @@ private:
     VerificationMode _mode;
     SSL_CTX* _sslContext;
     bool _extendedVerificationErrorDetails;
+    bool _kernelTLS;
 };
 
 
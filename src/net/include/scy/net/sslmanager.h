@@ -49,6 +49,10 @@ public:
     /// Returns the default Context used by the client if initialized.
     SSLContext::Ptr defaultClientContext();
 
+    /// Returns the client side session cache used to resume
+    /// connections to previously visited peers.
+    SSLSessionCache& sessionCache();
+
     /// Fired whenever a certificate verification error is detected by the
     /// server during a handshake.
     Signal<void(VerificationErrorDetails&)> ServerVerificationError;
@@ -104,6 +108,11 @@ protected:
     static int privateKeyPassphraseCallback(char* pBuf, int size, int flag,
                                             void* userData);
 
+    /// Method is invoked by OpenSSL when a client session is established,
+    /// or a TLS 1.3 session ticket is received. The session is stored in
+    /// the session cache under the socket's session key.
+    static int newSessionCallback(SSL* ssl, SSL_SESSION* session);
+
 private:
     /// Creates the SSLManager.
     SSLManager();
@@ -118,6 +127,7 @@ private:
 
     SSLContext::Ptr _defaultServerContext;
     SSLContext::Ptr _defaultClientContext;
+    SSLSessionCache _sessionCache;
     std::mutex _mutex;
 
     friend class Singleton<SSLManager>;
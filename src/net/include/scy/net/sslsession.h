@@ -19,6 +19,12 @@
 
 #include <openssl/ssl.h>
 
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 
 namespace scy {
 namespace net {
@@ -57,6 +63,82 @@ protected:
 };
 
 
+/// Client side store of SSL sessions keyed by `host:port`.
+///
+/// Sessions are stored as they are issued by the server, including
+/// TLS 1.3 tickets which arrive after the handshake, and are offered
+/// on the next connection to the same peer. Entries are evicted in
+/// least recently used order once the cache is full, and discarded
+/// once older than the maximum age or the session's own timeout.
+///
+/// The default cache is owned by the SSLManager and is consulted
+/// automatically by client sockets whose SSLContext has session
+/// caching enabled.
+class Net_API SSLSessionCache
+{
+public:
+    SSLSessionCache(size_t maxSize = 256, long maxAge = 3600);
+    ~SSLSessionCache();
+
+    /// Returns the session stored for the given key, or nullptr.
+    /// Updates the hit and miss counters.
+    SSLSession::Ptr find(const std::string& key);
+
+    /// Stores the session for the given key, replacing any previous
+    /// session. Sessions which cannot be resumed are ignored.
+    void add(const std::string& key, SSLSession::Ptr session);
+
+    /// Removes the session stored for the given key.
+    void remove(const std::string& key);
+
+    /// Removes all sessions.
+    void clear();
+
+    /// Sets the maximum number of stored sessions.
+    /// A size of 0 disables the cache.
+    void setMaxSize(size_t size);
+    size_t maxSize() const;
+
+    /// Sets the maximum age of stored sessions in seconds.
+    void setMaxAge(long seconds);
+    long maxAge() const;
+
+    /// Returns the number of stored sessions.
+    size_t size() const;
+
+    /// Returns the number of lookups which returned a session.
+    uint64_t hits() const;
+
+    /// Returns the number of lookups which returned nothing.
+    uint64_t misses() const;
+
+    /// Returns the ratio of hits to lookups, or 0 if there were none.
+    double hitRate() const;
+
+    /// Resets the hit and miss counters.
+    void resetStats();
+
+protected:
+    struct Entry
+    {
+        std::string key;
+        SSLSession::Ptr session;
+        std::time_t created;
+    };
+
+    bool expired(const Entry& entry, std::time_t now) const;
+    void evict();
+
+    mutable std::mutex _mutex;
+    std::list<Entry> _entries; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+    size_t _maxSize;
+    long _maxAge;
+    uint64_t _hits;
+    uint64_t _misses;
+};
+
+
 } // namespace net
 } // namespace scy
 
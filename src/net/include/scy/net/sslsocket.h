@@ -48,6 +48,13 @@ public:
     /// The SSL handshake is performed when the socket is connected.
     // virtual void connect(const Address& peerAddress);
 
+    /// Resolves and connects to the given host.
+    ///
+    /// The `host:port` pair is used as the session cache key so that
+    /// sessions are resumed by host name rather than resolved address.
+    virtual void connect(const std::string& host, uint16_t port) override;
+    using TCPSocket::connect;
+
     virtual void bind(const net::Address& address, unsigned flags = 0) override;
     virtual void listen(int backlog = 64) override;
 
@@ -63,6 +70,19 @@ public:
     virtual ssize_t send(const char* data, size_t len,
                          const net::Address& peerAddress, int flags = 0) override;
 
+    /// Encrypts the buffers together, or writes them directly once the
+    /// keys have been offloaded to the kernel.
+    virtual ssize_t sendv(const ConstBuffer* bufs, size_t nbufs, int flags = 0) override;
+
+    /// Encrypts a copy of the buffer, or queues the buffer itself once
+    /// the keys have been offloaded to the kernel.
+    virtual ssize_t sendShared(const std::shared_ptr<const Buffer>& buffer, int flags = 0) override;
+
+    /// Sends the file with sendfile() once the keys have been offloaded
+    /// to the kernel. Returns false otherwise, since the file would need
+    /// to be encrypted in user space.
+    virtual bool sendFile(uv_file file, int64_t offset, size_t length, SendFileCallback callback) override;
+
     /// Use the given SSL context for this socket.
     void useContext(SSLContext::Ptr context);
 
@@ -90,6 +110,16 @@ public:
     /// the handshake.
     bool sessionWasReused();
 
+    /// Returns true when outgoing data is encrypted by the kernel,
+    /// in which case data may be written to the socket directly,
+    /// ie. using sendfile(). See SSLContext::enableKernelTLS().
+    bool kernelTLS() const;
+
+    /// Returns the key under which sessions for this connection are
+    /// stored in the SSLManager's session cache. This is the `host:port`
+    /// passed to connect(), or the peer address once connected.
+    const std::string& sessionKey() const;
+
     /// Returns the number of bytes available from the
     /// SSL buffer for immediate reading.
     int available() const;
@@ -107,9 +137,13 @@ public:
     virtual void onRead(const char* data, size_t len) override;
 
 protected:
+    /// Encrypts and submits data coalesced while corked.
+    virtual bool flush() override;
+
     net::SSLContext::Ptr _sslContext;
     net::SSLSession::Ptr _sslSession;
     net::SSLAdapter _sslAdapter;
+    std::string _sessionKey;
 
     friend class net::SSLAdapter;
 };
@@ -25,6 +25,25 @@ namespace scy {
 namespace net {
 
 
+/// Kernel TCP connection metrics. See TCPSocket::tcpInfo().
+struct TCPInfo
+{
+    uint32_t rtt { 0 };              ///< Smoothed round trip time in microseconds
+    uint32_t rttVariance { 0 };      ///< Round trip time variance in microseconds
+    uint32_t congestionWindow { 0 }; ///< Send congestion window in segments
+    uint32_t slowStartThreshold { 0 };
+    uint32_t mss { 0 };              ///< Send maximum segment size
+    uint32_t unacked { 0 };          ///< Segments in flight
+    uint32_t lost { 0 };             ///< Segments presumed lost
+    uint32_t retransmits { 0 };      ///< Total retransmitted segments
+};
+
+
+/// Callback for TCPSocket::sendFile() which receives the number of bytes
+/// sent, or a negative libuv error code.
+typedef std::function<void(int64_t result)> SendFileCallback;
+
+
 /// TCP socket implementation.
 class Net_API TCPSocket : public Stream<uv_tcp_t>, public net::Socket
 {
@@ -44,6 +63,29 @@ public:
     virtual ssize_t send(const char* data, size_t len, int flags = 0) override;
     virtual ssize_t send(const char* data, size_t len, const net::Address& peerAddress, int flags = 0) override;
 
+    /// Writes the buffers with a single vectored write, copying only
+    /// the data which cannot be written immediately.
+    virtual ssize_t sendv(const ConstBuffer* bufs, size_t nbufs, int flags = 0) override;
+
+    /// Queues the buffer without copying it, holding a reference to it
+    /// until the write completes.
+    virtual ssize_t sendShared(const std::shared_ptr<const Buffer>& buffer, int flags = 0) override;
+
+    /// Sends `length` bytes of the given file from `offset` using
+    /// `sendfile()`, so the data is not copied through user space.
+    ///
+    /// The transfer starts once any data already queued on the socket
+    /// has been written, and runs on the libuv thread pool while the
+    /// socket is writable. Nothing else should be sent until the callback
+    /// is invoked with the number of bytes sent, or a negative error code.
+    /// The result is UV_ECANCELED if the socket was closed meanwhile, in
+    /// which case the socket may already have been destroyed. The file
+    /// must remain open until then.
+    ///
+    /// Returns false if the socket is closed or the platform does not
+    /// support sendfile() on sockets (Linux only).
+    virtual bool sendFile(uv_file file, int64_t offset, size_t length, SendFileCallback callback);
+
     virtual void bind(const net::Address& address, unsigned flags = 0) override;
     virtual void listen(int backlog = 64) override;
 
@@ -54,6 +96,11 @@ public:
     bool setKeepAlive(bool enable, int delay);
     bool setSimultaneousAccepts(bool enable);
 
+    /// Reads the kernel's TCP_INFO metrics for the connection.
+    /// Returns false if the socket is closed or the platform does not
+    /// support TCP_INFO (Linux only).
+    bool tcpInfo(TCPInfo& info) const;
+
     void setMode(SocketMode mode);
     const SocketMode mode() const;
 
@@ -65,10 +112,12 @@ public:
 
     /// Returns the IP address and port number of the socket.
     /// A wildcard address is returned if the socket is not connected.
+    /// The address is cached once the socket is connected or accepted.
     net::Address address() const override;
 
     /// Returns the IP address and port number of the peer socket.
     /// A wildcard address is returned if the socket is not connected.
+    /// The address is cached once the socket is connected or accepted.
     net::Address peerAddress() const override;
 
     /// Returns the TCP transport protocol.
@@ -91,7 +140,17 @@ protected:
     virtual void init() override;
     virtual void reset() override;
 
+    /// Caches the local and peer addresses of a connected socket so
+    /// they are not queried from the kernel on each send and receive.
+    void cacheAddresses();
+
+    struct SendFileReq;
+    static void sendFileNext(SendFileReq* req);
+    static void sendFileFinish(SendFileReq* req, int64_t result);
+
     SocketMode _mode;
+    net::Address _address;
+    net::Address _peerAddress;
 };
 
 
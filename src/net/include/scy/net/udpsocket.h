@@ -18,6 +18,9 @@
 #include "scy/net/net.h"
 #include "scy/handle.h"
 
+#include <memory>
+#include <vector>
+
 
 namespace scy {
 namespace net {
@@ -43,6 +46,49 @@ public:
     virtual ssize_t send(const char* data, size_t len,
                          const net::Address& peerAddress, int flags = 0) override;
 
+    /// Queues a datagram to be sent with all other datagrams batched in the
+    /// current loop iteration. The data is copied.
+    ///
+    /// Queued datagrams are flushed before the event loop next polls for
+    /// I/O, using a single sendmmsg() call where supported, and
+    /// individual sends otherwise.
+    virtual ssize_t sendBatch(const char* data, size_t len,
+                              const net::Address& peerAddress, int flags = 0) override;
+
+    /// Sends any datagrams queued by sendBatch() immediately.
+    void flushBatch();
+
+    /// Sets the maximum number of datagrams to receive per loop wakeup.
+    ///
+    /// When greater than one, datagrams waiting after the first are read
+    /// with a single recvmmsg() call where supported. Batched datagrams
+    /// larger than `slotSize` are discarded.
+    /// A size of one (the default) disables batched receiving.
+    void setRecvBatchSize(size_t size, size_t slotSize = MAX_UDP_PACKET_SIZE);
+
+    /// Returns the maximum number of datagrams received per loop wakeup.
+    size_t recvBatchSize() const;
+
+    /// Sends `len` bytes as consecutive datagrams of `segmentSize` bytes,
+    /// the last of which may be shorter.
+    ///
+    /// On Linux the kernel splits the buffer via UDP generic segmentation
+    /// offload (UDP_SEGMENT), so up to 64 datagrams cost a single syscall.
+    /// Where GSO is unavailable the datagrams are sent as a batch.
+    virtual ssize_t sendSegmented(const char* data, size_t len, size_t segmentSize,
+                                  const net::Address& peerAddress, int flags = 0);
+
+    /// Enables or disables UDP generic receive offload.
+    ///
+    /// The kernel may then coalesce consecutive equally sized datagrams
+    /// from the same peer, which are split back into individual datagrams
+    /// before onRecv(). The socket must be bound first.
+    /// Return false if GRO is not supported.
+    bool setGRO(bool enable);
+
+    /// Return true if UDP generic receive offload is enabled.
+    bool gro() const;
+
     bool setBroadcast(bool flag);
     bool setMulticastLoop(bool flag);
     bool setMulticastTTL(int ttl);
@@ -75,12 +121,45 @@ protected:
     virtual bool recvStart();
     virtual bool recvStop();
 
+    /// Receives any further waiting datagrams in a single batch.
+    virtual void recvBatch();
+
+    /// Splits coalesced datagrams received via GRO before onRecv().
+    void recvSegments(char* data, size_t len, size_t segmentSize, const net::Address& address);
+
+    /// Reads the GRO segment size of the next datagram before libuv
+    /// receives it, since libuv does not expose control messages.
+    void peekSegmentSize();
+
+    /// Return true if the datagram may be sent to the given peer.
+    bool validatePeer(const net::Address& peerAddress) const;
+
+    static void handleFlush(uv_prepare_t* handle);
+
     static void onRecv(uv_udp_t* handle, ssize_t nread, const uv_buf_t* buf,
                        const struct sockaddr* addr, unsigned flags);
     static void allocRecvBuffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf);
 
+    /// Datagram queued by sendBatch().
+    struct Datagram
+    {
+        size_t offset;
+        size_t length;
+        net::Address peer;
+    };
+
+    struct RecvBatch;
+
     net::Address _peer;
     Buffer _buffer;
+    Buffer _batchBuffer;
+    std::vector<Datagram> _batch;
+    std::unique_ptr<uv::Handle<uv_prepare_t>> _flusher;
+    std::unique_ptr<RecvBatch> _recvBatch;
+    size_t _recvBatchSize{1};
+    size_t _groSegmentSize{0};
+    bool _gro{false};
+    int _gso{-1};
 };
 
 
@@ -14,6 +14,8 @@
 #include "scy/memory.h"
 #include "scy/util.h"
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 
 using std::endl;
@@ -23,145 +25,38 @@ namespace scy {
 namespace net {
 
 
-//
-// AddressBase
-//
-
-
-class Net_API AddressBase
-{
-public:
-    virtual std::string host() const = 0;
-    virtual uint16_t port() const = 0;
-    virtual Address::Family family() const = 0;
-    virtual socklen_t length() const = 0;
-    virtual const struct sockaddr* addr() const = 0;
-    virtual int af() const = 0;
+static_assert(std::is_trivially_copyable<Address>::value,
+              "Address must be trivially copyable");
 
-protected:
-    AddressBase() {}
-    virtual ~AddressBase() {}
 
-private:
-    AddressBase(const AddressBase&) = delete;
-    AddressBase& operator=(const AddressBase&) = delete;
-};
+namespace {
 
 
-//
-// IPv4AddressBase
-//
-
-
-class Net_API IPv4AddressBase : public AddressBase
+inline const struct sockaddr_in* in4(const struct sockaddr_storage& addr)
 {
-public:
-    IPv4AddressBase()
-    {
-        _addr.sin_family = AF_INET;
-        memset(&_addr, 0, sizeof(_addr));
-    }
-
-    IPv4AddressBase(const struct sockaddr_in* addr)
-    {
-        _addr.sin_family = AF_INET;
-        memcpy(&_addr, addr, sizeof(_addr));
-    }
-
-    IPv4AddressBase(const void* addr, uint16_t port)
-    {
-        memset(&_addr, 0, sizeof(_addr));
-        _addr.sin_family = AF_INET;
-        memcpy(&_addr.sin_addr, addr, sizeof(_addr.sin_addr));
-        _addr.sin_port = port;
-    }
-
-    std::string host() const
-    {
-        char dest[16];
-        if (uv_ip4_name(const_cast<sockaddr_in*>(&_addr), dest, 16) != 0)
-            throw std::runtime_error("Cannot parse IPv4 hostname");
-        return dest;
-    }
-
-    uint16_t port() const { return _addr.sin_port; }
-
-    Address::Family family() const { return Address::IPv4; }
-
-    socklen_t length() const { return sizeof(_addr); }
-
-    const struct sockaddr* addr() const
-    {
-        return reinterpret_cast<const struct sockaddr*>(&_addr);
-    }
-
-    int af() const { return _addr.sin_family; }
-
-private:
-    struct sockaddr_in _addr;
-};
-
-
-//
-// IPv6AddressBase
-//
-
-#if defined(SCY_HAVE_IPv6)
+    return reinterpret_cast<const struct sockaddr_in*>(&addr);
+}
 
 
-class Net_API IPv6AddressBase : public AddressBase
+inline const struct sockaddr_in6* in6(const struct sockaddr_storage& addr)
 {
-public:
-    IPv6AddressBase(const struct sockaddr_in6* addr)
-    {
-        _addr.sin6_family = AF_INET6;
-        memcpy(&_addr, addr, sizeof(_addr));
-    }
-
-    IPv6AddressBase(const void* addr, uint16_t port)
-    {
-        _addr.sin6_family = AF_INET6;
-        memset(&_addr, 0, sizeof(_addr));
-        memcpy(&_addr.sin6_addr, addr, sizeof(_addr.sin6_addr));
-        _addr.sin6_port = port;
-    }
-
-    IPv6AddressBase(const void* addr, uint16_t port, uint32_t scope)
-    {
-        _addr.sin6_family = AF_INET6;
-        memset(&_addr, 0, sizeof(_addr));
-        memcpy(&_addr.sin6_addr, addr, sizeof(_addr.sin6_addr));
-        _addr.sin6_port = port;
-        _addr.sin6_scope_id = scope;
-    }
-
-    std::string host() const
-    {
-        char dest[46];
-        if (uv_ip6_name(const_cast<sockaddr_in6*>(&_addr), dest, 46) != 0)
-            throw std::runtime_error("Cannot parse IPv6 hostname");
-        return dest;
-    }
-
-    uint16_t port() const { return _addr.sin6_port; }
-
-    Address::Family family() const { return Address::IPv6; }
-
-    socklen_t length() const { return sizeof(_addr); }
-
-    const struct sockaddr* addr() const
-    {
-        return reinterpret_cast<const struct sockaddr*>(&_addr);
-    }
+    return reinterpret_cast<const struct sockaddr_in6*>(&addr);
+}
 
-    int af() const { return _addr.sin6_family; }
 
-private:
-    struct sockaddr_in6 _addr;
-};
+/// Compares the host address bytes of two addresses of the same family.
+inline int compareHost(const struct sockaddr_storage& a,
+                       const struct sockaddr_storage& b)
+{
+    if (a.ss_family == AF_INET6)
+        return memcmp(&in6(a)->sin6_addr, &in6(b)->sin6_addr,
+                      sizeof(in6(a)->sin6_addr));
+    return memcmp(&in4(a)->sin_addr, &in4(b)->sin_addr,
+                  sizeof(in4(a)->sin_addr));
+}
 
 
-#endif // SCY_HAVE_IPv6
+} // namespace
 
 
 //
@@ -169,9 +64,10 @@ private:
 //
 
 
-Address::Address() :
-    _base(std::make_shared<IPv4AddressBase>())
+Address::Address()
 {
+    memset(&_addr, 0, sizeof(_addr));
+    _addr.ss_family = AF_INET;
 }
 
 
@@ -218,46 +114,31 @@ Address::Address(const std::string& hostAndPort)
 
 Address::Address(const struct sockaddr* addr, socklen_t length)
 {
-    if (length == sizeof(struct sockaddr_in))
-        _base = std::make_shared<IPv4AddressBase>(
-                reinterpret_cast<const struct sockaddr_in*>(addr));
+    memset(&_addr, 0, sizeof(_addr));
+    if (length == sizeof(struct sockaddr_in) && addr->sa_family == AF_INET)
+        memcpy(&_addr, addr, sizeof(struct sockaddr_in));
 #if defined(SCY_HAVE_IPv6)
-    else if (length == sizeof(struct sockaddr_in6))
-        _base = std::make_shared<IPv6AddressBase>(
-                reinterpret_cast<const struct sockaddr_in6*>(addr));
+    else if (length == sizeof(struct sockaddr_in6) && addr->sa_family == AF_INET6)
+        memcpy(&_addr, addr, sizeof(struct sockaddr_in6));
 #endif
     else
         throw std::runtime_error("Invalid address length passed to Address()");
 }
 
 
-Address::Address(const Address& addr)
-{
-    _base = addr._base;
-}
-
-
-Address::~Address()
-{
-}
-
-
-Address& Address::operator=(const Address& addr)
-{
-    if (&addr != this) {
-        _base = addr._base;
-    }
-    return *this;
-}
-
-
 void Address::init(const std::string& host, uint16_t port)
 {
-    char ia[sizeof(struct in6_addr)];
-    if (uv_inet_pton(AF_INET, host.c_str(), &ia) == 0)
-        _base = std::make_shared<IPv4AddressBase>(&ia, htons(port));
-    else if (uv_inet_pton(AF_INET6, host.c_str(), &ia) == 0)
-        _base = std::make_shared<IPv6AddressBase>(&ia, htons(port));
+    memset(&_addr, 0, sizeof(_addr));
+    auto v4 = reinterpret_cast<struct sockaddr_in*>(&_addr);
+    auto v6 = reinterpret_cast<struct sockaddr_in6*>(&_addr);
+    if (uv_inet_pton(AF_INET, host.c_str(), &v4->sin_addr) == 0) {
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons(port);
+    }
+    else if (uv_inet_pton(AF_INET6, host.c_str(), &v6->sin6_addr) == 0) {
+        v6->sin6_family = AF_INET6;
+        v6->sin6_port = htons(port);
+    }
     else
         throw std::runtime_error("Invalid IP address format: " + host);
 }
@@ -265,43 +146,78 @@ void Address::init(const std::string& host, uint16_t port)
 
 std::string Address::host() const
 {
-    return _base->host();
+    char dest[46];
+    if (_addr.ss_family == AF_INET6) {
+        if (uv_ip6_name(in6(_addr), dest, sizeof(dest)) != 0)
+            throw std::runtime_error("Cannot parse IPv6 hostname");
+    }
+    else if (uv_ip4_name(in4(_addr), dest, sizeof(dest)) != 0)
+        throw std::runtime_error("Cannot parse IPv4 hostname");
+    return dest;
 }
 
 
 uint16_t Address::port() const
 {
-    return ntohs(_base->port());
+    return ntohs(_addr.ss_family == AF_INET6 ? in6(_addr)->sin6_port
+                                             : in4(_addr)->sin_port);
 }
 
 
 Address::Family Address::family() const
 {
-    return _base->family();
+    return _addr.ss_family == AF_INET6 ? Address::IPv6 : Address::IPv4;
 }
 
 
 socklen_t Address::length() const
 {
-    return _base->length();
+    return _addr.ss_family == AF_INET6 ? sizeof(struct sockaddr_in6)
+                                       : sizeof(struct sockaddr_in);
 }
 
 
 const struct sockaddr* Address::addr() const
 {
-    return _base->addr();
+    return reinterpret_cast<const struct sockaddr*>(&_addr);
 }
 
 
 int Address::af() const
 {
-    return _base->af();
+    return _addr.ss_family;
 }
 
 
 bool Address::valid() const
 {
-    return host() != "0.0.0.0" && port() != 0;
+    // Only the IPv4 wildcard address is considered invalid
+    if (_addr.ss_family == AF_INET &&
+        in4(_addr)->sin_addr.s_addr == htonl(INADDR_ANY))
+        return false;
+    return port() != 0;
+}
+
+
+size_t Address::hash() const
+{
+    // FNV-1a over the host address bytes and port
+    const uint8_t* data;
+    size_t size;
+    if (_addr.ss_family == AF_INET6) {
+        data = reinterpret_cast<const uint8_t*>(&in6(_addr)->sin6_addr);
+        size = sizeof(in6(_addr)->sin6_addr);
+    }
+    else {
+        data = reinterpret_cast<const uint8_t*>(&in4(_addr)->sin_addr);
+        size = sizeof(in4(_addr)->sin_addr);
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    hash = (hash ^ port()) * 1099511628211ULL;
+    return static_cast<size_t>(hash ^ _addr.ss_family);
 }
 
 
@@ -321,33 +237,32 @@ std::string Address::toString() const
 
 bool Address::operator<(const Address& addr) const
 {
-    if (family() < addr.family())
-        return true;
-    return (port() < addr.port());
+    if (_addr.ss_family != addr._addr.ss_family)
+        return family() < addr.family();
+    int cmp = compareHost(_addr, addr._addr);
+    if (cmp != 0)
+        return cmp < 0;
+    return port() < addr.port();
 }
 
 
 bool Address::operator==(const Address& addr) const
 {
-    return host() == addr.host() && port() == addr.port();
+    return _addr.ss_family == addr._addr.ss_family &&
+           port() == addr.port() &&
+           compareHost(_addr, addr._addr) == 0;
 }
 
 
 bool Address::operator!=(const Address& addr) const
 {
-    return host() != addr.host() || port() != addr.port();
+    return !(*this == addr);
 }
 
 
-// void Address::swap(Address& a1, Address& a2)
-// {
-//     a1.swap(a2);
-// }
-
-
 void Address::swap(Address& addr)
 {
-    std::swap(_base, addr._base);
+    std::swap(_addr, addr._addr);
 }
 
 
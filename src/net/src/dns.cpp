@@ -0,0 +1,241 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup net
+/// @{
+
+
+#include "scy/net/dns.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+
+
+using namespace std;
+
+
+namespace scy {
+namespace net {
+namespace dns {
+
+
+namespace {
+
+
+/// The number of cached hosts above which expired answers are purged.
+const size_t PURGE_THRESHOLD = 1024;
+
+
+net::Address withPort(const net::Address& address, uint16_t port)
+{
+    struct sockaddr_storage addr;
+    std::memcpy(&addr, address.addr(), address.length());
+    if (addr.ss_family == AF_INET6)
+        reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port = htons(port);
+    else
+        reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port = htons(port);
+    return net::Address(reinterpret_cast<struct sockaddr*>(&addr), address.length());
+}
+
+
+} // namespace
+
+
+Resolver::Resolver(uv::Loop* loop)
+    : _loop(loop)
+    , _self(std::make_shared<Resolver*>(this))
+    , _positiveTTL(60 * 1000)
+    , _negativeTTL(5 * 1000)
+    , _lookups(0)
+{
+}
+
+
+Resolver::~Resolver()
+{
+    *_self = nullptr;
+}
+
+
+Resolver& Resolver::instance(uv::Loop* loop)
+{
+    static std::mutex mutex;
+    static std::map<uv::Loop*, std::unique_ptr<Resolver>> resolvers;
+
+    std::lock_guard<std::mutex> guard(mutex);
+    auto& resolver = resolvers[loop];
+    if (!resolver)
+        resolver.reset(new Resolver(loop));
+    return *resolver;
+}
+
+
+void Resolver::resolve(const std::string& host, uint16_t port, Callback callback)
+{
+    if (Address::validateIP(host)) {
+        callback(0, Address(host, port));
+        return;
+    }
+
+    auto it = _entries.find(host);
+    if (it != _entries.end()) {
+        Entry& entry = it->second;
+        if (entry.pending) {
+            entry.waiters.push_back(Waiter{port, std::move(callback)});
+            return;
+        }
+        if (uv_now(_loop) < entry.expires) {
+            if (entry.status)
+                callback(entry.status, net::Address{});
+            else
+                callback(0, withPort(entry.address, port));
+            return;
+        }
+    }
+
+    Entry& entry = _entries[host];
+    entry.waiters.push_back(Waiter{port, std::move(callback)});
+    if (!entry.pending)
+        lookup(host);
+}
+
+
+void Resolver::prewarm(const std::string& host)
+{
+    if (Address::validateIP(host))
+        return;
+
+    auto it = _entries.find(host);
+    if (it == _entries.end() ||
+        (!it->second.pending && uv_now(_loop) >= it->second.expires))
+        lookup(host);
+}
+
+
+void Resolver::lookup(const std::string& host)
+{
+    if (_entries.size() >= PURGE_THRESHOLD)
+        purge();
+
+    Entry& entry = _entries[host];
+    entry.pending = true;
+    _lookups++;
+
+    std::weak_ptr<Resolver*> self = _self;
+    uv::createRequest<uv::GetAddrInfoReq>([self, host](const uv::GetAddrInfoEvent& event) {
+        auto ptr = self.lock();
+        if (!ptr || !*ptr)
+            return;
+        if (event.status) {
+            LWarn("Cannot resolve DNS for ", host, ": ", uv_strerror(event.status))
+            (*ptr)->onLookup(host, event.status, net::Address{});
+        }
+        else
+            (*ptr)->onLookup(host, 0, net::Address{event.addr->ai_addr, static_cast<socklen_t>(event.addr->ai_addrlen)});
+    }).resolve(host, 0, _loop);
+}
+
+
+void Resolver::onLookup(const std::string& host, int status, const net::Address& address)
+{
+    Entry& entry = _entries[host];
+    entry.status = status;
+    entry.address = address;
+    entry.expires = uv_now(_loop) + (status ? _negativeTTL : _positiveTTL);
+    entry.pending = false;
+
+    // Callbacks may resolve again so take ownership of the waiters first
+    std::vector<Waiter> waiters;
+    waiters.swap(entry.waiters);
+    for (auto& waiter : waiters) {
+        if (status)
+            waiter.callback(status, net::Address{});
+        else
+            waiter.callback(0, withPort(address, waiter.port));
+    }
+}
+
+
+void Resolver::remove(const std::string& host)
+{
+    auto it = _entries.find(host);
+    if (it != _entries.end() && !it->second.pending)
+        _entries.erase(it);
+}
+
+
+void Resolver::clear()
+{
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        if (it->second.pending)
+            ++it;
+        else
+            it = _entries.erase(it);
+    }
+}
+
+
+void Resolver::purge()
+{
+    // Entries with waiters are kept, since the lookup which answers them
+    // may not have been issued yet
+    uint64_t now = uv_now(_loop);
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        Entry& entry = it->second;
+        if (!entry.pending && entry.waiters.empty() && now >= entry.expires)
+            it = _entries.erase(it);
+        else
+            ++it;
+    }
+}
+
+
+void Resolver::setTTL(uint64_t positive, uint64_t negative)
+{
+    _positiveTTL = positive;
+    _negativeTTL = negative;
+}
+
+
+uint64_t Resolver::positiveTTL() const
+{
+    return _positiveTTL;
+}
+
+
+uint64_t Resolver::negativeTTL() const
+{
+    return _negativeTTL;
+}
+
+
+size_t Resolver::size() const
+{
+    return _entries.size();
+}
+
+
+uint64_t Resolver::lookups() const
+{
+    return _lookups;
+}
+
+
+uv::Loop* Resolver::loop() const
+{
+    return _loop;
+}
+
+
+} // namespace dns
+} // namespace net
+} // namespace scy
+
+
+/// @\}
@@ -0,0 +1,297 @@
+///
+//
+// LibSourcey
+// Copyright (c) 2005, Sourcey <https://sourcey.com>
+//
+// SPDX-License-Identifier: LGPL-2.1+
+//
+/// @addtogroup net
+/// @{
+
+
+#include "scy/net/memorysocket.h"
+#include "scy/logger.h"
+
+
+using std::endl;
+
+
+namespace scy {
+namespace net {
+
+
+MemorySocket::MemorySocket(uv::Loop* loop)
+    : uv::Handle<uv_idle_t>(loop)
+{
+    // LTrace("Create")
+    init();
+}
+
+
+MemorySocket::~MemorySocket()
+{
+    // LTrace("Destroy")
+    close();
+}
+
+
+std::pair<MemorySocket::Ptr, MemorySocket::Ptr> MemorySocket::createPair(uv::Loop* loop)
+{
+    auto a = std::make_shared<MemorySocket>(loop);
+    auto b = std::make_shared<MemorySocket>(loop);
+    pair(*a, *b);
+    return std::make_pair(a, b);
+}
+
+
+void MemorySocket::pair(MemorySocket& a, MemorySocket& b)
+{
+    assert(&a != &b);
+    assert(!a.closed() && !b.closed());
+    assert(!a._peer && !b._peer);
+    assert(a.loop() == b.loop());
+
+    a._peer = &b;
+    a._peerAddress = b._address;
+    b._peer = &a;
+    b._peerAddress = a._address;
+}
+
+
+void MemorySocket::init()
+{
+    if (initialized())
+        return;
+
+    // LTrace("Init")
+
+    if (!get())
+        uv::Handle<uv_idle_t>::reset();
+    uv::Handle<uv_idle_t>::init(&uv_idle_init);
+    get()->data = this;
+}
+
+
+void MemorySocket::reset()
+{
+    // LTrace("Reset")
+    uv::Handle<uv_idle_t>::reset();
+    init();
+}
+
+
+void MemorySocket::connect(const net::Address& /* peerAddress */)
+{
+    if (!_peer) {
+        setUVError(UV_ECONNREFUSED, "Memory socket is not paired");
+        return;
+    }
+
+    // Connect asynchronously like TCPSocket, since callers expect to
+    // attach their handlers after calling connect().
+    _connecting = true;
+    schedule();
+}
+
+
+void MemorySocket::connect(const std::string& /* host */, uint16_t /* port */)
+{
+    connect(_peerAddress);
+}
+
+
+bool MemorySocket::shutdown()
+{
+    if (!_peer)
+        return false;
+
+    _peer->_eof = true;
+    _peer->schedule();
+    return true;
+}
+
+
+void MemorySocket::close()
+{
+    // LTrace("Closing")
+    if (_peer) {
+        auto peer = _peer;
+        _peer = nullptr;
+        peer->_peer = nullptr;
+        peer->_eof = true;
+        peer->schedule();
+    }
+    _incoming.clear();
+    _connecting = false;
+    uv::Handle<uv_idle_t>::close();
+}
+
+
+void MemorySocket::bind(const net::Address& address, unsigned /* flags */)
+{
+    _address = address;
+    if (_peer)
+        _peer->_peerAddress = address;
+}
+
+
+ssize_t MemorySocket::send(const char* data, size_t len, int /* flags */)
+{
+    if (!_peer || _peer->_eof) {
+        recordSend(-1, 0, 0);
+        return -1;
+    }
+
+    _peer->_incoming.insert(_peer->_incoming.end(), data, data + len);
+    _peer->schedule();
+    recordSend(len, 1, _peer->_incoming.size());
+    return len;
+}
+
+
+ssize_t MemorySocket::send(const char* data, size_t len, const net::Address& /* peerAddress */, int flags)
+{
+    return send(data, len, flags);
+}
+
+
+ssize_t MemorySocket::sendv(const ConstBuffer* bufs, size_t nbufs, int /* flags */)
+{
+    if (!_peer || _peer->_eof) {
+        recordSend(-1, 0, 0);
+        return -1;
+    }
+
+    size_t len = 0;
+    for (size_t i = 0; i < nbufs; i++) {
+        auto data = bufferCast<const char*>(bufs[i]);
+        _peer->_incoming.insert(_peer->_incoming.end(), data, data + bufs[i].size());
+        len += bufs[i].size();
+    }
+    _peer->schedule();
+    recordSend(len, 1, _peer->_incoming.size());
+    return len;
+}
+
+
+size_t MemorySocket::pending() const
+{
+    return _peer ? _peer->_incoming.size() : 0;
+}
+
+
+bool MemorySocket::paired() const
+{
+    return _peer != nullptr;
+}
+
+
+void MemorySocket::schedule()
+{
+    if (initialized() && !uv_is_active(get<uv_handle_t>()))
+        uv_idle_start(get(), MemorySocket::onIdle);
+}
+
+
+void MemorySocket::deliver()
+{
+    // The socket may be closed or destroyed inside any callback
+    auto ctx = context();
+
+    if (_connecting) {
+        _connecting = false;
+        onSocketConnect(*this);
+        if (ctx->deleted)
+            return;
+    }
+
+    if (!_incoming.empty()) {
+        // Swap buffers so data sent by the peer from inside the callback
+        // is queued for the next iteration.
+        _reading.swap(_incoming);
+        emitRecv(mutableBuffer(_reading), _peerAddress);
+        if (ctx->deleted)
+            return;
+        _reading.clear();
+    }
+
+    if (_eof && _incoming.empty())
+        close();
+}
+
+
+void MemorySocket::onIdle(uv_idle_t* handle)
+{
+    uv_idle_stop(handle);
+    reinterpret_cast<MemorySocket*>(handle->data)->deliver();
+}
+
+
+net::Address MemorySocket::address() const
+{
+    return _address;
+}
+
+
+net::Address MemorySocket::peerAddress() const
+{
+    return _peerAddress;
+}
+
+
+net::TransportType MemorySocket::transport() const
+{
+    return net::TCP;
+}
+
+
+void MemorySocket::setError(const scy::Error& err)
+{
+    uv::Handle<uv_idle_t>::setError(err);
+}
+
+
+const scy::Error& MemorySocket::error() const
+{
+    return uv::Handle<uv_idle_t>::error();
+}
+
+
+bool MemorySocket::closed() const
+{
+    return uv::Handle<uv_idle_t>::closed();
+}
+
+
+void MemorySocket::onError(const scy::Error& error)
+{
+    // LDebug("Error", error.message)
+    onSocketError(*this, error);
+    close(); // close on error
+}
+
+
+void MemorySocket::onClose()
+{
+    // LDebug("On close")
+    onSocketClose(*this);
+}
+
+
+uv::Loop* MemorySocket::loop() const
+{
+    return uv::Handle<uv_idle_t>::loop();
+}
+
+
+void* MemorySocket::self()
+{
+    return this;
+}
+
+
+} // namespace net
+} // namespace scy
+
+
+/// @\}
@@ -62,87 +62,109 @@ void PacketSocketEmitter::onPacket(IPacket& pkt)
 }
 
 
-#if 0
 //
-// Packet Socket
+// Packet Stream Socket Adapter
 //
 
 
-PacketSocket::PacketSocket(const Socket& socket) :
-    Socket(socket)
+PacketStreamSocketAdapter::PacketStreamSocketAdapter(const TCPSocket::Ptr& socket, PacketStream* stream)
+    : PacketProcessor(this->emitter)
+    , _socket(socket)
+    , _stream(stream)
+    , _paused(false)
 {
-    addReceiver(new PacketSocketEmitter);
-    //assert(Socket::base().refCount() >= 2);
+    _socket->Pressure += slot(this, &PacketStreamSocketAdapter::onPressure);
+    _socket->Drain += slot(this, &PacketStreamSocketAdapter::onDrain);
 }
 
 
-PacketSocket::PacketSocket(Socket* base, bool shared) :
-    Socket(base, shared)
+PacketStreamSocketAdapter::~PacketStreamSocketAdapter()
 {
-    addReceiver(new PacketSocketEmitter);
-    //assert(!shared || Socket::base().refCount() >= 2);
+    _socket->Pressure -= slot(this, &PacketStreamSocketAdapter::onPressure);
+    _socket->Drain -= slot(this, &PacketStreamSocketAdapter::onDrain);
 }
 
 
-PacketSocket::~PacketSocket()
+void PacketStreamSocketAdapter::setStream(PacketStream* stream)
 {
+    _stream = stream;
 }
 
 
-//
-// Packet Stream Socket Adapter
-//
-
-
-PacketStreamSocketAdapter::PacketStreamSocketAdapter(Socket& socket) :
-    PacketProcessor(PacketStreamSocketAdapter::emitter),
-    _socket(socket)
+TCPSocket::Ptr PacketStreamSocketAdapter::socket() const
 {
+    return _socket;
 }
 
 
-PacketStreamSocketAdapter::~PacketStreamSocketAdapter()
+bool PacketStreamSocketAdapter::paused() const
 {
+    return _paused;
 }
 
 
 void PacketStreamSocketAdapter::process(IPacket& packet)
 {
     // LTrace("Process: ", packet.className())
+    if (!_socket->closed()) {
+
+        // Send via the cork buffer so the packet data is copied, since
+        // it will not outlive this call if the write is queued.
+        bool corked = _socket->corked();
+        if (!corked)
+            _socket->cork();
+        _socket->sendPacket(packet);
+        if (!corked)
+            _socket->uncork();
+    }
+    emit(packet);
+}
 
-    //Mutex::ScopedLock lock(_mutex);
 
-    // TODO: Split packet if needed
-    _socket.send(packet);
+void PacketStreamSocketAdapter::onPressure(const size_t& size)
+{
+    LTrace("Write pressure: ", size)
+    if (_stream && _stream->active()) {
+        _paused = true;
+        _stream->pause();
+    }
 }
 
 
-bool PacketStreamSocketAdapter::accepts(IPacket* packet)
+void PacketStreamSocketAdapter::onDrain(const size_t& size)
 {
-    return dynamic_cast<RawPacket*>(&packet) != 0;
+    LTrace("Write drained: ", size)
+    if (_stream && _paused) {
+        _paused = false;
+        _stream->resume();
+    }
 }
 
 
-void PacketStreamSocketAdapter::onStreamStateChange(const PacketStreamState& state)
+#if 0
+//
+// Packet Socket
+//
+
+
+PacketSocket::PacketSocket(const Socket& socket) :
+    Socket(socket)
 {
-    // LTrace("Stream state change: ", state)
+    addReceiver(new PacketSocketEmitter);
+    //assert(Socket::base().refCount() >= 2);
+}
 
-    // TODO: Sync socket with stream?
 
-    //Mutex::ScopedLock lock(_mutex);
+PacketSocket::PacketSocket(Socket* base, bool shared) :
+    Socket(base, shared)
+{
+    addReceiver(new PacketSocketEmitter);
+    //assert(!shared || Socket::base().refCount() >= 2);
+}
 
-    switch (state.id()) {
-    case PacketStreamState::Running:
-        break;
 
-    case PacketStreamState::Stopped:
-    case PacketStreamState::Error:
-    case PacketStreamState::Resetting:
-        break;
-    //case PacketStreamState::None:
-    //case PacketStreamState::Stopping:
-    //case PacketStreamState::Closed:
-    }
+PacketSocket::~PacketSocket()
+{
 }
 #endif
 
@@ -55,6 +55,19 @@ ssize_t SocketAdapter::send(const char* data, size_t len, const Address& peerAdd
 }
 
 
+ssize_t SocketAdapter::sendv(const ConstBuffer* bufs, size_t nbufs, int flags)
+{
+    if (nbufs == 1)
+        return send(bufferCast<const char*>(bufs[0]), bufs[0].size(), flags);
+    Buffer data;
+    for (size_t i = 0; i < nbufs; i++) {
+        auto ptr = bufferCast<const char*>(bufs[i]);
+        data.insert(data.end(), ptr, ptr + bufs[i].size());
+    }
+    return send(data.data(), data.size(), flags);
+}
+
+
 ssize_t SocketAdapter::sendPacket(const IPacket& packet, int flags)
 {
     // Try to cast as RawPacket so we can send without copying any data.
@@ -62,6 +75,11 @@ ssize_t SocketAdapter::sendPacket(const IPacket& packet, int flags)
     if (raw)
         return send((const char*)raw->data(), raw->size(), flags);
 
+    // Gathered buffers are written together without being joined
+    auto gather = dynamic_cast<const GatherPacket*>(&packet);
+    if (gather)
+        return sendv(gather->buffers(), gather->count(), flags);
+
     // Dynamically generated packets need to be written to a
     // temp buffer for sending.
     else {
@@ -98,6 +116,13 @@ void SocketAdapter::sendPacket(IPacket& packet)
 }
 
 
+ssize_t SocketAdapter::sendBatch(const char* data, size_t len, const Address& peerAddress, int flags)
+{
+    // Send via this adapter so any outgoing transformation is applied
+    return send(data, len, peerAddress, flags);
+}
+
+
 void SocketAdapter::onSocketConnect(Socket& socket)
 {
     try {
@@ -14,10 +14,25 @@
 #include "scy/net/sslmanager.h"
 #include "scy/net/sslsocket.h"
 #include <algorithm>
+#include <cstring>
 #include <iterator>
 #include <stdexcept>
 #include <vector>
 
+#ifdef SCY_HAS_SSL_KERNEL_TLS
+#include "scy/hex.h"
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+#include <openssl/kdf.h>
+#include <sys/socket.h>
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+
 using namespace std;
 
 
@@ -25,11 +40,17 @@ namespace scy {
 namespace net {
 
 
+/// The maximum plaintext size of a TLS record.
+static const size_t MAX_TLS_RECORD_SIZE = 16384;
+
+
 SSLAdapter::SSLAdapter(net::SSLSocket* socket)
     : _socket(socket)
     , _ssl(nullptr)
     , _readBIO(nullptr)
     , _writeBIO(nullptr)
+    , _txSequence(0)
+    , _kernelTLS(-1)
 {
     // LTrace("Create")
 }
@@ -55,11 +76,18 @@ void SSLAdapter::initClient()
     assert(!_socket->context()->isForServerUse());
 
     _ssl = SSL_new(_socket->context()->sslContext());
-
-    // TODO: Improve automatic SSL session handling.
-    // Maybe add a stored session to the network manager.
-    if (_socket->currentSession())
-        SSL_set_session(_ssl, _socket->currentSession()->sslSession());
+    SSL_set_app_data(_ssl, _socket);
+    initKernelTLS();
+
+    // Offer the session set via useSession(), or the last session
+    // issued by the same peer from the session cache.
+    if (_socket->_sessionKey.empty())
+        _socket->_sessionKey = _socket->peerAddress().toString();
+    SSLSession::Ptr session = _socket->_sslSession;
+    if (!session && _socket->context()->sessionCacheEnabled())
+        session = SSLManager::instance().sessionCache().find(_socket->_sessionKey);
+    if (session)
+        SSL_set_session(_ssl, session->sslSession());
 
     _readBIO = BIO_new(BIO_s_mem());
     _writeBIO = BIO_new(BIO_s_mem());
@@ -78,6 +106,9 @@ void SSLAdapter::initServer() //(SSL* ssl)
     assert(_socket->context()->isForServerUse());
 
     _ssl = SSL_new(_socket->context()->sslContext());
+    SSL_set_app_data(_ssl, _socket);
+    initKernelTLS();
+
     _readBIO = BIO_new(BIO_s_mem());
     _writeBIO = BIO_new(BIO_s_mem());
     SSL_set_bio(_ssl, _readBIO, _writeBIO);
@@ -96,7 +127,12 @@ void SSLAdapter::shutdown()
         int shutdownState = SSL_get_shutdown(_ssl);
         bool shutdownSent =
             (shutdownState & SSL_SENT_SHUTDOWN) == SSL_SENT_SHUTDOWN;
-        if (!shutdownSent) {
+        if (!shutdownSent && _kernelTLS == 1) {
+            // OpenSSL no longer owns the transmit keys
+            sendKernelAlert();
+            SSL_set_shutdown(_ssl, shutdownState | SSL_SENT_SHUTDOWN);
+        }
+        else if (!shutdownSent) {
             // A proper clean shutdown would require us to
             // retry the shutdown if we get a zero return
             // value, until SSL_shutdown() returns 1.
@@ -118,6 +154,12 @@ bool SSLAdapter::initialized() const
 }
 
 
+bool SSLAdapter::kernelTLS() const
+{
+    return _kernelTLS == 1;
+}
+
+
 bool SSLAdapter::ready() const
 {
     return _ssl && SSL_is_init_finished(_ssl);
@@ -148,7 +190,27 @@ void SSLAdapter::addOutgoingData(const std::string& s)
 
 void SSLAdapter::addOutgoingData(const char* data, size_t len)
 {
-    std::copy(data, data + len, std::back_inserter(_bufferOut));
+    _bufferOut.insert(_bufferOut.end(), data, data + len);
+}
+
+
+void SSLAdapter::write(const char* data, size_t len)
+{
+    if (len == 0)
+        return;
+
+    // Queue the data behind any pending payload to preserve ordering
+    if (!ready() || !_bufferOut.empty()) {
+        addOutgoingData(data, len);
+        flush();
+        return;
+    }
+
+    int r = SSL_write(_ssl, data, (int)len);
+    if (r < 0)
+        handleError(r);
+    flushWriteBIO();
+    tryKernelTLS();
 }
 
 
@@ -183,32 +245,373 @@ void SSLAdapter::flush()
 
     // Send any encrypted data from SSL to the remote peer
     flushWriteBIO();
+    tryKernelTLS();
 }
 
 
 void SSLAdapter::flushReadBIO()
 {
-    size_t npending = BIO_ctrl_pending(_readBIO);
-    if (npending > 0) {
-        int nread;
-        char buffer[npending];
-        while ((nread = SSL_read(_ssl, buffer, npending)) > 0) {
-            _socket->onRecv(mutableBuffer(buffer, nread));
-        }
+    // Decrypt a record at a time into a reusable buffer
+    if (_bufferIn.size() < MAX_TLS_RECORD_SIZE)
+        _bufferIn.resize(MAX_TLS_RECORD_SIZE);
+
+    int nread;
+    while (!_socket->closed() &&
+           (nread = SSL_read(_ssl, _bufferIn.data(), (int)_bufferIn.size())) > 0) {
+        _socket->onRecv(mutableBuffer(_bufferIn.data(), nread));
     }
 }
 
 
 void SSLAdapter::flushWriteBIO()
 {
-    size_t npending = BIO_ctrl_pending(_writeBIO);
-    if (npending > 0) {
-        char buffer[npending];
-        int nread = BIO_read(_writeBIO, buffer, npending);
-        if (nread > 0) {
-            _socket->write(buffer, nread);
+    // Drain all encrypted data, handing ownership of each buffer to the
+    // socket so queued writes never reference temporary memory.
+    size_t npending;
+    if (_kernelTLS == 1 && BIO_ctrl_pending(_writeBIO) > 0) {
+        // Records written by OpenSSL after the handshake, such as a TLS 1.3
+        // key update, can't be sent once the kernel owns the transmit keys
+        BIO_reset(_writeBIO);
+        _socket->setError("SSL connection failed: Post-handshake message "
+                          "not supported with kernel TLS");
+        return;
+    }
+    while ((npending = BIO_ctrl_pending(_writeBIO)) > 0) {
+        _bufferWrite.resize(npending);
+        int nread = BIO_read(_writeBIO, _bufferWrite.data(), (int)npending);
+        if (nread <= 0)
+            break;
+        _bufferWrite.resize(nread);
+        _socket->writeOwned(_bufferWrite);
+    }
+}
+
+
+void SSLAdapter::initKernelTLS()
+{
+#ifdef SCY_HAS_SSL_KERNEL_TLS
+    if (!_socket->context()->kernelTLSEnabled())
+        return;
+
+    // Record writes are counted to obtain the sequence number the kernel
+    // continues from, and renegotiation would change the keys.
+    _kernelTLS = 0;
+    _txSequence = 0;
+    _trafficSecret.clear();
+    SSL_set_msg_callback(_ssl, &SSLAdapter::messageCallback);
+    SSL_set_msg_callback_arg(_ssl, this);
+#ifdef SSL_OP_NO_RENEGOTIATION
+    SSL_set_options(_ssl, SSL_OP_NO_RENEGOTIATION);
+#endif
+#endif
+}
+
+
+void SSLAdapter::tryKernelTLS()
+{
+#ifdef SCY_HAS_SSL_KERNEL_TLS
+    if (_kernelTLS != 0 || !ready() || _socket->closed())
+        return;
+
+    // Data encrypted in user space must be written to the socket first,
+    // otherwise it would be encrypted again by the kernel
+    if (!_bufferOut.empty() || BIO_ctrl_pending(_writeBIO) > 0 ||
+        _socket->writeQueueSize() > 0)
+        return;
+
+    _kernelTLS = installKernelTLS() ? 1 : -1;
+    SSL_set_msg_callback(_ssl, nullptr);
+    OPENSSL_cleanse(_trafficSecret.data(), _trafficSecret.size());
+    _trafficSecret.clear();
+    LDebug("Kernel TLS offload: ", _kernelTLS == 1 ? "enabled" : "unsupported")
+#endif
+}
+
+
+#ifdef SCY_HAS_SSL_KERNEL_TLS
+
+namespace {
+
+
+/// Derives TLS 1.3 key material using HKDF-Expand-Label (RFC 8446 7.1).
+bool expandLabel(const EVP_MD* md, const std::vector<unsigned char>& secret,
+                 const std::string& label, unsigned char* out, size_t len)
+{
+    std::string fullLabel("tls13 " + label);
+    std::vector<unsigned char> info;
+    info.push_back(static_cast<unsigned char>(len >> 8));
+    info.push_back(static_cast<unsigned char>(len));
+    info.push_back(static_cast<unsigned char>(fullLabel.size()));
+    info.insert(info.end(), fullLabel.begin(), fullLabel.end());
+    info.push_back(0); // empty context
+
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+    bool ok = ctx && EVP_PKEY_derive_init(ctx) > 0 &&
+              EVP_PKEY_CTX_hkdf_mode(ctx, EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0 &&
+              EVP_PKEY_CTX_set_hkdf_md(ctx, md) > 0 &&
+              EVP_PKEY_CTX_set1_hkdf_key(ctx, secret.data(), (int)secret.size()) > 0 &&
+              EVP_PKEY_CTX_add1_hkdf_info(ctx, info.data(), (int)info.size()) > 0 &&
+              EVP_PKEY_derive(ctx, out, &len) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    return ok;
+}
+
+
+/// Derives the TLS 1.2 key block from the master secret (RFC 5246 6.3).
+bool expandKeyBlock(SSL* ssl, const EVP_MD* md, unsigned char* out, size_t len)
+{
+    unsigned char master[SSL_MAX_MASTER_KEY_LENGTH];
+    unsigned char clientRandom[SSL3_RANDOM_SIZE];
+    unsigned char serverRandom[SSL3_RANDOM_SIZE];
+    size_t masterLen = SSL_SESSION_get_master_key(SSL_get_session(ssl),
+                                                  master, sizeof(master));
+    SSL_get_client_random(ssl, clientRandom, sizeof(clientRandom));
+    SSL_get_server_random(ssl, serverRandom, sizeof(serverRandom));
+
+    static const char label[] = "key expansion";
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr);
+    bool ok = ctx && masterLen > 0 && EVP_PKEY_derive_init(ctx) > 0 &&
+              EVP_PKEY_CTX_set_tls1_prf_md(ctx, md) > 0 &&
+              EVP_PKEY_CTX_set1_tls1_prf_secret(ctx, master, (int)masterLen) > 0 &&
+              EVP_PKEY_CTX_add1_tls1_prf_seed(
+                  ctx, reinterpret_cast<const unsigned char*>(label), sizeof(label) - 1) > 0 &&
+              EVP_PKEY_CTX_add1_tls1_prf_seed(ctx, serverRandom, sizeof(serverRandom)) > 0 &&
+              EVP_PKEY_CTX_add1_tls1_prf_seed(ctx, clientRandom, sizeof(clientRandom)) > 0 &&
+              EVP_PKEY_derive(ctx, out, &len) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    OPENSSL_cleanse(master, sizeof(master));
+    return ok;
+}
+
+
+/// Fills the kernel crypto info for an AEAD cipher. AES-GCM splits the
+/// nonce into a 4 byte salt and 8 byte IV. For TLS 1.2 the IV is the
+/// explicit nonce of the next record. OpenSSL does not hand one over and
+/// any unique value will do, so we choose the record sequence number,
+/// which the kernel then increments along with it.
+template <typename Info>
+size_t fillCryptoInfo(Info& info, uint16_t version, uint16_t cipherType,
+                      const unsigned char* key, const unsigned char* iv,
+                      size_t ivLen, const unsigned char* seq)
+{
+    std::memset(&info, 0, sizeof(info));
+    info.info.version = version;
+    info.info.cipher_type = cipherType;
+    std::memcpy(info.key, key, sizeof(info.key));
+    std::memcpy(info.salt, iv, sizeof(info.salt));
+    if (ivLen > sizeof(info.salt))
+        std::memcpy(info.iv, iv + sizeof(info.salt), sizeof(info.iv));
+    else
+        std::memcpy(info.iv, seq, sizeof(info.iv));
+    std::memcpy(info.rec_seq, seq, sizeof(info.rec_seq));
+    return sizeof(info);
+}
+
+
+} // namespace
+
+#endif
+
+
+bool SSLAdapter::installKernelTLS()
+{
+#ifdef SCY_HAS_SSL_KERNEL_TLS
+    const SSL_CIPHER* cipher = SSL_get_current_cipher(_ssl);
+    int version = SSL_version(_ssl);
+    if (!cipher || (version != TLS1_2_VERSION && version != TLS1_3_VERSION))
+        return false;
+
+#ifndef TLS_1_3_VERSION
+    if (version == TLS1_3_VERSION)
+        return false;
+#endif
+
+    uint16_t cipherType;
+    size_t keyLen;
+    size_t ivLen = version == TLS1_3_VERSION ? 12 : 4;
+    switch (SSL_CIPHER_get_cipher_nid(cipher)) {
+        case NID_aes_128_gcm:
+            cipherType = TLS_CIPHER_AES_GCM_128;
+            keyLen = TLS_CIPHER_AES_GCM_128_KEY_SIZE;
+            break;
+#ifdef TLS_CIPHER_AES_GCM_256
+        case NID_aes_256_gcm:
+            cipherType = TLS_CIPHER_AES_GCM_256;
+            keyLen = TLS_CIPHER_AES_GCM_256_KEY_SIZE;
+            break;
+#endif
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+        case NID_chacha20_poly1305:
+            cipherType = TLS_CIPHER_CHACHA20_POLY1305;
+            keyLen = TLS_CIPHER_CHACHA20_POLY1305_KEY_SIZE;
+            ivLen = TLS_CIPHER_CHACHA20_POLY1305_IV_SIZE;
+            break;
+#endif
+        default:
+            return false;
+    }
+
+    // Derive the key and IV for our direction of the connection
+    const EVP_MD* md = SSL_CIPHER_get_handshake_digest(cipher);
+    unsigned char key[32];
+    unsigned char iv[12];
+    bool ok;
+    if (version == TLS1_3_VERSION) {
+        ok = !_trafficSecret.empty() && md &&
+             expandLabel(md, _trafficSecret, "key", key, keyLen) &&
+             expandLabel(md, _trafficSecret, "iv", iv, ivLen);
+    }
+    else {
+        // client_write_key, server_write_key, client_write_IV, server_write_IV
+        unsigned char block[2 * (32 + 12)];
+        size_t blockLen = 2 * (keyLen + ivLen);
+        ok = md && expandKeyBlock(_ssl, md, block, blockLen);
+        if (ok) {
+            bool server = SSL_is_server(_ssl) != 0;
+            std::memcpy(key, block + (server ? keyLen : 0), keyLen);
+            std::memcpy(iv, block + 2 * keyLen + (server ? ivLen : 0), ivLen);
+        }
+        OPENSSL_cleanse(block, sizeof(block));
+    }
+
+    unsigned char seq[8];
+    for (int i = 0; i < 8; i++)
+        seq[i] = static_cast<unsigned char>(_txSequence >> (56 - i * 8));
+
+    union
+    {
+        tls12_crypto_info_aes_gcm_128 aes128;
+#ifdef TLS_CIPHER_AES_GCM_256
+        tls12_crypto_info_aes_gcm_256 aes256;
+#endif
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+        tls12_crypto_info_chacha20_poly1305 chacha;
+#endif
+    } info;
+    size_t infoLen = 0;
+    if (ok) {
+#ifdef TLS_1_3_VERSION
+        uint16_t kernelVersion = version == TLS1_3_VERSION ? TLS_1_3_VERSION : TLS_1_2_VERSION;
+#else
+        uint16_t kernelVersion = TLS_1_2_VERSION;
+#endif
+        switch (cipherType) {
+            case TLS_CIPHER_AES_GCM_128:
+                infoLen = fillCryptoInfo(info.aes128, kernelVersion, cipherType, key, iv, ivLen, seq);
+                break;
+#ifdef TLS_CIPHER_AES_GCM_256
+            case TLS_CIPHER_AES_GCM_256:
+                infoLen = fillCryptoInfo(info.aes256, kernelVersion, cipherType, key, iv, ivLen, seq);
+                break;
+#endif
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+            case TLS_CIPHER_CHACHA20_POLY1305:
+                // The whole 12 byte IV is used as the nonce
+                std::memset(&info.chacha, 0, sizeof(info.chacha));
+                info.chacha.info.version = kernelVersion;
+                info.chacha.info.cipher_type = cipherType;
+                std::memcpy(info.chacha.key, key, sizeof(info.chacha.key));
+                std::memcpy(info.chacha.iv, iv, sizeof(info.chacha.iv));
+                std::memcpy(info.chacha.rec_seq, seq, sizeof(info.chacha.rec_seq));
+                infoLen = sizeof(info.chacha);
+                break;
+#endif
         }
     }
+    OPENSSL_cleanse(key, sizeof(key));
+    OPENSSL_cleanse(iv, sizeof(iv));
+
+    // The ULP fails with ENOENT when the tls module is not available.
+    // Once attached the socket behaves as before until keys are set.
+    uv_os_fd_t fd = -1;
+    uv_fileno(_socket->get<uv_handle_t>(), &fd);
+    ok = ok && fd != -1 &&
+         setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) == 0 &&
+         setsockopt(fd, SOL_TLS, TLS_TX, &info, (socklen_t)infoLen) == 0;
+    OPENSSL_cleanse(&info, sizeof(info));
+    return ok;
+#else
+    return false;
+#endif
+}
+
+
+void SSLAdapter::sendKernelAlert()
+{
+#ifdef SCY_HAS_SSL_KERNEL_TLS
+    // Skip the alert rather than reorder it ahead of queued data
+    if (_socket->writeQueueSize() > 0)
+        return;
+
+    uv_os_fd_t fd = -1;
+    uv_fileno(_socket->get<uv_handle_t>(), &fd);
+    if (fd == -1)
+        return;
+
+    unsigned char alert[2] = { 1, 0 }; // warning, close_notify
+    char control[CMSG_SPACE(sizeof(unsigned char))];
+    std::memset(control, 0, sizeof(control));
+    iovec iov = { alert, sizeof(alert) };
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_TLS;
+    cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+    *CMSG_DATA(cmsg) = 21; // alert
+    sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+#endif
+}
+
+
+void SSLAdapter::keylogCallback(const SSL* ssl, const char* line)
+{
+#ifdef SCY_HAS_SSL_KERNEL_TLS
+    // Lines have the form "<label> <client random> <secret>" in hex
+    auto socket = reinterpret_cast<SSLSocket*>(SSL_get_app_data(ssl));
+    if (!socket || socket->_sslAdapter._kernelTLS != 0)
+        return;
+
+    const char* label = SSL_is_server(ssl) ? "SERVER_TRAFFIC_SECRET_0 "
+                                           : "CLIENT_TRAFFIC_SECRET_0 ";
+    size_t labelLen = std::strlen(label);
+    if (std::strncmp(line, label, labelLen) != 0)
+        return;
+    const char* secret = std::strchr(line + labelLen, ' ');
+    if (!secret)
+        return;
+    secret++;
+
+    try {
+        auto& trafficSecret = socket->_sslAdapter._trafficSecret;
+        trafficSecret.resize(std::strlen(secret) / 2);
+        hex::decode(secret, trafficSecret.size() * 2, trafficSecret.data());
+    } catch (std::exception&) {
+        socket->_sslAdapter._trafficSecret.clear();
+    }
+#endif
+}
+
+
+void SSLAdapter::messageCallback(int writep, int /* version */, int contentType,
+                                 const void* buf, size_t len, SSL* ssl, void* arg)
+{
+    if (!writep)
+        return;
+
+    // The transmit keys change after our Finished message is written in
+    // TLS 1.3, and with the Finished message in TLS 1.2. Every record
+    // written under the new keys is counted.
+    auto adapter = reinterpret_cast<SSLAdapter*>(arg);
+    if (contentType == SSL3_RT_HEADER)
+        adapter->_txSequence++;
+    else if (contentType == SSL3_RT_HANDSHAKE && len > 0 &&
+             static_cast<const unsigned char*>(buf)[0] == SSL3_MT_FINISHED)
+        adapter->_txSequence = SSL_version(ssl) == TLS1_3_VERSION ? 0 : 1;
 }
 
 
@@ -13,6 +13,7 @@
 #include "scy/crypto/crypto.h"
 #include "scy/datetime.h"
 #include "scy/filesystem.h"
+#include "scy/net/ssladapter.h"
 #include "scy/net/sslmanager.h"
 
 
@@ -32,6 +33,7 @@ SSLContext::SSLContext(Usage usage, const std::string& privateKeyFile,
     , _mode(verificationMode)
     , _sslContext(0)
     , _extendedVerificationErrorDetails(true)
+    , _kernelTLS(false)
 {
     crypto::initializeEngine();
 
@@ -99,7 +101,7 @@ SSLContext::SSLContext(Usage usage, const std::string& privateKeyFile,
     SSL_CTX_set_cipher_list(_sslContext, cipherList.c_str());
     SSL_CTX_set_verify_depth(_sslContext, verificationDepth);
     SSL_CTX_set_mode(_sslContext, SSL_MODE_AUTO_RETRY);
-    SSL_CTX_set_session_cache_mode(_sslContext, SSL_SESS_CACHE_OFF);
+    enableSessionCache(!isForServerUse());
 }
 
 
@@ -110,6 +112,7 @@ SSLContext::SSLContext(Usage usage, const std::string& caLocation,
     , _mode(verificationMode)
     , _sslContext(0)
     , _extendedVerificationErrorDetails(true)
+    , _kernelTLS(false)
 {
     crypto::initializeEngine();
 
@@ -152,7 +155,7 @@ SSLContext::SSLContext(Usage usage, const std::string& caLocation,
     SSL_CTX_set_cipher_list(_sslContext, cipherList.c_str());
     SSL_CTX_set_verify_depth(_sslContext, verificationDepth);
     SSL_CTX_set_mode(_sslContext, SSL_MODE_AUTO_RETRY);
-    SSL_CTX_set_session_cache_mode(_sslContext, SSL_SESS_CACHE_OFF);
+    enableSessionCache(!isForServerUse());
 }
 
 
@@ -216,9 +219,12 @@ void SSLContext::addVerificationCertificate(
 void SSLContext::enableSessionCache(bool flag)
 {
     if (flag) {
+        // Client sessions are kept by the SSLSessionCache rather than
+        // OpenSSL's internal store, which is never consulted by clients.
         SSL_CTX_set_session_cache_mode(
             _sslContext,
-            isForServerUse() ? SSL_SESS_CACHE_SERVER : SSL_SESS_CACHE_CLIENT);
+            isForServerUse() ? SSL_SESS_CACHE_SERVER
+                             : SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
     } else {
         SSL_CTX_set_session_cache_mode(_sslContext, SSL_SESS_CACHE_OFF);
     }
@@ -303,6 +309,23 @@ void SSLContext::disableStatelessSessionResumption()
 }
 
 
+void SSLContext::enableKernelTLS(bool flag)
+{
+    _kernelTLS = flag;
+#ifdef SCY_HAS_SSL_KERNEL_TLS
+    // The TLS 1.3 traffic secrets are only exposed via the key log
+    SSL_CTX_set_keylog_callback(_sslContext,
+                                flag ? &SSLAdapter::keylogCallback : nullptr);
+#endif
+}
+
+
+bool SSLContext::kernelTLSEnabled() const
+{
+    return _kernelTLS;
+}
+
+
 void SSLContext::createSSLContext()
 {
     switch (_usage) {
@@ -329,6 +352,8 @@ void SSLContext::createSSLContext()
     }
 
     SSL_CTX_set_default_passwd_cb(_sslContext, &SSLManager::privateKeyPassphraseCallback);
+    if (!isForServerUse())
+        SSL_CTX_sess_set_new_cb(_sslContext, &SSLManager::newSessionCallback);
     clearErrorStack();
     SSL_CTX_set_options(_sslContext, SSL_OP_ALL);
 }
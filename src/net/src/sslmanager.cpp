@@ -13,6 +13,7 @@
 
 #include "scy/net/sslmanager.h"
 #include "scy/net/sslcontext.h"
+#include "scy/net/sslsocket.h"
 #include "scy/singleton.h"
 
 
@@ -120,6 +121,7 @@ void SSLManager::shutdown()
     ServerVerificationError.detachAll();
     _defaultServerContext = nullptr;
     _defaultClientContext = nullptr;
+    _sessionCache.clear();
 }
 
 
@@ -168,6 +170,12 @@ SSLContext::Ptr SSLManager::defaultClientContext()
 }
 
 
+SSLSessionCache& SSLManager::sessionCache()
+{
+    return _sessionCache;
+}
+
+
 int SSLManager::verifyCallback(bool server, int ok, X509_STORE_CTX* pStore)
 {
     if (!ok) {
@@ -204,6 +212,19 @@ int SSLManager::privateKeyPassphraseCallback(char* pBuf, int size, int flag,
 }
 
 
+int SSLManager::newSessionCallback(SSL* ssl, SSL_SESSION* session)
+{
+    auto socket = reinterpret_cast<SSLSocket*>(SSL_get_app_data(ssl));
+    if (!socket || socket->sessionKey().empty())
+        return 0;
+
+    // Returning 1 passes ownership of the session reference to the cache
+    SSLManager::instance().sessionCache().add(
+        socket->sessionKey(), std::make_shared<SSLSession>(session));
+    return 1;
+}
+
+
 void initializeSSL()
 {
     crypto::initializeEngine();
@@ -37,6 +37,178 @@ SSL_SESSION* SSLSession::sslSession() const
 }
 
 
+//
+// SSL Session Cache
+//
+
+
+SSLSessionCache::SSLSessionCache(size_t maxSize, long maxAge)
+    : _maxSize(maxSize)
+    , _maxAge(maxAge)
+    , _hits(0)
+    , _misses(0)
+{
+}
+
+
+SSLSessionCache::~SSLSessionCache()
+{
+}
+
+
+SSLSession::Ptr SSLSessionCache::find(const std::string& key)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        if (!expired(*it->second, std::time(nullptr))) {
+            _entries.splice(_entries.begin(), _entries, it->second);
+            _hits++;
+            return it->second->session;
+        }
+        _entries.erase(it->second);
+        _index.erase(it);
+    }
+    _misses++;
+    return nullptr;
+}
+
+
+void SSLSessionCache::add(const std::string& key, SSLSession::Ptr session)
+{
+    if (!session || !session->sslSession())
+        return;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    if (!SSL_SESSION_is_resumable(session->sslSession()))
+        return;
+#endif
+
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (_maxSize == 0)
+        return;
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        it->second->session = session;
+        it->second->created = std::time(nullptr);
+        _entries.splice(_entries.begin(), _entries, it->second);
+        return;
+    }
+    _entries.push_front(Entry{key, session, std::time(nullptr)});
+    _index[key] = _entries.begin();
+    evict();
+}
+
+
+void SSLSessionCache::remove(const std::string& key)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        _entries.erase(it->second);
+        _index.erase(it);
+    }
+}
+
+
+void SSLSessionCache::clear()
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _entries.clear();
+    _index.clear();
+}
+
+
+void SSLSessionCache::setMaxSize(size_t size)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _maxSize = size;
+    evict();
+}
+
+
+size_t SSLSessionCache::maxSize() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _maxSize;
+}
+
+
+void SSLSessionCache::setMaxAge(long seconds)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _maxAge = seconds;
+}
+
+
+long SSLSessionCache::maxAge() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _maxAge;
+}
+
+
+size_t SSLSessionCache::size() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _entries.size();
+}
+
+
+uint64_t SSLSessionCache::hits() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _hits;
+}
+
+
+uint64_t SSLSessionCache::misses() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _misses;
+}
+
+
+double SSLSessionCache::hitRate() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    uint64_t lookups = _hits + _misses;
+    return lookups ? static_cast<double>(_hits) / lookups : 0.0;
+}
+
+
+void SSLSessionCache::resetStats()
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _hits = 0;
+    _misses = 0;
+}
+
+
+bool SSLSessionCache::expired(const Entry& entry, std::time_t now) const
+{
+    if (now - entry.created > _maxAge)
+        return true;
+
+    // Honour the lifetime set by the server, ie. the ticket lifetime hint,
+    // and sessions invalidated by a failed connection
+    SSL_SESSION* session = entry.session->sslSession();
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    if (!SSL_SESSION_is_resumable(session))
+        return true;
+#endif
+    return now > SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session);
+}
+
+
+void SSLSessionCache::evict()
+{
+    while (_entries.size() > _maxSize) {
+        _index.erase(_entries.back().key);
+        _entries.pop_back();
+    }
+}
+
+
 } // namespace net
 } // namespace scy
 
@@ -12,6 +12,7 @@
 #include "scy/net/sslsocket.h"
 #include "scy/logger.h"
 #include "scy/net/sslmanager.h"
+#include "scy/util.h"
 
 
 using namespace std;
@@ -63,12 +64,39 @@ int SSLSocket::available() const
 }
 
 
+void SSLSocket::connect(const std::string& host, uint16_t port)
+{
+    _sessionKey = host + ":" + util::itostr(port);
+    TCPSocket::connect(host, port);
+}
+
+
 void SSLSocket::close()
 {
+    // OpenSSL invalidates the session of a connection freed without
+    // sending a close_notify. Connections closed by the application,
+    // or shut down by the peer, are marked as cleanly closed so their
+    // session can be resumed.
+    if (_sslAdapter.ready()) {
+        int state = SSL_get_shutdown(_sslAdapter._ssl);
+        if (!error().any() || (state & SSL_RECEIVED_SHUTDOWN))
+            SSL_set_shutdown(_sslAdapter._ssl, state | SSL_SENT_SHUTDOWN);
+    }
+    _sessionKey.clear();
     TCPSocket::close();
 }
 
 
+bool SSLSocket::flush()
+{
+    // Encrypt the payload coalesced while corked with a single SSL_write,
+    // then submit the resulting records along with any other corked data.
+    if (_sslAdapter.ready() && !_sslAdapter.kernelTLS())
+        _sslAdapter.flush();
+    return TCPSocket::flush();
+}
+
+
 bool SSLSocket::shutdown()
 {
     // LTrace("Shutdown")
@@ -81,9 +109,10 @@ bool SSLSocket::shutdown()
 }
 
 
-ssize_t SSLSocket::send(const char* data, size_t len, int flags)
+ssize_t SSLSocket::send(const char* data, size_t len, const net::Address& /* peerAddress */, int flags)
 {
-    return send(data, len, peerAddress(), flags);
+    // The peer address is implied by the connection
+    return send(data, len, flags);
 }
 
 
@@ -101,7 +130,7 @@ void SSLSocket::listen(int backlog)
 }
 
 
-ssize_t SSLSocket::send(const char* data, size_t len, const net::Address& /* peerAddress */, int /* flags */)
+ssize_t SSLSocket::send(const char* data, size_t len, int flags)
 {
     // LTrace("Send: ", len)
     assert(Thread::currentID() == tid());
@@ -109,19 +138,62 @@ ssize_t SSLSocket::send(const char* data, size_t len, const net::Address& /* pee
 
     if (!active()) {
         LWarn("Send error")
+        recordSend(-1, 0, 0);
         return -1;
     }
 
+    // Encrypted by the kernel once the keys have been offloaded. The
+    // unsent remainder is copied, since callers may pass short lived
+    // buffers as they can when the SSL adapter encrypts them.
+    if (_sslAdapter.kernelTLS()) {
+        auto buf = constBuffer(data, len);
+        return TCPSocket::sendv(&buf, 1, flags);
+    }
+
     // Send unencrypted data to the SSL context
 
     assert(_sslAdapter._ssl);
 
-    _sslAdapter.addOutgoingData(data, len);
-    _sslAdapter.flush();
+    // Writes made while corked are encrypted together on flush
+    if (corked()) {
+        _sslAdapter.addOutgoingData(data, len);
+        scheduleFlush();
+    }
+    else
+        _sslAdapter.write(data, len);
+    recordSend(len, 1, writeQueueSize() + _sslAdapter._bufferOut.size());
     return len;
 }
 
 
+ssize_t SSLSocket::sendv(const ConstBuffer* bufs, size_t nbufs, int flags)
+{
+    if (active() && _sslAdapter.kernelTLS())
+        return TCPSocket::sendv(bufs, nbufs, flags);
+
+    // Coalesce the buffers into a single SSL record
+    return Socket::sendv(bufs, nbufs, flags);
+}
+
+
+ssize_t SSLSocket::sendShared(const std::shared_ptr<const Buffer>& buffer, int flags)
+{
+    if (active() && _sslAdapter.kernelTLS())
+        return TCPSocket::sendShared(buffer, flags);
+
+    return send(buffer->data(), buffer->size(), flags);
+}
+
+
+bool SSLSocket::sendFile(uv_file file, int64_t offset, size_t length, SendFileCallback callback)
+{
+    if (!active() || !_sslAdapter.kernelTLS())
+        return false;
+
+    return TCPSocket::sendFile(file, offset, length, std::move(callback));
+}
+
+
 void SSLSocket::acceptConnection()
 {
     assert(_sslContext->isForServerUse());
@@ -134,6 +206,7 @@ void SSLSocket::acceptConnection()
     // invoke(&uv_tcp_init, loop(), socket->get()); // "Cannot initialize SSL socket"
 
     if (uv_accept(get<uv_stream_t>(), socket->get<uv_stream_t>()) == 0) {
+        socket->cacheAddresses();
         socket->readStart();
         socket->_sslAdapter.initServer();
 
@@ -192,6 +265,18 @@ bool SSLSocket::sessionWasReused()
 }
 
 
+bool SSLSocket::kernelTLS() const
+{
+    return _sslAdapter.kernelTLS();
+}
+
+
+const std::string& SSLSocket::sessionKey() const
+{
+    return _sessionKey;
+}
+
+
 net::TransportType SSLSocket::transport() const
 {
     return net::SSLTCP;
@@ -214,6 +299,7 @@ void SSLSocket::onRead(const char* data, size_t len)
 void SSLSocket::onConnect()
 {
     // LTrace("On connect")
+    cacheAddresses();
     if (readStart()) {
         _sslAdapter.initClient();
         // _sslAdapter.start();
@@ -12,6 +12,12 @@
 #include "scy/net/tcpsocket.h"
 #include "scy/logger.h"
 
+#ifdef SCY_LINUX
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
 
 using std::endl;
 
@@ -50,6 +56,8 @@ void TCPSocket::init()
 
 void TCPSocket::reset()
 {
+    _address = net::Address();
+    _peerAddress = net::Address();
     Stream::reset();
     init();
     get()->data = this;
@@ -122,7 +130,7 @@ void TCPSocket::connect(const std::string& host, uint16_t port)
     else {
         init();
 
-        net::dns::resolve(host, port, [ptr = context()](int err, const net::Address& addr) {
+        net::dns::Resolver::instance(loop()).resolve(host, port, [ptr = context()](int err, const net::Address& addr) {
             if (!ptr->deleted) {
                 auto handle = reinterpret_cast<TCPSocket*>(ptr->handle);
                 if (err)
@@ -130,7 +138,7 @@ void TCPSocket::connect(const std::string& host, uint16_t port)
                 else
                     handle->connect(addr);
             }
-        }, loop());
+        });
     }
 }
 
@@ -180,6 +188,11 @@ bool TCPSocket::shutdown()
 void TCPSocket::close()
 {
     // LTrace("Close")
+
+    // Reset state first since the socket may be destroyed by the
+    // Close signal
+    _address = net::Address();
+    _peerAddress = net::Address();
     Stream::close();
 }
 
@@ -209,6 +222,36 @@ bool TCPSocket::setSimultaneousAccepts(bool enable)
 }
 
 
+bool TCPSocket::tcpInfo(TCPInfo& info) const
+{
+#ifdef SCY_LINUX
+    if (closed())
+        return false;
+
+    uv_os_fd_t fd;
+    if (uv_fileno(get<uv_handle_t>(), &fd) != 0)
+        return false;
+    struct tcp_info ti;
+    socklen_t len = sizeof(ti);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &ti, &len) < 0)
+        return false;
+
+    info.rtt = ti.tcpi_rtt;
+    info.rttVariance = ti.tcpi_rttvar;
+    info.congestionWindow = ti.tcpi_snd_cwnd;
+    info.slowStartThreshold = ti.tcpi_snd_ssthresh;
+    info.mss = ti.tcpi_snd_mss;
+    info.unacked = ti.tcpi_unacked;
+    info.lost = ti.tcpi_lost;
+    info.retransmits = ti.tcpi_total_retrans;
+    return true;
+#else
+    (void)info;
+    return false;
+#endif
+}
+
+
 bool TCPSocket::setReusePort()
 {
     assert(initialized());
@@ -233,13 +276,14 @@ bool TCPSocket::setReusePort()
 }
 
 
-ssize_t TCPSocket::send(const char* data, size_t len, int flags)
+ssize_t TCPSocket::send(const char* data, size_t len, const net::Address& /* peerAddress */, int flags)
 {
-    return send(data, len, peerAddress(), flags);
+    // The peer address is implied by the connection
+    return send(data, len, flags);
 }
 
 
-ssize_t TCPSocket::send(const char* data, size_t len, const net::Address& /* peerAddress */, int /* flags */)
+ssize_t TCPSocket::send(const char* data, size_t len, int /* flags */)
 {
     // LTrace("Send:", len, ":", std::string(data, len))
     assert(Thread::currentID() == tid());
@@ -250,21 +294,206 @@ ssize_t TCPSocket::send(const char* data, size_t len, const net::Address& /* pee
 
     if (!Stream::write(data, len)) {
         LWarn("TCP send error")
+        recordSend(-1, 0, 0);
         return -1;
     }
+    recordSend(len, 1, writeQueueSize());
 
     // TODO: Return native error code
     return len;
 }
 
 
+ssize_t TCPSocket::sendv(const ConstBuffer* bufs, size_t nbufs, int /* flags */)
+{
+    assert(Thread::currentID() == tid());
+    assert(initialized());
+
+    size_t len = 0;
+    for (size_t i = 0; i < nbufs; i++)
+        len += bufs[i].size();
+
+    if (!Stream::writevCopy(bufs, nbufs)) {
+        LWarn("TCP send error")
+        recordSend(-1, 0, 0);
+        return -1;
+    }
+    recordSend(len, 1, writeQueueSize());
+    return len;
+}
+
+
+ssize_t TCPSocket::sendShared(const std::shared_ptr<const Buffer>& buffer, int /* flags */)
+{
+    assert(Thread::currentID() == tid());
+    assert(initialized());
+
+    auto buf = constBuffer(buffer->data(), buffer->size());
+    if (!Stream::writev(&buf, 1, [buffer](int) {})) {
+        LWarn("TCP send error")
+        recordSend(-1, 0, 0);
+        return -1;
+    }
+    recordSend(buffer->size(), 1, writeQueueSize());
+    return buffer->size();
+}
+
+
+/// State of a sendFile() transfer. The socket descriptor is duplicated
+/// so the transfer cannot write to a reused descriptor if the socket is
+/// closed while sendfile() runs on the thread pool.
+struct TCPSocket::SendFileReq
+{
+    uv_fs_t fs;
+    uv_poll_t poll;
+    std::shared_ptr<uv::Context<uv_tcp_t>> ctx;
+    SendFileCallback callback;
+    uv_file file;
+    int fd;
+    int64_t offset;
+    size_t remaining;
+    int64_t sent;
+    int64_t result;
+};
+
+
+bool TCPSocket::sendFile(uv_file file, int64_t offset, size_t length, SendFileCallback callback)
+{
+#ifdef SCY_LINUX
+    assert(Thread::currentID() == tid());
+    if (!active())
+        return false;
+
+    uv_os_fd_t fd;
+    if (uv_fileno(get<uv_handle_t>(), &fd) != 0)
+        return false;
+
+    auto req = new SendFileReq;
+    req->fd = ::dup(fd);
+    if (req->fd < 0 || uv_poll_init(loop(), &req->poll, req->fd) != 0) {
+        if (req->fd >= 0)
+            ::close(req->fd);
+        delete req;
+        return false;
+    }
+    req->fs.data = req;
+    req->poll.data = req;
+    req->ctx = context();
+    req->callback = std::move(callback);
+    req->file = file;
+    req->offset = offset;
+    req->remaining = length;
+    req->sent = 0;
+    req->result = 0;
+
+    // Data queued on the stream must be written before the file, so
+    // start once a zero length write queued behind it has completed.
+    if (writeQueueSize() == 0)
+        sendFileNext(req);
+    else {
+        auto buf = constBuffer("", 0);
+        writev(&buf, 1, [req](int status) {
+            if (status)
+                sendFileFinish(req, status);
+            else
+                sendFileNext(req);
+        });
+    }
+    return true;
+#else
+    (void)file;
+    (void)offset;
+    (void)length;
+    (void)callback;
+    return false;
+#endif
+}
+
+
+void TCPSocket::sendFileNext(SendFileReq* req)
+{
+#ifdef SCY_LINUX
+    if (req->ctx->deleted)
+        return sendFileFinish(req, UV_ECANCELED);
+    if (req->remaining == 0)
+        return sendFileFinish(req, req->sent);
+
+    // Large files are sent in chunks so progress is recorded as it is made
+    const size_t chunk = std::min<size_t>(req->remaining, 1 << 30);
+    int err = uv_fs_sendfile(req->poll.loop, &req->fs, req->fd, req->file,
+        req->offset, chunk, [](uv_fs_t* fs) {
+            auto req = reinterpret_cast<SendFileReq*>(fs->data);
+            auto result = fs->result;
+            uv_fs_req_cleanup(fs);
+            if (req->ctx->deleted)
+                return sendFileFinish(req, UV_ECANCELED);
+
+            // The socket buffer is full, wait until it is writable
+            if (result == UV_EAGAIN) {
+                uv_poll_start(&req->poll, UV_WRITABLE, [](uv_poll_t* poll, int status, int) {
+                    auto req = reinterpret_cast<SendFileReq*>(poll->data);
+                    uv_poll_stop(poll);
+                    if (status < 0)
+                        sendFileFinish(req, status);
+                    else
+                        sendFileNext(req);
+                });
+                return;
+            }
+            if (result < 0)
+                return sendFileFinish(req, result);
+            if (result == 0) // the file was truncated
+                return sendFileFinish(req, UV_EOF);
+
+            req->offset += result;
+            req->remaining -= static_cast<size_t>(result);
+            req->sent += result;
+            reinterpret_cast<TCPSocket*>(req->ctx->handle)->recordSend(result, 1, 0);
+            sendFileNext(req);
+        });
+    if (err)
+        sendFileFinish(req, err);
+#else
+    (void)req;
+#endif
+}
+
+
+void TCPSocket::sendFileFinish(SendFileReq* req, int64_t result)
+{
+#ifdef SCY_LINUX
+    req->result = result;
+    uv_close(reinterpret_cast<uv_handle_t*>(&req->poll), [](uv_handle_t* handle) {
+        auto req = reinterpret_cast<SendFileReq*>(handle->data);
+
+        // libuv leaves a stopped descriptor registered with epoll until
+        // it next reports an event, so remove it before closing.
+        struct epoll_event dummy;
+        epoll_ctl(uv_backend_fd(handle->loop), EPOLL_CTL_DEL, req->fd, &dummy);
+        ::close(req->fd);
+
+        auto callback = std::move(req->callback);
+        int64_t result = req->ctx->deleted ? UV_ECANCELED : req->result;
+        delete req;
+        if (callback)
+            callback(result);
+    });
+#else
+    (void)req;
+    (void)result;
+#endif
+}
+
+
 net::Address TCPSocket::address() const
 {
+    if (_address.port())
+        return _address;
     if (initialized()) {
-        struct sockaddr address;
+        struct sockaddr_storage address;
         int addrlen = sizeof(address);
-        if (uv_tcp_getsockname(get(), &address, &addrlen) == 0)
-            return net::Address(&address, addrlen);
+        if (uv_tcp_getsockname(get(), reinterpret_cast<struct sockaddr*>(&address), &addrlen) == 0)
+            return net::Address(reinterpret_cast<struct sockaddr*>(&address), addrlen);
     }
     return net::Address();
 }
@@ -272,16 +501,27 @@ net::Address TCPSocket::address() const
 
 net::Address TCPSocket::peerAddress() const
 {
+    if (_peerAddress.port())
+        return _peerAddress;
     if (initialized()) {
-        struct sockaddr address;
+        struct sockaddr_storage address;
         int addrlen = sizeof(address);
-        if (uv_tcp_getpeername(get(), &address, &addrlen) == 0)
-            return net::Address(&address, addrlen);
+        if (uv_tcp_getpeername(get(), reinterpret_cast<struct sockaddr*>(&address), &addrlen) == 0)
+            return net::Address(reinterpret_cast<struct sockaddr*>(&address), addrlen);
     }
     return net::Address();
 }
 
 
+void TCPSocket::cacheAddresses()
+{
+    _address = net::Address();
+    _peerAddress = net::Address();
+    _address = address();
+    _peerAddress = peerAddress();
+}
+
+
 void TCPSocket::setError(const scy::Error& err)
 {
     assert(!error().any());
@@ -348,13 +588,14 @@ void TCPSocket::onRead(const char* data, size_t len)
 void TCPSocket::onRecv(const MutableBuffer& buf)
 {
     // LTrace("On recv:", buf.size())
-    onSocketRecv(*this, buf, peerAddress());
+    emitRecv(buf, _peerAddress);
 }
 
 
 void TCPSocket::onConnect()
 {
     // LTrace("On connect")
+    cacheAddresses();
 
     if (readStart()) // will set error on failure
         onSocketConnect(*this);
@@ -371,6 +612,7 @@ void TCPSocket::acceptConnection()
     // invoke(&uv_tcp_init, loop(), socket->get()); // "Cannot initialize TCP socket"
 
     if (uv_accept(get<uv_stream_t>(), socket->get<uv_stream_t>()) == 0) {
+        socket->cacheAddresses();
         socket->readStart();
         AcceptConnection.emit(socket);
     }
@@ -13,6 +13,20 @@
 #include "scy/logger.h"
 #include "scy/net/net.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef SCY_HAS_KERNEL_UDP_GSO
+#include <netinet/udp.h>
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
+
 
 using namespace std;
 
@@ -21,6 +35,93 @@ namespace scy {
 namespace net {
 
 
+/// Buffers for receiving datagrams in batches via recvmmsg().
+struct UDPSocket::RecvBatch
+{
+#if SCY_HAS_KERNEL_MMSG
+    /// Control message space for the GRO segment size.
+    struct Control
+    {
+        char data[CMSG_SPACE(sizeof(int))];
+    };
+#endif
+
+    size_t slotSize;
+    Buffer buffer;
+#if SCY_HAS_KERNEL_MMSG
+    std::vector<struct mmsghdr> msgs;
+    std::vector<struct iovec> iovs;
+    std::vector<struct sockaddr_storage> addrs;
+    std::vector<Control> controls;
+#endif
+
+    RecvBatch(size_t count, size_t slotSize)
+        : slotSize(slotSize)
+        , buffer(count * slotSize)
+#if SCY_HAS_KERNEL_MMSG
+        , msgs(count)
+        , iovs(count)
+        , addrs(count)
+        , controls(count)
+#endif
+    {
+#if SCY_HAS_KERNEL_MMSG
+        for (size_t i = 0; i < count; i++) {
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            iovs[i].iov_base = buffer.data() + i * slotSize;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+#endif
+    }
+};
+
+
+namespace {
+
+
+/// The maximum number of segments the kernel accepts per GSO send.
+const size_t MAX_GSO_SEGMENTS = 64;
+
+/// The maximum UDP payload size.
+const size_t MAX_UDP_PAYLOAD_SIZE = 65507;
+
+
+/// Batched datagrams handed over to libuv.
+/// The request owns the datagram data until every send has completed.
+struct BatchSendReq
+{
+    Buffer buffer;
+    std::vector<uv_udp_send_t> reqs;
+    size_t pending{0};
+};
+
+
+#if SCY_HAS_KERNEL_MMSG
+
+/// Returns the GRO segment size from the given received message, or zero
+/// if the datagram was not coalesced.
+size_t groSegmentSize(struct msghdr* msg)
+{
+#ifdef SCY_HAS_KERNEL_UDP_GSO
+    for (auto cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int size;
+            memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+            return size > 0 ? size : 0;
+        }
+    }
+#endif
+    return 0;
+}
+
+#endif
+
+
+} // namespace
+
+
 UDPSocket::UDPSocket(uv::Loop* loop)
     : uv::Handle<uv_udp_t>(loop)
     , _buffer(65536)
@@ -86,7 +187,7 @@ void UDPSocket::connect(const std::string& host, uint16_t port)
     else {
         init();
 
-        net::dns::resolve(host, port, [ptr = context()](int err, const net::Address& addr) {
+        net::dns::Resolver::instance(loop()).resolve(host, port, [ptr = context()](int err, const net::Address& addr) {
             if (!ptr->deleted) {
                 auto handle = reinterpret_cast<UDPSocket*>(ptr->handle);
                 if (err)
@@ -94,7 +195,7 @@ void UDPSocket::connect(const std::string& host, uint16_t port)
                 else
                     handle->connect(addr);
             }
-        }, loop());
+        });
     }
 }
 
@@ -102,8 +203,13 @@ void UDPSocket::connect(const std::string& host, uint16_t port)
 void UDPSocket::close()
 {
     // LTrace("Closing")
-    if (initialized() && !closed())
+    if (initialized() && !closed()) {
+        flushBatch();
         recvStop();
+    }
+    _flusher.reset();
+    _batch.clear();
+    _batchBuffer.clear();
     uv::Handle<uv_udp_t>::close();
 }
 
@@ -136,13 +242,8 @@ ssize_t UDPSocket::send(const char* data, size_t len, const Address& peerAddress
     assert(!closed());
     // assert(len <= net::MAX_UDP_PACKET_SIZE);
 
-    if (_peer.valid() && _peer != peerAddress) {
-        LError("Peer not authorized:", peerAddress)
-        return -1;
-    }
-
-    if (!peerAddress.valid()) {
-        LError("Peer not valid:", peerAddress)
+    if (!validatePeer(peerAddress)) {
+        recordSend(-1, 0, 0);
         return -1;
     }
 
@@ -151,8 +252,10 @@ ssize_t UDPSocket::send(const char* data, size_t len, const Address& peerAddress
         [](uv_udp_send_t* req, int) {
             delete req;
         })) {
+        recordSend(len, 1, get()->send_queue_size);
         return len;
     }
+    recordSend(-1, 0, 0);
     return error().err;
 
     // typedef uv::Request<uv_udp_t, uv_udp_send_t> Request;
@@ -180,6 +283,260 @@ ssize_t UDPSocket::send(const char* data, size_t len, const Address& peerAddress
 }
 
 
+ssize_t UDPSocket::sendBatch(const char* data, size_t len, const Address& peerAddress, int /* flags */)
+{
+    // LTrace("Send batch:", len, ":", peerAddress)
+    assert(Thread::currentID() == tid());
+    assert(initialized());
+    assert(!closed());
+
+    if (!validatePeer(peerAddress)) {
+        recordSend(-1, 0, 0);
+        return -1;
+    }
+
+    if (!_flusher) {
+        _flusher.reset(new uv::Handle<uv_prepare_t>(loop()));
+        _flusher->init(&uv_prepare_init);
+        _flusher->get()->data = this;
+        _flusher->unref();
+    }
+
+    _batch.push_back({ _batchBuffer.size(), len, peerAddress });
+    _batchBuffer.insert(_batchBuffer.end(), data, data + len);
+    if (!_flusher->active())
+        uv_prepare_start(_flusher->get(), handleFlush);
+    recordSend(len, 1, get()->send_queue_size + _batchBuffer.size());
+    return len;
+}
+
+
+void UDPSocket::flushBatch()
+{
+    if (_flusher && _flusher->active())
+        uv_prepare_stop(_flusher->get());
+    if (_batch.empty())
+        return;
+
+    size_t sent = 0;
+#if SCY_HAS_KERNEL_MMSG
+    // Datagrams may only bypass libuv while its send queue is empty,
+    // otherwise they would overtake earlier sends.
+    uv_os_fd_t fd;
+    if (get()->send_queue_count == 0 && uv_fileno(get<uv_handle_t>(), &fd) == 0) {
+        static const size_t MAX_MMSG = 64;
+        struct mmsghdr msgs[MAX_MMSG];
+        struct iovec iovs[MAX_MMSG];
+        while (sent < _batch.size()) {
+            size_t count = std::min(_batch.size() - sent, MAX_MMSG);
+            for (size_t i = 0; i < count; i++) {
+                auto& dgram = _batch[sent + i];
+                iovs[i].iov_base = _batchBuffer.data() + dgram.offset;
+                iovs[i].iov_len = dgram.length;
+                memset(&msgs[i], 0, sizeof(msgs[i]));
+                msgs[i].msg_hdr.msg_name = const_cast<struct sockaddr*>(dgram.peer.addr());
+                msgs[i].msg_hdr.msg_namelen = dgram.peer.length();
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int r;
+            do {
+                r = sendmmsg(fd, msgs, (unsigned)count, 0);
+            } while (r < 0 && errno == EINTR);
+
+            // Leave the rest to libuv if the socket buffer is full, or to
+            // report the error on the failed datagram.
+            if (r <= 0)
+                break;
+            sent += r;
+        }
+    }
+#endif
+
+    if (sent == _batch.size()) {
+        _batch.clear();
+        _batchBuffer.clear();
+        return;
+    }
+
+    // Send the remaining datagrams via libuv, which queues them until
+    // the socket is writable.
+    auto req = new BatchSendReq;
+    std::vector<Datagram> batch;
+    batch.swap(_batch);
+    req->buffer.swap(_batchBuffer);
+    req->reqs.resize(batch.size() - sent);
+    int err = 0;
+    for (size_t i = 0; i < req->reqs.size(); i++) {
+        auto& dgram = batch[sent + i];
+        auto buf = uv_buf_init(req->buffer.data() + dgram.offset, (unsigned int)dgram.length);
+        req->reqs[i].data = req;
+        err = uv_udp_send(&req->reqs[i], get(), &buf, 1, dgram.peer.addr(),
+            [](uv_udp_send_t* r, int) {
+                auto req = static_cast<BatchSendReq*>(r->data);
+                if (--req->pending == 0)
+                    delete req;
+            });
+        if (err)
+            break;
+        req->pending++;
+    }
+    if (req->pending == 0)
+        delete req;
+    if (err)
+        setUVError(err, "UDP send error");
+}
+
+
+ssize_t UDPSocket::sendSegmented(const char* data, size_t len, size_t segmentSize,
+                                 const Address& peerAddress, int flags)
+{
+    // LTrace("Send segmented:", len, ":", segmentSize, ":", peerAddress)
+    assert(Thread::currentID() == tid());
+    assert(initialized());
+    assert(!closed());
+    assert(segmentSize > 0);
+
+    if (!validatePeer(peerAddress)) {
+        recordSend(-1, 0, 0);
+        return -1;
+    }
+
+    if (segmentSize == 0 || segmentSize > MAX_UDP_PAYLOAD_SIZE) {
+        LError("Invalid segment size:", segmentSize)
+        recordSend(-1, 0, 0);
+        return -1;
+    }
+
+    // Datagrams which do not need splitting are sent as usual
+    if (len <= segmentSize)
+        return send(data, len, peerAddress, flags);
+
+    size_t sent = 0;
+#ifdef SCY_HAS_KERNEL_UDP_GSO
+    uv_os_fd_t fd = -1;
+    uv_fileno(get<uv_handle_t>(), &fd);
+
+    // Check once whether the running kernel supports UDP_SEGMENT, since
+    // older kernels silently ignore the control message.
+    if (_gso < 0 && fd >= 0) {
+        int value;
+        socklen_t size = sizeof(value);
+        _gso = getsockopt(fd, SOL_UDP, UDP_SEGMENT, &value, &size) == 0;
+        if (!_gso)
+            LDebug("UDP GSO not supported")
+    }
+
+    // Earlier datagrams must be sent first to preserve ordering
+    flushBatch();
+    if (_gso > 0 && fd >= 0 && get()->send_queue_count == 0) {
+        const size_t chunkSize = segmentSize *
+            std::min(MAX_GSO_SEGMENTS, MAX_UDP_PAYLOAD_SIZE / segmentSize);
+        char control[CMSG_SPACE(sizeof(uint16_t))];
+        while (sent < len) {
+            size_t count = std::min(len - sent, chunkSize);
+            struct iovec iov;
+            iov.iov_base = const_cast<char*>(data + sent);
+            iov.iov_len = count;
+
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_name = const_cast<struct sockaddr*>(peerAddress.addr());
+            msg.msg_namelen = peerAddress.length();
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            if (count > segmentSize) {
+                memset(control, 0, sizeof(control));
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof(control);
+                auto cmsg = CMSG_FIRSTHDR(&msg);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t size = static_cast<uint16_t>(segmentSize);
+                memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+            }
+
+            ssize_t r;
+            do {
+                r = sendmsg(fd, &msg, 0);
+            } while (r < 0 && errno == EINTR);
+
+            // Send the rest individually if the socket buffer is full or
+            // the device cannot segment, ie. the segment size exceeds the
+            // path MTU.
+            if (r < 0) {
+                if (errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+                    _gso = 0;
+                break;
+            }
+            sent += count;
+        }
+    }
+#endif
+
+    // Datagrams sent as a batch are recorded by sendBatch()
+    if (sent > 0)
+        recordSend(sent, (sent + segmentSize - 1) / segmentSize, get()->send_queue_size);
+
+    // Fall back to sending the datagrams as a batch
+    if (sent < len) {
+        for (size_t offset = sent; offset < len; offset += segmentSize)
+            sendBatch(data + offset, std::min(segmentSize, len - offset), peerAddress, flags);
+        flushBatch();
+    }
+    return len;
+}
+
+
+bool UDPSocket::setGRO(bool enable)
+{
+    assert(initialized());
+#ifdef SCY_HAS_KERNEL_UDP_GSO
+    uv_os_fd_t fd;
+    int value = enable ? 1 : 0;
+    if (uv_fileno(get<uv_handle_t>(), &fd) != 0 ||
+        setsockopt(fd, SOL_UDP, UDP_GRO, &value, sizeof(value)) != 0) {
+        LDebug("UDP GRO not supported")
+        return false;
+    }
+
+    _gro = enable;
+    _groSegmentSize = 0;
+
+    // Batch slots must be large enough for coalesced datagrams
+    if (_recvBatch)
+        setRecvBatchSize(_recvBatchSize, _recvBatch->slotSize);
+    return true;
+#else
+    return !enable;
+#endif
+}
+
+
+bool UDPSocket::gro() const
+{
+    return _gro;
+}
+
+
+void UDPSocket::setRecvBatchSize(size_t size, size_t slotSize)
+{
+    assert(size > 0);
+    if (_gro)
+        slotSize = std::max<size_t>(slotSize, 65536);
+    _recvBatchSize = size;
+    _recvBatch.reset(size > 1 ? new RecvBatch(size - 1, slotSize) : nullptr);
+}
+
+
+size_t UDPSocket::recvBatchSize() const
+{
+    return _recvBatchSize;
+}
+
+
 bool UDPSocket::setBroadcast(bool enable)
 {
     assert(initialized());
@@ -237,10 +594,99 @@ bool UDPSocket::recvStop()
 }
 
 
+void UDPSocket::recvBatch()
+{
+#if SCY_HAS_KERNEL_MMSG
+    uv_os_fd_t fd;
+    if (!_recvBatch || uv_fileno(get<uv_handle_t>(), &fd) != 0)
+        return;
+
+    auto& batch = *_recvBatch;
+    for (size_t i = 0; i < batch.msgs.size(); i++) {
+        auto& hdr = batch.msgs[i].msg_hdr;
+        batch.iovs[i].iov_len = batch.slotSize;
+        hdr.msg_namelen = sizeof(batch.addrs[i]);
+        hdr.msg_control = _gro ? batch.controls[i].data : nullptr;
+        hdr.msg_controllen = _gro ? sizeof(batch.controls[i].data) : 0;
+        hdr.msg_flags = 0;
+    }
+
+    int r;
+    do {
+        r = recvmmsg(fd, batch.msgs.data(), (unsigned)batch.msgs.size(), MSG_DONTWAIT, nullptr);
+    } while (r < 0 && errno == EINTR);
+
+    // Errors are left for libuv to report on its next read
+    if (r <= 0)
+        return;
+
+    auto ctx = context();
+    for (int i = 0; i < r && !ctx->deleted; i++) {
+        auto& hdr = batch.msgs[i].msg_hdr;
+        if (hdr.msg_flags & MSG_TRUNC) {
+            LWarn("Discarding oversize datagram:", batch.msgs[i].msg_len)
+            continue;
+        }
+        recvSegments(static_cast<char*>(batch.iovs[i].iov_base), batch.msgs[i].msg_len,
+                     _gro ? groSegmentSize(&hdr) : 0,
+                     net::Address(reinterpret_cast<struct sockaddr*>(&batch.addrs[i]),
+                                  hdr.msg_namelen));
+    }
+#endif
+}
+
+
+void UDPSocket::recvSegments(char* data, size_t len, size_t segmentSize, const net::Address& address)
+{
+    if (!segmentSize || len <= segmentSize) {
+        onRecv(mutableBuffer(data, len), address);
+        return;
+    }
+
+    auto ctx = context();
+    for (size_t offset = 0; offset < len && !ctx->deleted; offset += segmentSize)
+        onRecv(mutableBuffer(data + offset, std::min(segmentSize, len - offset)), address);
+}
+
+
+void UDPSocket::peekSegmentSize()
+{
+    _groSegmentSize = 0;
+#if SCY_HAS_KERNEL_MMSG
+    uv_os_fd_t fd;
+    if (uv_fileno(get<uv_handle_t>(), &fd) != 0)
+        return;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(fd, &msg, MSG_PEEK | MSG_DONTWAIT) >= 0)
+        _groSegmentSize = groSegmentSize(&msg);
+#endif
+}
+
+
+bool UDPSocket::validatePeer(const Address& peerAddress) const
+{
+    if (_peer.valid() && _peer != peerAddress) {
+        LError("Peer not authorized:", peerAddress)
+        return false;
+    }
+
+    if (!peerAddress.valid()) {
+        LError("Peer not valid:", peerAddress)
+        return false;
+    }
+    return true;
+}
+
+
 void UDPSocket::onRecv(const MutableBuffer& buf, const net::Address& address)
 {
     // LTrace("On recv:", buf.size(), ":", address)
-    onSocketRecv(*this, buf, address);
+    emitRecv(buf, address);
 }
 
 
@@ -259,10 +705,10 @@ const scy::Error& UDPSocket::error() const
 net::Address UDPSocket::address() const
 {
     if (initialized()) {
-        struct sockaddr address;
+        struct sockaddr_storage address;
         int addrlen = sizeof(address);
-        if (uv_udp_getsockname(get(), &address, &addrlen) == 0)
-            return net::Address(&address, addrlen);
+        if (uv_udp_getsockname(get(), reinterpret_cast<struct sockaddr*>(&address), &addrlen) == 0)
+            return net::Address(reinterpret_cast<struct sockaddr*>(&address), addrlen);
     }
     return net::Address();
 }
@@ -311,14 +757,28 @@ void UDPSocket::onRecv(uv_udp_t* handle, ssize_t nread, const uv_buf_t* buf,
         return;
     }
 
-    socket->onRecv(mutableBuffer(buf->base, nread),
-                   net::Address(addr, sizeof(*addr)));
+    net::Address address(addr, addr->sa_family == AF_INET6
+                                   ? sizeof(struct sockaddr_in6)
+                                   : sizeof(struct sockaddr_in));
+    if (socket->_recvBatchSize > 1 || socket->_groSegmentSize) {
+        auto ctx = socket->context();
+        socket->recvSegments(buf->base, nread, socket->_groSegmentSize, address);
+
+        // Receive any further waiting datagrams in a single batch
+        if (!ctx->deleted && socket->_recvBatchSize > 1)
+            socket->recvBatch();
+    }
+    else
+        socket->onRecv(mutableBuffer(buf->base, nread), address);
 }
 
 
 void UDPSocket::allocRecvBuffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf)
 {
-    auto& buffer = static_cast<UDPSocket*>(handle->data)->_buffer;
+    auto socket = static_cast<UDPSocket*>(handle->data);
+    auto& buffer = socket->_buffer;
+    if (socket->_gro)
+        socket->peekSegmentSize();
     // // LTrace("Allocating buffer:", suggested_size)
 
     // Reserve the recommended buffer size
@@ -352,6 +812,13 @@ void UDPSocket::onClose()
 }
 
 
+void UDPSocket::handleFlush(uv_prepare_t* handle)
+{
+    uv_prepare_stop(handle);
+    reinterpret_cast<UDPSocket*>(handle->data)->flushBatch();
+}
+
+
 uv::Loop* UDPSocket::loop() const
 {
     return uv::Handle<uv_udp_t>::loop();
@@ -1,6 +1,8 @@
  #include "scy/base.h"
 #include "scy/logger.h"
 #include "scy/net/address.h"
+#include "scy/net/memorysocket.h"
+#include "scy/net/packetsocket.h"
 #include "scy/net/sslcontext.h"
 #include "scy/net/sslmanager.h"
 #include "scy/net/sslsocket.h"
@@ -14,6 +16,9 @@
 #include "../samples/echoserver/udpechoserver.h"
 #include "clientsockettest.h"
 
+#include <fstream>
+#include <unordered_set>
+
 
 using std::endl;
 using namespace scy;
@@ -82,6 +87,37 @@ int main(int argc, char** argv)
             expect(0 && "invalid address - must throw");
         } catch (std::exception&) {
         }
+
+        // Binary comparisons and hashing
+        expect(sa1 == sa2);
+        expect(sa1 != sa3);
+        expect(sa3 < sa1);
+        expect(!(sa1 < sa2) && !(sa2 < sa1));
+        expect(net::Address("10.0.0.1", 100) < net::Address("192.168.1.100", 21));
+        expect(std::hash<net::Address>()(sa1) == std::hash<net::Address>()(sa2));
+        expect(std::hash<net::Address>()(sa1) != std::hash<net::Address>()(sa3));
+
+        net::Address sa10("[::1]:8080");
+        expect(sa10.family() == net::Address::IPv6);
+        expect(sa10.host() == "::1");
+        expect(sa10.port() == 8080);
+        expect(sa10.length() == sizeof(struct sockaddr_in6));
+        expect(sa10.toString() == "[::1]:8080");
+        expect(sa10 != net::Address("127.0.0.1", 8080));
+        expect(net::Address("127.0.0.1", 8080) < sa10);
+
+        net::Address sa11(sa10.addr(), sa10.length());
+        expect(sa11 == sa10);
+        sa11.swap(sa1);
+        expect(sa11 == sa2 && sa1 == sa10);
+
+        expect(!net::Address().valid());
+        expect(!net::Address("0.0.0.0", 80).valid());
+        expect(net::Address("127.0.0.1", 80).valid());
+
+        std::unordered_set<net::Address> peers{ sa2, sa3, sa10 };
+        expect(peers.size() == 3);
+        expect(peers.count(net::Address("192.168.1.100", 100)) == 1);
     });
 
 
@@ -101,6 +137,362 @@ int main(int argc, char** argv)
     });
 
 
+    // =========================================================================
+    // TCP Socket Gather Write Test
+    //
+    describe("tcp socket gather write test", []() {
+        net::TCPEchoServer srv;
+        srv.start("127.0.0.1", 1340);
+        srv.server->unref();
+
+        int callbacks = 0;
+        std::string received;
+        const std::string expected = "header|payload|trailer|corked|gather";
+
+        // Buffers written without copying must outlive the write
+        const std::string header("header|"), payload("payload|"), trailer("trailer|");
+        auto socket = std::make_shared<net::TCPSocket>();
+        net::SocketEmitter emitter(socket);
+        emitter.Connect += [&](net::Socket&) {
+            // Gather write straight from the caller's buffers
+            expect(socket->writev({ constBuffer(header), constBuffer(payload),
+                                    constBuffer(trailer) },
+                                  [&](int status) {
+                                      expect(status == 0);
+                                      callbacks++;
+                                  }));
+
+            // Corked writes are coalesced until the loop polls for I/O
+            socket->cork();
+            expect(socket->corked());
+            socket->send("corked|", 7);
+            expect(socket->writev({ constBuffer("gat", 3), constBuffer("her", 3) },
+                                  [&](int status) {
+                                      expect(status == 0);
+                                      callbacks++;
+                                  }));
+            expect(callbacks == 0);
+        };
+        emitter.Recv += [&](net::Socket& sock, const MutableBuffer& buffer, const net::Address&) {
+            received.append(bufferCast<const char*>(buffer), buffer.size());
+            if (received.size() >= expected.size())
+                sock.close();
+        };
+
+        socket->connect("127.0.0.1", 1340);
+        uv::runLoop();
+
+        expect(received == expected);
+        expect(callbacks == 2);
+        expect(!socket->corked());
+    });
+
+
+    // =========================================================================
+    // TCP Socket Address Test
+    //
+    describe("tcp socket address test", []() {
+        const net::Address serverAddress("127.0.0.1", 1342);
+        auto server = std::make_shared<net::TCPSocket>();
+        auto client = std::make_shared<net::TCPSocket>();
+        net::TCPSocket::Ptr accepted;
+        server->bind(serverAddress);
+        server->listen();
+        server->AcceptConnection += [&](const net::TCPSocket::Ptr& socket) {
+            accepted = socket;
+            expect(socket->address() == serverAddress);
+            expect(socket->peerAddress().valid());
+            socket->send("ping", 4);
+        };
+
+        bool received = false;
+        net::SocketEmitter emitter(client);
+        emitter.Connect += [&](net::Socket& socket) {
+            expect(socket.peerAddress() == serverAddress);
+            expect(socket.address().valid());
+        };
+        emitter.Recv += [&](net::Socket& socket, const MutableBuffer&, const net::Address& peerAddress) {
+            expect(peerAddress == serverAddress);
+            expect(accepted->peerAddress() == socket.address());
+            received = true;
+            socket.close();
+            accepted->close();
+            server->close();
+        };
+
+        client->connect(serverAddress);
+        uv::runLoop();
+
+        expect(received);
+        expect(!client->peerAddress().valid());
+    });
+    // =========================================================================
+    // TCP Socket Backpressure Test
+    //
+    describe("tcp socket backpressure test", []() {
+        net::TCPEchoServer srv;
+        srv.start("127.0.0.1", 1341);
+        srv.server->unref();
+
+        // Large enough to overflow the kernel socket buffers
+        const std::string payload(16 * 1024 * 1024, 'x');
+        size_t received = 0;
+        int pressure = 0, drain = 0;
+        bool pausedOnPressure = false;
+
+        PacketStream stream;
+        auto socket = std::make_shared<net::TCPSocket>();
+        auto adapter = new net::PacketStreamSocketAdapter(socket, &stream);
+        stream.attach(adapter, 0, true);
+        stream.start();
+
+        socket->setWriteWatermarks(64 * 1024, 16 * 1024);
+        socket->Pressure += [&](const size_t& size) {
+            expect(size > socket->highWaterMark());
+            pressure++;
+        };
+        socket->Drain += [&](const size_t& size) {
+            expect(size <= socket->lowWaterMark());
+            expect(stream.stateEquals(PacketStreamState::Active));
+            drain++;
+        };
+
+        net::SocketEmitter emitter(socket);
+        emitter.Connect += [&](net::Socket&) {
+            stream.write(payload.c_str(), payload.size());
+            expect(socket->pressured());
+            pausedOnPressure = adapter->paused() &&
+                stream.stateEquals(PacketStreamState::Paused);
+        };
+        emitter.Recv += [&](net::Socket& sock, const MutableBuffer& buffer, const net::Address&) {
+            received += buffer.size();
+            if (received >= payload.size())
+                sock.close();
+        };
+
+        socket->connect("127.0.0.1", 1341);
+        uv::runLoop();
+
+        expect(received == payload.size());
+        expect(pressure == 1);
+        expect(drain == 1);
+        expect(pausedOnPressure);
+        expect(!adapter->paused());
+        expect(!socket->pressured());
+        stream.close();
+    });
+
+
+    // =========================================================================
+    // TCP Socket Stats Test
+    //
+    describe("tcp socket stats test", []() {
+        net::TCPEchoServer srv;
+        srv.start("127.0.0.1", 1348);
+        srv.server->unref();
+
+        bool gotInfo = false;
+        net::TCPInfo info;
+        std::string received;
+        auto socket = std::make_shared<net::TCPSocket>();
+        expect(!socket->statsEnabled());
+        socket->enableStats();
+        net::SocketEmitter emitter(socket);
+        emitter.Connect += [&](net::Socket& sock) {
+            sock.send("ping", 4);
+            sock.send("pong", 4);
+        };
+        emitter.Recv += [&](net::Socket&, const MutableBuffer& buffer, const net::Address&) {
+            received.append(bufferCast<const char*>(buffer), buffer.size());
+            if (received.size() >= 8) {
+                gotInfo = socket->tcpInfo(info);
+                socket->close();
+            }
+        };
+
+        socket->connect("127.0.0.1", 1348);
+        uv::runLoop();
+
+        net::SocketStats stats = socket->stats();
+        expect(received == "pingpong");
+        expect(stats.bytesOut == 8);
+        expect(stats.packetsOut == 2);
+        expect(stats.bytesIn == 8);
+        expect(stats.packetsIn >= 1);
+        expect(stats.sendErrors == 0);
+        expect(stats.callbackTime > 0);
+#ifdef SCY_LINUX
+        expect(gotInfo);
+        expect(info.mss > 0);
+        expect(info.congestionWindow > 0);
+#endif
+
+        net::SocketStats total;
+        total += stats;
+        total += stats;
+        expect(total.bytesOut == 16);
+        expect(total.writeQueueHighWater == stats.writeQueueHighWater);
+
+        socket->resetStats();
+        expect(socket->stats().bytesIn == 0);
+        expect(!socket->tcpInfo(info));
+    });
+
+
+    // =========================================================================
+    // Memory Socket Test
+    //
+    describe("memory socket test", []() {
+        auto pair = net::MemorySocket::createPair();
+        auto client = pair.first;
+        auto server = pair.second;
+        client->bind(net::Address("127.0.0.1", 1));
+        server->bind(net::Address("127.0.0.1", 2));
+        expect(client->paired());
+        expect(client->peerAddress() == server->address());
+        expect(server->peerAddress() == client->address());
+
+        int connects = 0, closes = 0;
+        std::string received;
+        net::SocketEmitter serverEmitter(server);
+        serverEmitter.Recv += [&](net::Socket& sock, const MutableBuffer& buffer, const net::Address& peerAddress) {
+            expect(peerAddress == client->address());
+            sock.send(bufferCast<const char*>(buffer), buffer.size());
+        };
+        serverEmitter.Close += [&](net::Socket&) { closes++; };
+
+        net::SocketEmitter clientEmitter(client);
+        clientEmitter.Connect += [&](net::Socket& sock) {
+            connects++;
+            sock.send("hello ", 6);
+            sock.send("world", 5);
+            expect(client->pending() == 11);
+        };
+        clientEmitter.Recv += [&](net::Socket&, const MutableBuffer& buffer, const net::Address&) {
+            received.append(bufferCast<const char*>(buffer), buffer.size());
+            if (received.size() == 11)
+                expect(client->shutdown());
+        };
+        clientEmitter.Close += [&](net::Socket&) { closes++; };
+
+        client->connect("127.0.0.1", 2);
+        expect(connects == 0);
+        uv::runLoop();
+
+        expect(connects == 1);
+        expect(received == "hello world");
+        expect(closes == 2);
+        expect(client->closed() && server->closed());
+        expect(client->send("x", 1) == -1);
+
+        // Unpaired sockets refuse connections
+        int errors = 0;
+        net::SocketEmitter loneEmitter(std::make_shared<net::MemorySocket>());
+        loneEmitter.Error += [&](net::Socket&, const scy::Error& err) {
+            expect(err.err == UV_ECONNREFUSED);
+            errors++;
+        };
+        loneEmitter->connect(net::Address("127.0.0.1", 3));
+        expect(errors == 1);
+        expect(loneEmitter->closed());
+    });
+
+
+    // =========================================================================
+    // Memory Socket Benchmark
+    //
+    describe("memory socket benchmark", []() {
+        const size_t iterations = 100000;
+        const std::string message(1024, 'x');
+        auto pair = net::MemorySocket::createPair();
+
+        size_t roundTrips = 0;
+        net::SocketEmitter serverEmitter(pair.second);
+        serverEmitter.Recv += [&](net::Socket& sock, const MutableBuffer& buffer, const net::Address&) {
+            sock.send(bufferCast<const char*>(buffer), buffer.size());
+        };
+        net::SocketEmitter clientEmitter(pair.first);
+        clientEmitter.Recv += [&](net::Socket& sock, const MutableBuffer& buffer, const net::Address&) {
+            expect(buffer.size() == message.size());
+            if (++roundTrips < iterations)
+                sock.send(message.data(), message.size());
+            else
+                sock.close();
+        };
+
+        const uint64_t benchstart = time::hrtime();
+        pair.first->send(message.data(), message.size());
+        uv::runLoop();
+        const uint64_t benchdone = time::hrtime();
+        expect(roundTrips == iterations);
+
+        std::cout << "memory socket benchmark: "
+            << ((benchdone - benchstart) * 1.0 / iterations) << "ns "
+            << "per 1KB round trip" << std::endl;
+    });
+
+    describe("memory socket adapter benchmark", []() {
+        const size_t iterations = 100000;
+        const std::string message(1024, 'x');
+
+        // Receives on the top of an adapter stack and sends back down it
+        struct Endpoint : public net::SocketAdapter
+        {
+            std::function<void(const MutableBuffer&)> recv;
+            void onSocketRecv(net::Socket&, const MutableBuffer& buffer, const net::Address&) override
+            {
+                recv(buffer);
+            }
+        };
+
+        // Times round trips with the given number of pass-through
+        // adapters stacked on each end of the pair
+        auto run = [&](int layers) {
+            auto pair = net::MemorySocket::createPair();
+            std::vector<std::unique_ptr<net::SocketAdapter>> relays;
+            auto stack = [&](net::SocketAdapter* bottom, Endpoint& top) {
+                for (int i = 0; i < layers; i++) {
+                    relays.emplace_back(new net::SocketAdapter(bottom));
+                    bottom->addReceiver(relays.back().get());
+                    bottom = relays.back().get();
+                }
+                top.setSender(bottom);
+                bottom->addReceiver(&top);
+            };
+
+            size_t roundTrips = 0;
+            Endpoint server, client;
+            server.recv = [&](const MutableBuffer& buffer) {
+                server.send(bufferCast<const char*>(buffer), buffer.size());
+            };
+            client.recv = [&](const MutableBuffer& buffer) {
+                expect(buffer.size() == message.size());
+                if (++roundTrips < iterations)
+                    client.send(message.data(), message.size());
+                else
+                    pair.first->close();
+            };
+            stack(pair.second.get(), server);
+            stack(pair.first.get(), client);
+
+            const uint64_t benchstart = time::hrtime();
+            client.send(message.data(), message.size());
+            uv::runLoop();
+            const uint64_t benchdone = time::hrtime();
+            expect(roundTrips == iterations);
+            return (benchdone - benchstart) * 1.0 / iterations;
+        };
+
+        // A round trip crosses each layer four times, sending and
+        // receiving on both ends, so four layers make 16 pass-throughs
+        const double bare = run(0);
+        const double stacked = run(4);
+        std::cout << "memory socket adapter benchmark: "
+            << bare << "ns per 1KB round trip, "
+            << ((stacked - bare) / 16) << "ns per adapter pass-through" << std::endl;
+    });
+
+
     // =========================================================================
     // SSL Socket Test
     //
@@ -117,6 +509,178 @@ int main(int argc, char** argv)
     });
 
 
+    // =========================================================================
+    // SSL Socket Bulk Write Test
+    //
+    describe("ssl socket bulk write test", []() {
+        net::SSLEchoServer srv;
+        srv.start("127.0.0.1", 1345);
+        srv.server->unref();
+
+        // Large enough to queue encrypted writes behind the socket
+        std::string payload;
+        for (int i = 0; payload.size() < 4 * 1024 * 1024; i++)
+            payload.append(util::itostr(i)).append(",");
+        std::string received;
+        auto socket = std::make_shared<net::SSLSocket>();
+        net::SocketEmitter emitter(socket);
+        emitter.Connect += [&](net::Socket&) {
+            // Written before the handshake completes
+            socket->send(payload.c_str(), 1024);
+        };
+        emitter.Recv += [&](net::Socket& sock, const MutableBuffer& buffer, const net::Address&) {
+            bool first = received.empty();
+            received.append(bufferCast<const char*>(buffer), buffer.size());
+            if (first) {
+                // Encrypted directly from the caller's buffer
+                std::string chunk(payload.substr(1024, payload.size() / 2 - 1024));
+                socket->send(chunk.c_str(), chunk.size());
+
+                // Coalesced and encrypted on flush
+                socket->cork();
+                for (size_t pos = payload.size() / 2; pos < payload.size(); pos += 1000) {
+                    std::string part(payload.substr(pos, 1000));
+                    socket->send(part.c_str(), part.size());
+                }
+                socket->uncork();
+            }
+            if (received.size() >= payload.size())
+                sock.close();
+        };
+
+        socket->connect("127.0.0.1", 1345);
+        uv::runLoop();
+
+        expect(received == payload);
+    });
+
+
+    // =========================================================================
+    // SSL Session Resumption Test
+    //
+    describe("ssl session resumption test", []() {
+        net::SSLEchoServer srv;
+        srv.start("127.0.0.1", 1346);
+        srv.server->unref();
+
+        auto& cache = net::SSLManager::instance().sessionCache();
+        cache.resetStats();
+
+        // Connect twice to the same host, the second connection resuming
+        // the session stored by the first, which for TLS 1.3 is a ticket
+        // received after the handshake.
+        bool reused[2] = { true, false };
+        for (int i = 0; i < 2; i++) {
+            auto socket = std::make_shared<net::SSLSocket>();
+            net::SocketEmitter emitter(socket);
+            emitter.Connect += [&](net::Socket& sock) {
+                sock.send("hello", 5);
+            };
+            emitter.Recv += [&](net::Socket& sock, const MutableBuffer&, const net::Address&) {
+                reused[i] = socket->sessionWasReused();
+                sock.close();
+            };
+            socket->connect("127.0.0.1", 1346);
+            uv::runLoop();
+            expect(socket->sessionKey().empty());
+        }
+
+        expect(!reused[0]);
+        expect(reused[1]);
+        expect(cache.misses() == 1);
+        expect(cache.hits() == 1);
+        expect(cache.hitRate() == 0.5);
+
+        // Evicted by size, least recently used first
+        auto session = cache.find("127.0.0.1:1346");
+        expect(session != nullptr);
+        cache.add("a:443", session);
+        cache.add("b:443", session);
+        expect(cache.find("127.0.0.1:1346") != nullptr);
+        cache.setMaxSize(2);
+        expect(cache.size() == 2);
+        expect(cache.find("a:443") == nullptr);
+        expect(cache.find("b:443") != nullptr);
+
+        // Expired by age
+        cache.setMaxAge(-1);
+        expect(cache.find("b:443") == nullptr);
+        expect(cache.size() == 1);
+
+        cache.clear();
+        cache.setMaxSize(256);
+        cache.setMaxAge(3600);
+    });
+
+
+    // =========================================================================
+    // SSL Socket Kernel TLS Test
+    //
+    describe("ssl socket kernel tls test", []() {
+        // Encryption is offloaded to the kernel where supported, otherwise
+        // the connection falls back to encrypting in user space.
+        auto serverContext = net::SSLManager::instance().defaultServerContext();
+        auto clientContext = net::SSLManager::instance().defaultClientContext();
+        serverContext->enableKernelTLS();
+        clientContext->enableKernelTLS();
+
+        net::SSLEchoServer srv;
+        srv.start("127.0.0.1", 1347);
+        srv.server->unref();
+
+        std::string payload;
+        for (int i = 0; payload.size() < 256 * 1024; i++)
+            payload.append(util::itostr(i)).append(",");
+
+        // TLS 1.3 with a full and a resumed handshake, then TLS 1.2
+        for (int version : { TLS1_3_VERSION, TLS1_3_VERSION, TLS1_2_VERSION }) {
+            if (version == TLS1_2_VERSION)
+                net::SSLManager::instance().sessionCache().remove("127.0.0.1:1347");
+            SSL_CTX_set_max_proto_version(clientContext->sslContext(), version);
+
+            std::string received;
+            bool offloaded = false;
+            auto socket = std::make_shared<net::SSLSocket>();
+            net::SocketEmitter emitter(socket);
+            emitter.Connect += [&](net::Socket&) {
+                // Written before the handshake completes
+                socket->send(payload.c_str(), 1024);
+            };
+            emitter.Recv += [&](net::Socket& sock, const MutableBuffer& buffer, const net::Address&) {
+                bool first = received.empty();
+                received.append(bufferCast<const char*>(buffer), buffer.size());
+                if (first) {
+                    // The buffer is released before the write completes
+                    offloaded = socket->kernelTLS();
+                    std::string rest(payload.substr(1024));
+                    socket->send(rest.c_str(), rest.size());
+                }
+                if (received.size() >= payload.size())
+                    sock.close();
+            };
+            socket->connect("127.0.0.1", 1347);
+            uv::runLoop();
+
+            expect(received == payload);
+
+            // The tls module is listed once loaded, which the first
+            // offload attempt does on demand
+            std::ifstream ulp("/proc/sys/net/ipv4/tcp_available_ulp");
+            std::string modules((std::istreambuf_iterator<char>(ulp)),
+                                std::istreambuf_iterator<char>());
+            if (modules.find("tls") != std::string::npos)
+                expect(offloaded);
+            else
+                std::cout << "ssl socket kernel tls test: tls ULP not available, "
+                          << "offload skipped" << std::endl;
+        }
+
+        SSL_CTX_set_max_proto_version(clientContext->sslContext(), 0);
+        serverContext->enableKernelTLS(false);
+        clientContext->enableKernelTLS(false);
+    });
+
+
     // =========================================================================
     // UDP Socket Test
     //
@@ -133,6 +697,93 @@ int main(int argc, char** argv)
         expect(test.passed);
     });
 
+
+    // =========================================================================
+    // UDP Socket Batch Test
+    //
+    describe("udp socket batch test", []() {
+        const net::Address serverAddress("127.0.0.1", 1343);
+        const int numDatagrams = 100;
+
+        auto server = std::make_shared<net::UDPSocket>();
+        server->setRecvBatchSize(16);
+        server->bind(serverAddress);
+
+        auto client = std::make_shared<net::UDPSocket>();
+        client->bind(net::Address("127.0.0.1", 0));
+
+        int received = 0;
+        net::SocketEmitter emitter(server);
+        emitter.Recv += [&](net::Socket& socket, const MutableBuffer& buffer, const net::Address& peerAddress) {
+            std::string data(bufferCast<const char*>(buffer), buffer.size());
+            expect(data == "datagram " + util::itostr(received));
+            expect(peerAddress == client->address());
+            if (++received == numDatagrams) {
+                socket.close();
+                client->close();
+            }
+        };
+
+        // Queue all datagrams in one loop iteration, half via the
+        // generic adapter interface
+        net::SocketAdapter& adapter = *client;
+        for (int i = 0; i < numDatagrams; i++) {
+            std::string data("datagram " + util::itostr(i));
+            if (i % 2)
+                expect(adapter.sendBatch(data.c_str(), data.size(), serverAddress) == (ssize_t)data.size());
+            else
+                expect(client->sendBatch(data.c_str(), data.size(), serverAddress) == (ssize_t)data.size());
+        }
+
+        uv::runLoop();
+
+        expect(received == numDatagrams);
+    });
+
+
+    // =========================================================================
+    // UDP Socket Segmentation Offload Test
+    //
+    describe("udp socket segmentation offload test", []() {
+        const net::Address serverAddress("127.0.0.1", 1344);
+        const size_t segmentSize = 100;
+        const size_t numSegments = 21;
+
+        auto server = std::make_shared<net::UDPSocket>();
+        server->setRecvBatchSize(8);
+        server->bind(serverAddress);
+        server->setGRO(true); // may be unsupported
+
+        auto client = std::make_shared<net::UDPSocket>();
+        client->bind(net::Address("127.0.0.1", 0));
+
+        // Segments are numbered by their fill character, and the last
+        // segment of each send is short
+        std::string payload;
+        for (size_t i = 0; i < 10; i++)
+            payload.append(segmentSize, char('a' + i));
+        payload.append(segmentSize / 2, char('a' + 10));
+
+        size_t received = 0;
+        net::SocketEmitter emitter(server);
+        emitter.Recv += [&](net::Socket& socket, const MutableBuffer& buffer, const net::Address&) {
+            size_t index = received % 11;
+            std::string data(bufferCast<const char*>(buffer), buffer.size());
+            expect(data == std::string(index == 10 ? segmentSize / 2 : segmentSize, char('a' + index)));
+            if (++received == numSegments + 1) {
+                socket.close();
+                client->close();
+            }
+        };
+
+        expect(client->sendSegmented(payload.c_str(), payload.size(), segmentSize, serverAddress) == (ssize_t)payload.size());
+        expect(client->sendSegmented(payload.c_str(), payload.size(), segmentSize, serverAddress) == (ssize_t)payload.size());
+
+        uv::runLoop();
+
+        expect(received == numSegments + 1);
+    });
+
     // =========================================================================
     // DNS Resolver Test
     //
@@ -183,6 +834,94 @@ int main(int argc, char** argv)
     });
 
 
+    // =========================================================================
+    // DNS Cache Test
+    //
+    describe("dns cache test", []() {
+        net::dns::Resolver resolver;
+
+        // Concurrent lookups for the same host are coalesced
+        int resolved = 0;
+        for (uint16_t port : { 80, 443, 8080 }) {
+            resolver.resolve("localhost", port, [&, port](int err, const net::Address& addr) {
+                expect(err == 0);
+                expect(addr.port() == port);
+                resolved++;
+            });
+        }
+        expect(resolver.lookups() == 1);
+        uv::runLoop();
+        expect(resolved == 3);
+
+        // Answered synchronously from the cache
+        resolver.resolve("localhost", 1234, [&](int err, const net::Address& addr) {
+            expect(err == 0);
+            expect(addr.port() == 1234);
+            resolved++;
+        });
+        expect(resolved == 4);
+        expect(resolver.lookups() == 1);
+
+        // Failures are cached for the negative TTL
+        int failed = 0;
+        resolver.resolve("hostthatdoesntexist.invalid", 80, [&](int err, const net::Address&) {
+            expect(err != 0);
+            failed++;
+        });
+        uv::runLoop();
+        resolver.resolve("hostthatdoesntexist.invalid", 80, [&](int err, const net::Address&) {
+            expect(err != 0);
+            failed++;
+        });
+        expect(failed == 2);
+        expect(resolver.lookups() == 2);
+
+        // Cached answers are not looked up again until expired
+        resolver.prewarm("localhost");
+        expect(resolver.lookups() == 2);
+        resolver.setTTL(0, 0);
+        resolver.remove("localhost");
+        resolver.prewarm("localhost");
+        expect(resolver.lookups() == 3);
+        uv::runLoop();
+        resolver.prewarm("localhost");
+        expect(resolver.lookups() == 4);
+        uv::runLoop();
+        resolver.setTTL(60000, 5000);
+
+        // IP addresses are never looked up
+        resolver.resolve("127.0.0.1", 80, [&](int err, const net::Address& addr) {
+            expect(err == 0);
+            resolved++;
+        });
+        expect(resolved == 5);
+        expect(resolver.size() == 2);
+        resolver.clear();
+        expect(resolver.size() == 0);
+
+        // Expired answers are purged once the cache is full, without
+        // losing the callback of the lookup which triggered the purge
+        struct FullResolver : public net::dns::Resolver
+        {
+            void fill(size_t count)
+            {
+                for (size_t i = 0; i < count; i++)
+                    _entries["expired" + std::to_string(i) + ".invalid"];
+            }
+        };
+        FullResolver full;
+        full.fill(1024);
+        full.resolve("localhost", 80, [&](int err, const net::Address& addr) {
+            expect(err == 0);
+            expect(addr.port() == 80);
+            resolved++;
+        });
+        uv::runLoop();
+        expect(resolved == 6);
+        expect(full.size() == 1);
+    });
+
+
     // =========================================================================
     // TCP Socket Error Test
     //
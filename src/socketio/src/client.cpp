@@ -70,6 +70,8 @@ Client::Client(const net::Socket::Ptr& socket, const Client::Options& options)
     , _ws(socket)
     , _wasOnline(false)
 {
+    // Packets are parsed from whole messages
+    _ws.setReassembleMessages(true);
     _ws.addReceiver(this);
 }
 
@@ -51,6 +51,7 @@ struct ServerOptions
 
     bool enableTCP;
     bool enableUDP;
+    bool enableStats; ///< Collect traffic counters on control sockets
 
     ServerOptions()
     {
@@ -65,6 +66,7 @@ struct ServerOptions
         earlyMediaBufferSize = 8192;
         enableTCP = true;
         enableUDP = true;
+        enableStats = false;
     }
 };
 
@@ -132,6 +134,12 @@ public:
     net::TCPSocket& tcpSocket();
     Timer& timer();
 
+    /// Returns the traffic counters summed over the UDP socket and all
+    /// TCP control connections, including those which have closed.
+    /// Requires ServerOptions::enableStats. Allocation relay sockets
+    /// are not included.
+    net::SocketStats stats() const;
+
     void onTCPAcceptConnection(const net::TCPSocket::Ptr& sock);
     void onTCPSocketClosed(net::Socket& socket);
     void onSocketRecv(net::Socket& socket, const MutableBuffer& buffer,
@@ -145,6 +153,7 @@ private:
     net::SocketEmitter _tcpSocket; // net::TCPSocket
     std::vector<net::SocketEmitter> _tcpSockets;
     ServerAllocationMap _allocations;
+    net::SocketStats _closedStats;
     Timer _timer;
 };
 
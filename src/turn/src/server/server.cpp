@@ -51,6 +51,7 @@ void Server::start()
     if (_options.enableUDP) {
         _udpSocket.swap(net::makeSocket<net::UDPSocket>());
         _udpSocket.Recv += slot(this, &Server::onSocketRecv, 1);
+        _udpSocket->enableStats(_options.enableStats);
         _udpSocket->bind(_options.listenAddr);
         LTrace("UDP listening on ", _options.listenAddr)
     }
@@ -115,6 +116,7 @@ void Server::onTCPAcceptConnection(const net::TCPSocket::Ptr& sock)
 {
     LTrace("TCP connection accepted: ", sock->peerAddress())
 
+    sock->enableStats(_options.enableStats);
     net::SocketEmitter emitter(sock);
     emitter.Recv += slot(this, &Server::onSocketRecv);
     emitter.Close += slot(this, &Server::onTCPSocketClosed);
@@ -194,6 +196,7 @@ void Server::releaseTCPSocket(const net::Socket& socket)
             it->Recv -= slot(this, &Server::onSocketRecv);
             it->Close -= slot(this, &Server::onTCPSocketClosed);
             //socket->removeReceiver(this);
+            _closedStats += socket.stats();
 
             // All we need to do is erase the socket in order to
             // deincrement the ref counter and destroy the socket.
@@ -757,6 +760,17 @@ ServerAllocationMap Server::allocations() const
 }
 
 
+net::SocketStats Server::stats() const
+{
+    net::SocketStats stats(_closedStats);
+    if (_udpSocket.impl)
+        stats += _udpSocket->stats();
+    for (auto& sock : _tcpSockets)
+        stats += sock->stats();
+    return stats;
+}
+
+
 Timer& Server::timer()
 {
     return _timer;
@@ -36,7 +36,7 @@ public:
         RawPacket& p = dynamic_cast<RawPacket&>(packet); // cast or throw
 
         base64::Encoder enc;
-        std::vector<char> result(packet.size() * 2);
+        std::vector<char> result(enc.maxEncodedSize(p.size()));
         size_t size =
             enc.encode((const char*)p.data(), p.size(), &result[0]);
         size += enc.finalize(&result[size]);